@@ -1,108 +1,400 @@
 #include "BleManager.h"
+#include "../common/Tracer.h"
+#include <QDebug>
 #include <iostream>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <array>
+#include <map>
+
+namespace {
+
+// Load on each radio, shared by every BleManager in the process so a new
+// session can be placed on the least busy one
+constexpr int RATE_WINDOW_SECONDS = 10;
+
+// How long a replay waits for the engine to send the command the capture
+// has next before it gives up on that one and moves on
+constexpr int REPLAY_SEND_TIMEOUT_MS = 5000;
+
+struct AdapterLoad {
+    std::string identifier;
+    int connections = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    std::array<int64_t, RATE_WINDOW_SECONDS> second{};
+    std::array<uint64_t, RATE_WINDOW_SECONDS> bytes{};
+};
+
+std::mutex registryMutex;
+std::map<std::string, AdapterLoad> registry; // By adapter address
+
+int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void addTraffic(const std::string& adapter, size_t count, bool sent) {
+    if (adapter.empty()) return;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto& load = registry[adapter];
+    (sent ? load.bytesSent : load.bytesReceived) += count;
+    int64_t sec = nowMs() / 1000;
+    int slot = static_cast<int>(sec % RATE_WINDOW_SECONDS);
+    if (load.second[slot] != sec) {
+        load.second[slot] = sec;
+        load.bytes[slot] = 0;
+    }
+    load.bytes[slot] += count;
+}
+
+double bytesPerSecond(const AdapterLoad& load) {
+    int64_t sec = nowMs() / 1000;
+    uint64_t total = 0;
+    for (int i = 0; i < RATE_WINDOW_SECONDS; ++i) {
+        if (sec - load.second[i] < RATE_WINDOW_SECONDS) total += load.bytes[i];
+    }
+    return static_cast<double>(total) / RATE_WINDOW_SECONDS;
+}
+
+std::string adapterKey(SimpleBLE::Adapter& adapter) {
+    try {
+        return adapter.address();
+    } catch (...) {
+        return "";
+    }
+}
+
+} // namespace
 
 BleManager::BleManager() {
 }
 
 BleManager::~BleManager() {
     disconnect();
+    releaseAdapter();
+    stopReplay();
+    stopCapture();
 }
 
 void BleManager::initialize() {
+    // The link service initializes one BleManager per session; the adapter
+    // list only needs to show up in the log the first time
+    static std::atomic<bool> logged{false};
+    const bool log = !logged.exchange(true);
+
     adapters = SimpleBLE::Adapter::get_adapters();
     if (adapters.empty()) {
-        std::cerr << "No Bluetooth adapters found" << std::endl;
+        if (log) qDebug() << "No Bluetooth adapters found";
         return;
     }
     selectedAdapter = adapters[0];
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& adapter : adapters) {
+        std::string key = adapterKey(adapter);
+        registry[key].identifier = adapter.identifier();
+        if (log) {
+            qDebug().noquote() << QString("Bluetooth adapter %1 [%2]")
+                                      .arg(QString::fromStdString(adapter.identifier()), QString::fromStdString(key));
+        }
+    }
+}
+
+void BleManager::shareAdapters(const BleManager& other) {
+    adapters = other.adapters;
+    if (!adapters.empty()) selectedAdapter = adapters[0];
 }
 
 void BleManager::startScan(DeviceFoundCallback callback) {
-    if (!selectedAdapter.initialized()) return;
+    if (adapters.empty()) return;
 
-    try {
+    {
+        std::lock_guard<std::mutex> lock(peripheralsMutex);
         peripherals.clear(); // Clear old results
-        onDeviceFound = callback;
-        selectedAdapter.set_callback_on_scan_found([this](SimpleBLE::Peripheral peripheral) {
-            if (peripheral.is_connectable()) {
-                peripherals[peripheral.address()] = peripheral;
+    }
+    onDeviceFound = callback;
+    // Every radio scans; a device heard by several can go on any of them
+    for (size_t i = 0; i < adapters.size(); ++i) {
+        try {
+            auto report = [this, i](SimpleBLE::Peripheral peripheral) {
+                if (!peripheral.is_connectable()) return;
+                // Drop everything else in the room before it reaches the UI
+                if (scanFilter && !isPixlPeripheral(peripheral)) return;
+                recordSighting(peripheral.address(), i, peripheral);
                 if (onDeviceFound) {
-                    onDeviceFound(peripheral.identifier(), peripheral.address());
+                    onDeviceFound(peripheral.identifier(), peripheral.address(), peripheral.rssi());
                 }
-            }
-        });
-        
-        selectedAdapter.scan_start();
-    } catch (const std::exception& e) {
-        std::cerr << "Exception in startScan: " << e.what() << std::endl;
+            };
+            adapters[i].set_callback_on_scan_found(report);
+            adapters[i].set_callback_on_scan_updated(report);
+            adapters[i].scan_start();
+        } catch (const std::exception& e) {
+            std::cerr << "Exception in startScan on adapter " << i << ": " << e.what() << std::endl;
+        }
     }
 }
 
+void BleManager::setScanFilter(bool pixlOnly) {
+    scanFilter = pixlOnly;
+}
+
+bool BleManager::isPixlPeripheral(SimpleBLE::Peripheral& peripheral) {
+    auto lower = [](std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+        return text;
+    };
+    try {
+        for (auto& service : peripheral.services()) {
+            if (lower(service.uuid()) == Pixl::SERVICE_UUID) return true;
+        }
+    } catch (...) {
+        // Some backends can't list advertised services before connecting
+    }
+    return lower(peripheral.identifier()).find("pixl") != std::string::npos;
+}
+
 void BleManager::stopScan() {
-    if (selectedAdapter.initialized()) {
+    for (auto& adapter : adapters) {
         try {
-            selectedAdapter.scan_stop();
+            adapter.scan_stop();
         } catch (...) {
             // Ignore if scan was not running
         }
     }
 }
 
+void BleManager::recordSighting(const std::string& address, size_t adapterIndex, SimpleBLE::Peripheral& peripheral) {
+    std::lock_guard<std::mutex> lock(peripheralsMutex);
+    auto& sightings = peripherals[address];
+    for (auto& sighting : sightings) {
+        if (sighting.adapterIndex == adapterIndex) {
+            sighting.peripheral = peripheral;
+            return;
+        }
+    }
+    sightings.push_back({adapterIndex, peripheral});
+}
+
+void BleManager::importPeripherals(BleManager& scanner) {
+    if (&scanner == this) return;
+    std::scoped_lock lock(peripheralsMutex, scanner.peripheralsMutex);
+    // Only valid when both enumerated the same adapters, in the same order
+    if (scanner.adapters.size() != adapters.size()) return;
+    for (const auto& entry : scanner.peripherals) {
+        peripherals[entry.first] = entry.second;
+    }
+}
+
 bool BleManager::connect(const std::string& address) {
-    if (!selectedAdapter.initialized()) return false;
+    if (adapters.empty()) return false;
     
     stopScan();
+    commandLimit = 0; // Until the new firmware's profile is known
     
-    auto it = peripherals.find(address);
-    if (it == peripherals.end()) return false;
+    std::vector<Sighting> sightings;
+    {
+        std::lock_guard<std::mutex> lock(peripheralsMutex);
+        auto it = peripherals.find(address);
+        if (it != peripherals.end()) sightings = it->second;
+    }
+    if (sightings.empty()) {
+        if (!findPeripheral(address, TARGETED_SCAN_TIMEOUT_MS)) return false;
+        std::lock_guard<std::mutex> lock(peripheralsMutex);
+        sightings = peripherals[address];
+    }
 
-    try {
-        selectedPeripheral = it->second;
-        selectedPeripheral.connect();
+    // Least loaded radio that can hear the device: fewest sessions, then
+    // least recent traffic
+    auto load = [this](size_t index) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        const auto& entry = registry[adapterKey(adapters[index])];
+        return std::make_pair(entry.connections, bytesPerSecond(entry));
+    };
+    std::stable_sort(sightings.begin(), sightings.end(), [&load](const Sighting& a, const Sighting& b) {
+        return load(a.adapterIndex) < load(b.adapterIndex);
+    });
+
+    for (auto& sighting : sightings) {
+        try {
+            selectedAdapter = adapters[sighting.adapterIndex];
+            selectedPeripheral = sighting.peripheral;
+            selectedPeripheral.connect();
         
-        if (selectedPeripheral.is_connected()) {
-            // Subscribe to RX
-            selectedPeripheral.notify(Pixl::SERVICE_UUID, Pixl::TX_CHAR_UUID, [this](SimpleBLE::ByteArray bytes) {
-                std::vector<uint8_t> data(bytes.begin(), bytes.end());
-                if (onDataReceived) {
-                    onDataReceived(data);
+            if (selectedPeripheral.is_connected()) {
+                sessionAdapter = adapterKey(selectedAdapter);
+                {
+                    std::lock_guard<std::mutex> lock(registryMutex);
+                    registry[sessionAdapter].connections++;
+                    adapterHeld = true;
                 }
-            });
+
+                // Subscribe to RX
+                selectedPeripheral.notify(Pixl::SERVICE_UUID, Pixl::TX_CHAR_UUID, [this, adapter = sessionAdapter](SimpleBLE::ByteArray bytes) {
+                    if (Tracer::enabled()) Tracer::setThreadName("BLE notify");
+                    std::vector<uint8_t> data(bytes.begin(), bytes.end());
+                    capture.record(TrafficCapture::Direction::Received, data.data(), data.size());
+                    addTraffic(adapter, data.size(), false);
+                    if (onDataReceived) {
+                        onDataReceived(data);
+                    }
+                });
             
-            selectedPeripheral.set_callback_on_disconnected([this]() {
-                if (onDisconnected) {
-                    onDisconnected();
-                }
-            });
-            return true;
+                selectedPeripheral.set_callback_on_disconnected([this]() {
+                    releaseAdapter();
+                    if (onDisconnected) {
+                        onDisconnected();
+                    }
+                });
+                return true;
+            }
+        } catch (const std::exception& e) {
+            // Another radio that heard it may still get through
+            std::cerr << "Exception in connect on adapter " << sighting.adapterIndex << ": " << e.what() << std::endl;
         }
-    } catch (const std::exception& e) {
-        std::cerr << "Exception in connect: " << e.what() << std::endl;
     }
 
     return false;
 }
 
+void BleManager::releaseAdapter() {
+    // Both the disconnect callback and disconnect() get here
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (!adapterHeld) return;
+    adapterHeld = false;
+    auto& load = registry[sessionAdapter];
+    if (load.connections > 0) load.connections--;
+}
+
+std::vector<BleManager::AdapterStats> BleManager::adapterStats() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::vector<AdapterStats> result;
+    for (const auto& entry : registry) {
+        if (entry.first.empty()) continue;
+        result.push_back({entry.second.identifier, entry.first, entry.second.connections,
+                          entry.second.bytesSent, entry.second.bytesReceived, bytesPerSecond(entry.second)});
+    }
+    return result;
+}
+
+bool BleManager::findPeripheral(const std::string& address, int timeoutMs) {
+    auto sameAddress = [](const std::string& a, const std::string& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    };
+
+    std::unique_lock<std::mutex> lock(scanMutex);
+    scanTarget = address;
+    scanTargetFound = false;
+    for (size_t i = 0; i < adapters.size(); ++i) {
+        try {
+            auto match = [this, i, sameAddress](SimpleBLE::Peripheral peripheral) {
+                std::lock_guard<std::mutex> lock(scanMutex);
+                if (!sameAddress(peripheral.address(), scanTarget)) return;
+                // Keyed by the address we were asked for, whatever its case
+                recordSighting(scanTarget, i, peripheral);
+                scanTargetFound = true;
+                scanCv.notify_all();
+            };
+            adapters[i].set_callback_on_scan_found(match);
+            adapters[i].set_callback_on_scan_updated(match);
+            adapters[i].scan_start();
+        } catch (const std::exception& e) {
+            std::cerr << "Exception in targeted scan on adapter " << i << ": " << e.what() << std::endl;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool found = scanCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return scanTargetFound; });
+    if (found && adapters.size() > 1) {
+        // Give the other radios a moment to hear it too, so placement has a choice
+        auto settled = std::chrono::steady_clock::now() + std::chrono::milliseconds(TARGETED_SCAN_SETTLE_MS);
+        scanCv.wait_until(lock, settled, []() { return false; });
+    }
+    lock.unlock();
+    stopScan();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Targeted scan for " << address << (found ? " found it" : " timed out")
+              << " after " << elapsed << " ms" << std::endl;
+    return found;
+}
+
 void BleManager::disconnect() {
+    if (isReplaying()) {
+        stopReplay();
+        return;
+    }
     if (selectedPeripheral.initialized() && selectedPeripheral.is_connected()) {
         selectedPeripheral.disconnect();
     }
+    releaseAdapter();
 }
 
 bool BleManager::isConnected() {
+    if (replayActive || externalLink) return true;
     return selectedPeripheral.initialized() && selectedPeripheral.is_connected();
 }
 
+std::string BleManager::adapterIdentifier() {
+    if (!selectedAdapter.initialized()) return "";
+    try {
+        return selectedAdapter.identifier() + " [" + selectedAdapter.address() + "]";
+    } catch (...) {
+        return "";
+    }
+}
+
 void BleManager::sendCommand(Pixl::Command cmd, const std::vector<uint8_t>& payload) {
     if (!isConnected()) return;
 
-    auto packet = Pixl::Protocol::createPacket(cmd, payload);
-    
+    sendPacket(Pixl::Protocol::createPacket(cmd, payload));
+}
+
+void BleManager::sendPacket(const std::vector<uint8_t>& packet) {
+    if (!isConnected()) return;
+
+    TraceSpan span("write_request", "ble");
+    if (replayActive) {
+        std::lock_guard<std::mutex> lock(replayMutex);
+        replaySent.push_back(packet);
+        replayCv.notify_all();
+        return;
+    }
+    capture.record(TrafficCapture::Direction::Sent, packet.data(), packet.size());
+    if (externalLink) {
+        externalLink(packet);
+        return;
+    }
+    addTraffic(sessionAdapter, packet.size(), true);
+
     // Send to TX Characteristic
+    if (packet.size() <= commandLimit) {
+        selectedPeripheral.write_command(Pixl::SERVICE_UUID, Pixl::RX_CHAR_UUID,
+                                         std::string(packet.begin(), packet.end()));
+        return;
+    }
     selectedPeripheral.write_request(Pixl::SERVICE_UUID, Pixl::RX_CHAR_UUID, 
                                      std::string(packet.begin(), packet.end()));
 }
 
+uint16_t BleManager::mtu() {
+    if (replayActive || externalLink || !selectedPeripheral.initialized()) return 0;
+    try {
+        return selectedPeripheral.mtu();
+    } catch (...) {
+        return 0;
+    }
+}
+
+void BleManager::setWriteWithoutResponse(bool enabled) {
+    uint16_t size = enabled ? mtu() : 0;
+    commandLimit = size > 3 ? size - 3 : 0; // ATT header
+}
+
 void BleManager::setDataReceivedCallback(DataReceivedCallback callback) {
     onDataReceived = callback;
 }
@@ -110,3 +402,146 @@ void BleManager::setDataReceivedCallback(DataReceivedCallback callback) {
 void BleManager::setDisconnectedCallback(DisconnectedCallback callback) {
     onDisconnected = callback;
 }
+
+void BleManager::attachExternalLink(PacketSink sink) {
+    externalLink = sink;
+}
+
+void BleManager::detachExternalLink() {
+    externalLink = nullptr;
+}
+
+bool BleManager::hasExternalLink() const {
+    return static_cast<bool>(externalLink);
+}
+
+void BleManager::deliverNotification(const std::vector<uint8_t>& data) {
+    capture.record(TrafficCapture::Direction::Received, data.data(), data.size());
+    if (onDataReceived) {
+        onDataReceived(data);
+    }
+}
+
+bool BleManager::startCapture(const std::string& path) {
+    return capture.open(path);
+}
+
+void BleManager::stopCapture() {
+    capture.close();
+}
+
+bool BleManager::isCapturing() const {
+    return capture.isOpen();
+}
+
+bool BleManager::startReplay(const std::string& path, bool realTime) {
+    stopReplay();
+    disconnect();
+
+    auto reader = std::make_unique<TrafficCapture::Reader>();
+    if (!reader->open(path)) {
+        std::cerr << "Could not open capture " << path << std::endl;
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(replayMutex);
+        replaySent.clear();
+        replayStopRequested = false;
+    }
+    replayActive = true;
+    replayThread = std::thread(&BleManager::runReplay, this, std::move(reader), realTime);
+    return true;
+}
+
+void BleManager::stopReplay() {
+    {
+        std::lock_guard<std::mutex> lock(replayMutex);
+        replayStopRequested = true;
+    }
+    replayCv.notify_all();
+    if (replayThread.joinable()) {
+        if (replayThread.get_id() == std::this_thread::get_id()) {
+            replayThread.detach(); // Stopped from a callback on the replay thread
+        } else {
+            replayThread.join();
+        }
+    }
+    replayActive = false;
+}
+
+bool BleManager::isReplaying() const {
+    return replayActive;
+}
+
+void BleManager::setReplayFinishedCallback(ReplayFinishedCallback callback) {
+    onReplayFinished = callback;
+}
+
+void BleManager::runReplay(std::unique_ptr<TrafficCapture::Reader> reader, bool realTime) {
+    using Clock = std::chrono::steady_clock;
+    const auto wallStart = Clock::now();
+
+    TrafficCapture::Record record;
+    int64_t captureEndUs = 0;
+    size_t delivered = 0, matched = 0, diverged = 0, skipped = 0;
+    bool stopped = false;
+
+    while (reader->next(record)) {
+        captureEndUs = record.timestampUs;
+
+        if (record.direction == TrafficCapture::Direction::Sent) {
+            // Hold the next notification back until the engine has sent this command
+            std::unique_lock<std::mutex> lock(replayMutex);
+            bool sent = replayCv.wait_for(lock, std::chrono::milliseconds(REPLAY_SEND_TIMEOUT_MS),
+                                          [this]() { return replayStopRequested || !replaySent.empty(); });
+            if (replayStopRequested) {
+                stopped = true;
+                break;
+            }
+            if (!sent) {
+                // The engine went another way and won't send it; don't hang on it
+                skipped++;
+                continue;
+            }
+            if (replaySent.front() == record.data) {
+                matched++;
+            } else {
+                diverged++;
+            }
+            replaySent.pop_front();
+            continue;
+        }
+
+        if (realTime) {
+            std::unique_lock<std::mutex> lock(replayMutex);
+            replayCv.wait_until(lock, wallStart + std::chrono::microseconds(record.timestampUs),
+                                [this]() { return replayStopRequested; });
+        }
+        {
+            std::lock_guard<std::mutex> lock(replayMutex);
+            if (replayStopRequested) {
+                stopped = true;
+                break;
+            }
+        }
+        if (onDataReceived) onDataReceived(record.data);
+        delivered++;
+    }
+
+    auto wallUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - wallStart).count();
+    std::ostringstream summary;
+    summary << (stopped ? "Replay stopped" : "Replay finished") << ": "
+            << delivered << " notifications delivered, "
+            << matched << " commands matched, " << diverged << " diverged, "
+            << skipped << " never sent; "
+            << wallUs / 1000 << " ms replayed vs " << captureEndUs / 1000 << " ms captured";
+
+    replayActive = false;
+    if (stopped) {
+        if (onDisconnected) onDisconnected();
+    } else if (onReplayFinished) {
+        onReplayFinished(summary.str());
+    }
+    std::cerr << summary.str() << std::endl;
+}
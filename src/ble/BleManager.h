@@ -5,37 +5,138 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <map>
 #include "PixlProtocol.h"
+#include "TrafficCapture.h"
 
 class BleManager {
 public:
-    using DeviceFoundCallback = std::function<void(const std::string& name, const std::string& address)>;
+    // Called for every advertisement, including repeats of a device already
+    // reported, so the receiver can track RSSI and last-seen time
+    using DeviceFoundCallback = std::function<void(const std::string& name, const std::string& address, int16_t rssi)>;
     using DataReceivedCallback = std::function<void(const std::vector<uint8_t>& data)>;
     using DisconnectedCallback = std::function<void()>;
+    using ReplayFinishedCallback = std::function<void(const std::string& summary)>;
+    using PacketSink = std::function<void(const std::vector<uint8_t>& packet)>;
+
+    // Per radio, across every BleManager in the process
+    struct AdapterStats {
+        std::string identifier;
+        std::string address;
+        int connections;
+        uint64_t bytesSent;
+        uint64_t bytesReceived;
+        double bytesPerSecond; // Both directions, last 10 s
+    };
 
     BleManager();
     ~BleManager();
 
+    // Enumerates every adapter. Scans run on all of them, and connect()
+    // places the session on the least loaded one that heard the device.
     void initialize();
+    // Takes the adapters another, initialized manager already enumerated,
+    // instead of enumerating them again (which blocks)
+    void shareAdapters(const BleManager& other);
     void startScan(DeviceFoundCallback callback);
     void stopScan();
+    // When on (the default), scans only report peripherals advertising the
+    // Pixl service or a Pixl name. Takes effect on the next startScan.
+    void setScanFilter(bool pixlOnly);
     
+    // Addresses not seen by the last scan are looked up with a short
+    // targeted scan that stops as soon as the device advertises
     bool connect(const std::string& address);
+    // Lets a second session connect to what another manager's scan found
+    void importPeripherals(BleManager& scanner);
     void disconnect();
     bool isConnected();
+    std::string adapterIdentifier();
+    static std::vector<AdapterStats> adapterStats();
 
     void sendCommand(Pixl::Command cmd, const std::vector<uint8_t>& payload = {});
+    // Writes an already encoded packet
+    void sendPacket(const std::vector<uint8_t>& packet);
+    // ATT MTU of the live connection; 0 if unknown, replaying or relayed
+    uint16_t mtu();
+    // Writes packets that fit one ATT write as commands, without waiting
+    // for the link-layer acknowledgement. Only for firmware that says it
+    // keeps up; the protocol-level reply still paces the traffic.
+    void setWriteWithoutResponse(bool enabled);
     
     void setDataReceivedCallback(DataReceivedCallback callback);
     void setDisconnectedCallback(DisconnectedCallback callback);
 
+    // Logs every packet written and notified to a capture file
+    bool startCapture(const std::string& path);
+    void stopCapture();
+    bool isCapturing() const;
+
+    // Plays a capture back instead of talking to a device. Notifications are
+    // delivered through the normal data callback, each one only after the
+    // commands that preceded it in the capture have been sent again, so the
+    // transfer engine runs through the same states as it did live. With
+    // realTime off they are delivered as fast as the engine asks for them.
+    bool startReplay(const std::string& path, bool realTime);
+    void stopReplay();
+    bool isReplaying() const;
+    void setReplayFinishedCallback(ReplayFinishedCallback callback);
+
+    // Routes traffic through another owner of the device link (the link
+    // service) instead of SimpleBLE. Packets go to the sink and incoming
+    // ones are handed in with deliverNotification.
+    void attachExternalLink(PacketSink sink);
+    void detachExternalLink();
+    bool hasExternalLink() const;
+    void deliverNotification(const std::vector<uint8_t>& data);
+
+    static constexpr int TARGETED_SCAN_TIMEOUT_MS = 6000;
+    static constexpr int TARGETED_SCAN_SETTLE_MS = 300;
+
 private:
+    struct Sighting {
+        size_t adapterIndex;
+        SimpleBLE::Peripheral peripheral;
+    };
+
+    bool findPeripheral(const std::string& address, int timeoutMs);
+    void recordSighting(const std::string& address, size_t adapterIndex, SimpleBLE::Peripheral& peripheral);
+    void releaseAdapter();
+    static bool isPixlPeripheral(SimpleBLE::Peripheral& peripheral);
+    void runReplay(std::unique_ptr<TrafficCapture::Reader> reader, bool realTime);
+
     std::vector<SimpleBLE::Adapter> adapters;
     SimpleBLE::Adapter selectedAdapter;
     SimpleBLE::Peripheral selectedPeripheral;
-    std::map<std::string, SimpleBLE::Peripheral> peripherals; // Map address -> peripheral
+    std::mutex peripheralsMutex;
+    std::map<std::string, std::vector<Sighting>> peripherals; // Address -> adapters that heard it
+    std::string sessionAdapter; // Address of the adapter the session runs on
+    bool adapterHeld = false;   // Counted in the adapter load; guarded by the registry lock
+
+    std::mutex scanMutex;
+    std::condition_variable scanCv;
+    std::string scanTarget;
+    bool scanTargetFound = false;
     
     DeviceFoundCallback onDeviceFound;
+    std::atomic<bool> scanFilter{true};
     DataReceivedCallback onDataReceived;
     DisconnectedCallback onDisconnected;
+    ReplayFinishedCallback onReplayFinished;
+
+    TrafficCapture::Writer capture;
+    PacketSink externalLink;
+    std::atomic<size_t> commandLimit{0}; // Largest packet sent without response; 0 for none
+
+    std::thread replayThread;
+    std::mutex replayMutex;
+    std::condition_variable replayCv;
+    std::deque<std::vector<uint8_t>> replaySent; // Packets the engine sent, not yet matched
+    std::atomic<bool> replayActive{false};
+    bool replayStopRequested = false;
 };
@@ -0,0 +1,158 @@
+#include "LinkClient.h"
+#include "PixlProtocol.h"
+#include <QLocalSocket>
+#include <QElapsedTimer>
+#include <QDebug>
+
+using LinkProtocol::FrameType;
+
+LinkClient::LinkClient(QObject *parent) : QObject(parent), socket(new QLocalSocket(this)) {
+    connect(socket, &QLocalSocket::connected, this, [this]() {
+        std::vector<uint8_t> hello;
+        for (int i = 0; i < 4; ++i) hello.push_back((LinkProtocol::VERSION >> (8 * i)) & 0xFF);
+        send(FrameType::Hello, hello);
+        emit attached();
+    });
+    connect(socket, &QLocalSocket::disconnected, this, [this]() {
+        decoder = LinkProtocol::FrameDecoder();
+        emit detached();
+    });
+    connect(socket, &QLocalSocket::readyRead, this, [this]() { processFrames(); });
+}
+
+QString LinkClient::serverName() {
+    QString user = qEnvironmentVariable("USER", qEnvironmentVariable("USERNAME"));
+    return "joymanager-link-" + user;
+}
+
+bool LinkClient::connectToService(int timeoutMs) {
+    socket->connectToServer(serverName());
+    return socket->waitForConnected(timeoutMs);
+}
+
+void LinkClient::connectToServiceAsync() {
+    socket->connectToServer(serverName());
+}
+
+bool LinkClient::isAttached() const {
+    return socket->state() == QLocalSocket::ConnectedState;
+}
+
+void LinkClient::requestStatus() {
+    send(FrameType::GetStatus);
+}
+
+void LinkClient::startScan(bool pixlOnly) {
+    send(FrameType::StartScan, {static_cast<uint8_t>(pixlOnly ? 1 : 0)});
+}
+
+void LinkClient::stopScan() {
+    send(FrameType::StopScan);
+}
+
+void LinkClient::connectDevice(const QString &address) {
+    send(FrameType::Connect, Pixl::Protocol::createStringPayload(address.toStdString()));
+}
+
+void LinkClient::disconnectDevice() {
+    send(FrameType::Disconnect);
+}
+
+void LinkClient::sendPacket(const std::vector<uint8_t> &packet) {
+    send(FrameType::Packet, packet);
+}
+
+void LinkClient::requestAdapters() {
+    send(FrameType::GetAdapters);
+}
+
+bool LinkClient::waitForFrame(int timeoutMs) {
+    QElapsedTimer timer;
+    timer.start();
+    while (isAttached()) {
+        int remaining = timeoutMs - static_cast<int>(timer.elapsed());
+        if (remaining <= 0 || !socket->waitForReadyRead(remaining)) return false;
+        if (processFrames() > 0) return true;
+    }
+    return false;
+}
+
+void LinkClient::send(FrameType type, const std::vector<uint8_t> &body) {
+    if (!isAttached()) return;
+    auto frame = LinkProtocol::encodeFrame(type, body);
+    socket->write(reinterpret_cast<const char *>(frame.data()), static_cast<qint64>(frame.size()));
+}
+
+int LinkClient::processFrames() {
+    QByteArray bytes = socket->readAll();
+    decoder.feed(reinterpret_cast<const uint8_t *>(bytes.constData()), bytes.size());
+
+    int handled = 0;
+    LinkProtocol::Frame frame;
+    while (decoder.next(frame)) {
+        ++handled;
+        size_t offset = 0;
+        switch (frame.type) {
+        case FrameType::Status: {
+            bool connected = !frame.body.empty() && frame.body[0] != 0;
+            offset = 1;
+            QString address = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+            QString adapter = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+            QString error = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+            if (!error.isEmpty()) {
+                qDebug() << "Link service refused this client:" << error;
+                break; // It closes the connection, which reports detached()
+            }
+            emit status(connected, address, adapter);
+            break;
+        }
+        case FrameType::DeviceFound: {
+            QString name = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+            QString address = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+            int rssi = static_cast<int16_t>(Pixl::Protocol::parseUInt16(frame.body, offset));
+            emit deviceFound(name, address, rssi);
+            break;
+        }
+        case FrameType::Connected: {
+            bool ok = !frame.body.empty() && frame.body[0] != 0;
+            offset = 1;
+            QString address = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+            QString adapter = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+            emit deviceConnected(ok, address, adapter);
+            break;
+        }
+        case FrameType::Notification:
+            emit notification(QByteArray(reinterpret_cast<const char *>(frame.body.data()),
+                                         static_cast<int>(frame.body.size())));
+            break;
+        case FrameType::Disconnected:
+            emit deviceDisconnected();
+            break;
+        case FrameType::Adapters: {
+            QStringList lines;
+            int count = frame.body.empty() ? 0 : frame.body[0];
+            offset = 1;
+            for (int i = 0; i < count; ++i) {
+                QString name = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+                QString address = QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset));
+                int connections = Pixl::Protocol::parseUInt16(frame.body, offset);
+                uint32_t rate = Pixl::Protocol::parseUInt32(frame.body, offset);
+                uint32_t sentKiB = Pixl::Protocol::parseUInt32(frame.body, offset);
+                uint32_t receivedKiB = Pixl::Protocol::parseUInt32(frame.body, offset);
+                lines << QString("%1 [%2]: %3 connection(s), %4 B/s, %5 KiB sent, %6 KiB received")
+                             .arg(name, address).arg(connections).arg(rate).arg(sentKiB).arg(receivedKiB);
+            }
+            emit adapters(lines);
+            break;
+        }
+        default:
+            qDebug() << "Link client ignoring frame type" << static_cast<int>(frame.type);
+            break;
+        }
+    }
+    if (decoder.hasError()) {
+        qDebug() << "Link client got a malformed frame, detaching";
+        socket->abort();
+    }
+    return handled;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QStringList>
+#include <vector>
+#include "LinkProtocol.h"
+
+class QLocalSocket;
+
+// Client side of the link service. Signals are emitted on the thread that
+// owns the client, so handlers can touch widgets directly.
+class LinkClient : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LinkClient(QObject *parent = nullptr);
+
+    // Per-user socket name the service listens on
+    static QString serverName();
+
+    // Blocking attach, for the command line tools
+    bool connectToService(int timeoutMs = 1000);
+    // Emits attached() on success; nothing if no service is running
+    void connectToServiceAsync();
+    bool isAttached() const;
+
+    void requestStatus();
+    void startScan(bool pixlOnly = true);
+    void stopScan();
+    void connectDevice(const QString &address);
+    void disconnectDevice();
+    void sendPacket(const std::vector<uint8_t> &packet);
+    void requestAdapters();
+
+    // Blocks until a frame arrives, for the command line tools
+    bool waitForFrame(int timeoutMs);
+
+signals:
+    void attached();
+    void detached();
+    void status(bool connected, const QString &address, const QString &adapter);
+    void deviceFound(const QString &name, const QString &address, int rssi);
+    void deviceConnected(bool ok, const QString &address, const QString &adapter);
+    void deviceDisconnected();
+    void notification(const QByteArray &packet);
+    // One line per adapter the service uses
+    void adapters(const QStringList &lines);
+
+private:
+    void send(LinkProtocol::FrameType type, const std::vector<uint8_t> &body = {});
+    int processFrames();
+
+    QLocalSocket *socket;
+    LinkProtocol::FrameDecoder decoder;
+};
@@ -0,0 +1,41 @@
+#include "LinkProtocol.h"
+
+namespace LinkProtocol {
+
+std::vector<uint8_t> encodeFrame(FrameType type, const std::vector<uint8_t>& body) {
+    uint32_t length = static_cast<uint32_t>(body.size() + 1);
+    std::vector<uint8_t> frame;
+    frame.reserve(4 + length);
+    for (int i = 0; i < 4; ++i) frame.push_back((length >> (8 * i)) & 0xFF);
+    frame.push_back(static_cast<uint8_t>(type));
+    frame.insert(frame.end(), body.begin(), body.end());
+    return frame;
+}
+
+void FrameDecoder::feed(const uint8_t* data, size_t size) {
+    // Compact once the consumed prefix dominates, instead of on every frame
+    if (readPos > 4096 && readPos * 2 > buffer.size()) {
+        buffer.erase(buffer.begin(), buffer.begin() + readPos);
+        readPos = 0;
+    }
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+bool FrameDecoder::next(Frame& frame) {
+    if (error || buffer.size() - readPos < 4) return false;
+
+    const uint8_t* p = buffer.data() + readPos;
+    uint32_t length = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    if (length == 0 || length > MAX_FRAME) {
+        error = true;
+        return false;
+    }
+    if (buffer.size() - readPos - 4 < length) return false;
+
+    frame.type = static_cast<FrameType>(p[4]);
+    frame.body.assign(p + 5, p + 4 + length);
+    readPos += 4 + length;
+    return true;
+}
+
+} // namespace LinkProtocol
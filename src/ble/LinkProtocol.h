@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Wire format between the link service (joymanager --daemon) and its
+// clients over a local socket. Every frame is
+//   uint32 length (little endian, covers type + body)
+//   uint8  type
+//   body
+// Strings in bodies use the same u16-length encoding as Pixl payloads.
+// Packet and Notification bodies are raw Pixl packets, so a client speaks
+// the device protocol unchanged and the service only routes responses back
+// to whoever sent the matching command. Connect binds the client to that
+// device's session; Packet, Disconnect and GetStatus then apply to it.
+namespace LinkProtocol {
+
+constexpr uint32_t VERSION = 1;
+constexpr uint32_t MAX_FRAME = 1024 * 1024;
+
+enum class FrameType : uint8_t {
+    // Client to service
+    Hello = 0x01,        // u32 protocol version
+    StartScan = 0x02,    // u8 Pixl devices only
+    StopScan = 0x03,
+    Connect = 0x04,      // string address
+    Disconnect = 0x05,
+    Packet = 0x06,       // raw Pixl packet to write
+    GetStatus = 0x07,
+    GetAdapters = 0x08,
+
+    // Service to client
+    Status = 0x81,       // u8 connected, string address, string adapter[, string error]
+                         // An error (e.g. a Hello with another version) closes the connection
+    DeviceFound = 0x82,  // string name, string address, i16 rssi
+    Connected = 0x83,    // u8 ok, string address, string adapter
+    Notification = 0x84, // raw Pixl packet notified by the device
+    Disconnected = 0x85,
+    Adapters = 0x86,     // u8 count, then per adapter: string name, string address,
+                         // u16 connections, u32 bytes/s, u32 KiB sent, u32 KiB received
+};
+
+struct Frame {
+    FrameType type;
+    std::vector<uint8_t> body;
+};
+
+std::vector<uint8_t> encodeFrame(FrameType type, const std::vector<uint8_t>& body = {});
+
+// Splits a byte stream back into frames
+class FrameDecoder {
+public:
+    void feed(const uint8_t* data, size_t size);
+    bool next(Frame& frame);
+    bool hasError() const { return error; }
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t readPos = 0;
+    bool error = false;
+};
+
+} // namespace LinkProtocol
@@ -0,0 +1,489 @@
+#include "LinkServer.h"
+#include "LinkClient.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QDebug>
+#include <QTimer>
+#include <algorithm>
+
+using LinkProtocol::FrameType;
+
+namespace {
+
+bool isCacheable(uint8_t cmd) {
+    return cmd == static_cast<uint8_t>(Pixl::Command::GetVersion) ||
+           cmd == static_cast<uint8_t>(Pixl::Command::GetDriveList);
+}
+
+// Anything that can change free space or the drive layout
+bool invalidatesDriveList(uint8_t cmd) {
+    switch (static_cast<Pixl::Command>(cmd)) {
+    case Pixl::Command::DriveFormat:
+    case Pixl::Command::WriteFile:
+    case Pixl::Command::CreateFolder:
+    case Pixl::Command::Remove:
+    case Pixl::Command::Rename:
+    case Pixl::Command::UpdateMeta:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Commands that use the device's file handles
+bool isFileCommand(uint8_t cmd) {
+    switch (static_cast<Pixl::Command>(cmd)) {
+    case Pixl::Command::OpenFile:
+    case Pixl::Command::CloseFile:
+    case Pixl::Command::ReadFile:
+    case Pixl::Command::WriteFile:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void appendString(std::vector<uint8_t> &body, const QString &str) {
+    auto encoded = Pixl::Protocol::createStringPayload(str.toStdString());
+    body.insert(body.end(), encoded.begin(), encoded.end());
+}
+
+void appendUInt(std::vector<uint8_t> &body, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) body.push_back((value >> (8 * i)) & 0xFF);
+}
+
+} // namespace
+
+LinkServer::LinkServer(QObject *parent) : QObject(parent), server(new QLocalServer(this)) {
+    scanner.initialize();
+
+    connect(server, &QLocalServer::newConnection, this, &LinkServer::onNewConnection);
+
+    auto *statsTimer = new QTimer(this);
+    connect(statsTimer, &QTimer::timeout, this, [this]() {
+        if (!sessions.empty()) logAdapterStats();
+    });
+    statsTimer->start(STATS_LOG_INTERVAL_MS);
+}
+
+LinkServer::~LinkServer() {
+    scanner.stopScan();
+    // Sessions disconnect as they are destroyed
+}
+
+bool LinkServer::listen() {
+    const QString name = LinkClient::serverName();
+    // The name is predictable, so only this user may connect; the GUI
+    // attaches on its own and would hand its device traffic to anyone
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!server->listen(name)) {
+        // A stale socket file from a crashed service blocks listen() on Unix
+        QLocalSocket probe;
+        probe.connectToServer(name);
+        if (probe.waitForConnected(500)) {
+            qDebug() << "Link service already running as" << name;
+            return false;
+        }
+        QLocalServer::removeServer(name);
+        if (!server->listen(name)) {
+            qDebug() << "Link service could not listen on" << name << ":" << server->errorString();
+            return false;
+        }
+    }
+    qDebug() << "Link service listening on" << server->fullServerName();
+    return true;
+}
+
+void LinkServer::onNewConnection() {
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        auto client = std::make_unique<Client>();
+        client->socket = socket;
+        Client *c = client.get();
+        clients.push_back(std::move(client));
+
+        connect(socket, &QLocalSocket::readyRead, this, [this, c]() { onReadyRead(c); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, c]() { removeClient(c); });
+    }
+}
+
+void LinkServer::onReadyRead(Client *client) {
+    QByteArray bytes = client->socket->readAll();
+    client->decoder.feed(reinterpret_cast<const uint8_t *>(bytes.constData()), bytes.size());
+
+    LinkProtocol::Frame frame;
+    while (!client->rejected && client->decoder.next(frame)) {
+        handleFrame(client, frame);
+    }
+    if (client->decoder.hasError()) {
+        qDebug() << "Link service dropping client with a malformed frame";
+        client->rejected = true;
+    }
+    // Last, since disconnecting can remove the client right away
+    if (client->rejected) client->socket->disconnectFromServer();
+}
+
+void LinkServer::handleFrame(Client *client, const LinkProtocol::Frame &frame) {
+    switch (frame.type) {
+    case FrameType::Hello: {
+        size_t offset = 0;
+        uint32_t version = Pixl::Protocol::parseUInt32(frame.body, offset);
+        if (version != LinkProtocol::VERSION) {
+            qDebug() << "Link service rejecting a client speaking protocol version" << version;
+            std::vector<uint8_t> body{0};
+            appendString(body, QString());
+            appendString(body, QString());
+            appendString(body, QString("Link protocol version %1 is not supported, the service speaks %2")
+                                   .arg(version).arg(LinkProtocol::VERSION));
+            send(client, FrameType::Status, body);
+            client->rejected = true;
+            break;
+        }
+        [[fallthrough]];
+    }
+    case FrameType::GetStatus: {
+        // A client that hasn't picked a device joins the first connected one,
+        // so a single-device setup starts warm without asking
+        if (!session(client->sessionId)) {
+            auto it = std::find_if(sessions.begin(), sessions.end(), [](const auto &entry) { return entry.second->connected; });
+            client->sessionId = it != sessions.end() ? it->first : 0;
+        }
+        send(client, FrameType::Status, statusBody(session(client->sessionId)));
+        break;
+    }
+    case FrameType::StartScan:
+        client->scanning = true;
+        scanner.setScanFilter(frame.body.empty() || frame.body[0] != 0);
+        scanner.startScan([this](const std::string &name, const std::string &address, int16_t rssi) {
+            std::vector<uint8_t> body;
+            appendString(body, QString::fromStdString(name));
+            appendString(body, QString::fromStdString(address));
+            appendUInt(body, static_cast<uint16_t>(rssi), 2);
+            QMetaObject::invokeMethod(this, [this, body]() {
+                for (auto &c : clients) {
+                    if (c->scanning) send(c.get(), FrameType::DeviceFound, body);
+                }
+            });
+        });
+        break;
+    case FrameType::StopScan:
+        client->scanning = false;
+        if (std::none_of(clients.begin(), clients.end(), [](const auto &c) { return c->scanning; })) {
+            scanner.stopScan();
+        }
+        break;
+    case FrameType::Connect: {
+        size_t offset = 0;
+        connectDevice(client, QString::fromStdString(Pixl::Protocol::parseString(frame.body, offset)));
+        break;
+    }
+    case FrameType::Disconnect:
+        if (Session *s = session(client->sessionId)) {
+            s->bleManager.disconnect();
+        }
+        break;
+    case FrameType::Packet:
+        handlePacket(client, frame.body);
+        break;
+    case FrameType::GetAdapters:
+        send(client, FrameType::Adapters, adaptersBody());
+        break;
+    default:
+        qDebug() << "Link service ignoring frame type" << static_cast<int>(frame.type);
+        break;
+    }
+}
+
+void LinkServer::handlePacket(Client *client, const std::vector<uint8_t> &packet) {
+    if (packet.empty()) return;
+    const uint8_t cmd = packet[0];
+    Session *s = session(client->sessionId);
+    if (packet.size() < 4 || !s || !s->connected) {
+        // Fail it right away rather than leave the client waiting for a timeout
+        send(client, FrameType::Notification, {cmd, 0xFF, 0, 0});
+        return;
+    }
+    dispatchPacket(s, client, packet);
+}
+
+void LinkServer::dispatchPacket(Session *s, Client *client, const std::vector<uint8_t> &packet) {
+    const uint8_t cmd = packet[0];
+    const bool waiting = std::any_of(s->held.begin(), s->held.end(), [client](const auto &e) { return e.first == client; });
+    if (waiting || (isFileCommand(cmd) && s->leased && s->leaseOwner != client)) {
+        s->held.push_back({client, packet});
+        return;
+    }
+
+    // A cached answer can only be served out of order when nothing else from
+    // this client is outstanding, since the client matches responses in order
+    auto cached = s->responseCache.find(cmd);
+    if (cached != s->responseCache.end() && !hasInFlight(s, client)) {
+        for (const auto &notification : cached->second) {
+            send(client, FrameType::Notification, notification);
+        }
+        return;
+    }
+
+    if (invalidatesDriveList(cmd)) {
+        s->responseCache.erase(static_cast<uint8_t>(Pixl::Command::GetDriveList));
+    }
+    if (cmd == static_cast<uint8_t>(Pixl::Command::OpenFile)) {
+        s->leased = true;
+        s->leaseOwner = client;
+        s->leaseOpens++;
+    } else if (cmd == static_cast<uint8_t>(Pixl::Command::CloseFile) && packet.size() > 4) {
+        auto &handles = s->leaseHandles;
+        handles.erase(std::remove(handles.begin(), handles.end(), packet[4]), handles.end());
+    }
+    s->inFlight.push_back({client, cmd});
+    s->bleManager.sendPacket(packet);
+}
+
+void LinkServer::onFileAnswer(Session *s, uint8_t cmd, const std::vector<uint8_t> &data) {
+    if (!s->leased) return;
+    const bool ok = data[1] == 0;
+    if (cmd == static_cast<uint8_t>(Pixl::Command::OpenFile)) {
+        if (!ok || data.size() < 5) {
+            s->leaseOpens--;
+        } else {
+            s->leaseHandles.push_back(data[4]);
+            if (!s->leaseOwner) closeOrphanedFiles(s);
+        }
+    } else if (cmd == static_cast<uint8_t>(Pixl::Command::CloseFile)) {
+        s->leaseOpens--;
+    } else {
+        return;
+    }
+    if (s->leaseOpens <= 0) releaseLease(s);
+}
+
+// The owner went away with files open: close them so the next client can open its own
+void LinkServer::closeOrphanedFiles(Session *s) {
+    for (uint8_t handle : s->leaseHandles) {
+        qDebug() << "Link service closing file handle" << handle << "left open on" << s->address;
+        s->inFlight.push_back({nullptr, static_cast<uint8_t>(Pixl::Command::CloseFile)});
+        s->bleManager.sendPacket(Pixl::Protocol::createPacket(Pixl::Command::CloseFile, {handle}));
+    }
+    s->leaseHandles.clear();
+}
+
+void LinkServer::releaseLease(Session *s) {
+    s->leased = false;
+    s->leaseOwner = nullptr;
+    s->leaseOpens = 0;
+    s->leaseHandles.clear();
+    // In order; the first file command among them takes the next lease
+    auto held = std::move(s->held);
+    s->held.clear();
+    for (auto &entry : held) dispatchPacket(s, entry.first, entry.second);
+}
+
+void LinkServer::removeClient(Client *client) {
+    for (auto &entry : sessions) {
+        Session *s = entry.second.get();
+        for (auto &pending : s->inFlight) {
+            if (pending.client == client) pending.client = nullptr;
+        }
+        auto &held = s->held;
+        held.erase(std::remove_if(held.begin(), held.end(), [client](const auto &e) { return e.first == client; }),
+                   held.end());
+        if (s->leased && s->leaseOwner == client) {
+            s->leaseOwner = nullptr;
+            closeOrphanedFiles(s);
+            if (s->leaseOpens <= 0) releaseLease(s);
+        }
+    }
+    auto it = std::find_if(clients.begin(), clients.end(), [client](const auto &c) { return c.get() == client; });
+    if (it == clients.end()) return;
+    bool wasScanning = client->scanning;
+    client->socket->deleteLater();
+    clients.erase(it);
+
+    if (wasScanning && std::none_of(clients.begin(), clients.end(), [](const auto &c) { return c->scanning; })) {
+        scanner.stopScan();
+    }
+    // Sessions stay connected so the next client starts warm
+}
+
+void LinkServer::connectDevice(Client *client, const QString &address) {
+    if (Session *existing = sessionFor(address)) {
+        client->sessionId = existing->id;
+        if (existing->connected) {
+            std::vector<uint8_t> body{1};
+            appendString(body, existing->address);
+            appendString(body, QString::fromStdString(existing->bleManager.adapterIdentifier()));
+            send(client, FrameType::Connected, body);
+        }
+        // Still connecting: the client hears about it with everyone else
+        return;
+    }
+
+    for (auto &c : clients) c->scanning = false;
+    scanner.stopScan();
+
+    auto created = std::make_shared<Session>();
+    Session *s = created.get();
+    s->id = nextSessionId++;
+    s->address = address;
+    {
+        QMutexLocker lock(&sessionsMutex);
+        sessions[s->id] = std::move(created);
+    }
+    client->sessionId = s->id;
+
+    const int id = s->id;
+    s->bleManager.initialize();
+    s->bleManager.importPeripherals(scanner);
+    // Both callbacks arrive on SimpleBLE threads
+    s->bleManager.setDataReceivedCallback([this, id](const std::vector<uint8_t> &data) {
+        QMetaObject::invokeMethod(this, [this, id, data]() { onNotification(id, data); });
+    });
+    s->bleManager.setDisconnectedCallback([this, id]() {
+        QMetaObject::invokeMethod(this, [this, id]() { onDeviceLost(id); });
+    });
+
+    auto watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, id, address]() {
+        bool ok = watcher->result();
+        watcher->deleteLater();
+        Session *s = session(id);
+        if (!s) return;
+
+        std::vector<uint8_t> body{static_cast<uint8_t>(ok ? 1 : 0)};
+        appendString(body, address);
+        appendString(body, QString::fromStdString(s->bleManager.adapterIdentifier()));
+        qDebug() << "Link service connect to" << address << (ok ? "succeeded on" : "failed")
+                 << (ok ? QString::fromStdString(s->bleManager.adapterIdentifier()) : QString());
+        sendToSession(id, FrameType::Connected, body);
+
+        if (ok) {
+            s->connected = true;
+            logAdapterStats();
+        } else {
+            for (auto &c : clients) {
+                if (c->sessionId == id) c->sessionId = 0;
+            }
+            QMutexLocker lock(&sessionsMutex);
+            sessions.erase(id);
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([this, id, address]() {
+        std::shared_ptr<Session> s;
+        {
+            QMutexLocker lock(&sessionsMutex);
+            auto it = sessions.find(id);
+            if (it != sessions.end()) s = it->second;
+        }
+        return s && s->bleManager.connect(address.toStdString());
+    }));
+}
+
+void LinkServer::onNotification(int sessionId, const std::vector<uint8_t> &data) {
+    Session *s = session(sessionId);
+    if (!s || data.size() < 4) return;
+    const uint8_t cmd = data[0];
+    const bool more = (data[3] & 0x80) != 0;
+
+    auto &inFlight = s->inFlight;
+    auto it = std::find_if(inFlight.begin(), inFlight.end(), [cmd](const InFlight &e) { return e.cmd == cmd; });
+    if (it == inFlight.end()) {
+        qDebug() << "Link service got an unrequested response for command" << cmd << "from" << s->address;
+        return;
+    }
+    // The device answers in order, so anything ahead of the match was lost;
+    // its client notices the same gap when this response arrives
+    inFlight.erase(inFlight.begin(), it);
+
+    Client *owner = inFlight.front().client;
+    if (owner) {
+        send(owner, FrameType::Notification, data);
+    }
+
+    if (isCacheable(cmd)) {
+        auto &pending = s->cachePending[cmd];
+        pending.push_back(data);
+        if (!more) {
+            Pixl::Packet pkt = Pixl::Protocol::parsePacket(data);
+            if (pkt.status == 0) s->responseCache[cmd] = std::move(pending);
+            s->cachePending.erase(cmd);
+        }
+    }
+    if (!more) {
+        inFlight.pop_front();
+        onFileAnswer(s, cmd, data);
+    }
+}
+
+void LinkServer::onDeviceLost(int sessionId) {
+    Session *s = session(sessionId);
+    if (!s || !s->connected) return; // A failed connect is cleaned up by its watcher
+    qDebug() << "Link service lost the device" << s->address;
+    sendToSession(sessionId, FrameType::Disconnected);
+    for (auto &c : clients) {
+        if (c->sessionId == sessionId) c->sessionId = 0;
+    }
+    QMutexLocker lock(&sessionsMutex);
+    sessions.erase(sessionId);
+}
+
+void LinkServer::logAdapterStats() {
+    for (const auto &adapter : BleManager::adapterStats()) {
+        qDebug().noquote() << QString("Adapter %1 [%2]: %3 connection(s), %4 B/s, %5 KiB sent, %6 KiB received")
+            .arg(QString::fromStdString(adapter.identifier), QString::fromStdString(adapter.address))
+            .arg(adapter.connections)
+            .arg(adapter.bytesPerSecond, 0, 'f', 0)
+            .arg(adapter.bytesSent / 1024)
+            .arg(adapter.bytesReceived / 1024);
+    }
+}
+
+LinkServer::Session *LinkServer::session(int id) {
+    auto it = sessions.find(id);
+    return it != sessions.end() ? it->second.get() : nullptr;
+}
+
+LinkServer::Session *LinkServer::sessionFor(const QString &address) {
+    for (auto &entry : sessions) {
+        if (entry.second->address.compare(address, Qt::CaseInsensitive) == 0) return entry.second.get();
+    }
+    return nullptr;
+}
+
+void LinkServer::send(Client *client, FrameType type, const std::vector<uint8_t> &body) {
+    auto frame = LinkProtocol::encodeFrame(type, body);
+    client->socket->write(reinterpret_cast<const char *>(frame.data()), static_cast<qint64>(frame.size()));
+}
+
+void LinkServer::sendToSession(int sessionId, FrameType type, const std::vector<uint8_t> &body) {
+    for (auto &c : clients) {
+        if (c->sessionId == sessionId) send(c.get(), type, body);
+    }
+}
+
+std::vector<uint8_t> LinkServer::statusBody(Session *s) {
+    bool connected = s && s->connected;
+    std::vector<uint8_t> body{static_cast<uint8_t>(connected ? 1 : 0)};
+    appendString(body, connected ? s->address : QString());
+    appendString(body, connected ? QString::fromStdString(s->bleManager.adapterIdentifier()) : QString());
+    return body;
+}
+
+std::vector<uint8_t> LinkServer::adaptersBody() const {
+    auto stats = BleManager::adapterStats();
+    const size_t count = std::min<size_t>(stats.size(), 255);
+    std::vector<uint8_t> body{static_cast<uint8_t>(count)};
+    for (size_t i = 0; i < count; ++i) {
+        appendString(body, QString::fromStdString(stats[i].identifier));
+        appendString(body, QString::fromStdString(stats[i].address));
+        appendUInt(body, static_cast<uint32_t>(stats[i].connections), 2);
+        appendUInt(body, static_cast<uint32_t>(stats[i].bytesPerSecond), 4);
+        appendUInt(body, static_cast<uint32_t>(stats[i].bytesSent / 1024), 4);
+        appendUInt(body, static_cast<uint32_t>(stats[i].bytesReceived / 1024), 4);
+    }
+    return body;
+}
+
+bool LinkServer::hasInFlight(const Session *s, const Client *client) const {
+    return std::any_of(s->inFlight.begin(), s->inFlight.end(), [client](const InFlight &e) { return e.client == client; });
+}
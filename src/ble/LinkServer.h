@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include "BleManager.h"
+#include "LinkProtocol.h"
+
+class QLocalServer;
+class QLocalSocket;
+
+// Background service (joymanager --daemon) that owns the BLE links so they
+// survive the GUI and CLI coming and going. It can hold one session per
+// device, each placed on the least loaded adapter, and every client is
+// bound to one session. Clients send raw Pixl packets; a device answers in
+// order, so each notification goes to the client that sent the oldest
+// outstanding command with the same id on that session. File transfers
+// from different clients take turns on the device's file handles.
+class LinkServer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit LinkServer(QObject *parent = nullptr);
+    ~LinkServer();
+
+    bool listen();
+
+    static constexpr int STATS_LOG_INTERVAL_MS = 30000;
+
+private:
+    struct Session;
+
+    struct Client {
+        QLocalSocket *socket = nullptr;
+        LinkProtocol::FrameDecoder decoder;
+        bool scanning = false;
+        int sessionId = 0; // 0 until bound to a device
+        bool rejected = false; // Dropped once its pending frames are handled
+    };
+    struct InFlight {
+        Client *client; // nullptr once the client has gone away
+        uint8_t cmd;
+    };
+    struct Session {
+        int id;
+        QString address;
+        BleManager bleManager;
+        bool connected = false;
+        std::deque<InFlight> inFlight;
+
+        // GetVersion and GetDriveList answers, replayed to clients that attach
+        // to an already connected device. Packets are kept exactly as notified.
+        std::map<uint8_t, std::vector<std::vector<uint8_t>>> responseCache;
+        std::map<uint8_t, std::vector<std::vector<uint8_t>>> cachePending;
+
+        // The device's file handles are shared by every client, so one client
+        // at a time holds them: from its first OpenFile until its last
+        // CloseFile is answered. Meanwhile other clients' file commands wait
+        // in held, and so does everything those clients send after them,
+        // since a client matches answers in order.
+        bool leased = false;
+        Client *leaseOwner = nullptr; // nullptr if the owner left with files open
+        int leaseOpens = 0; // OpenFiles sent and not yet closed
+        std::vector<uint8_t> leaseHandles; // Opened and not yet being closed
+        std::deque<std::pair<Client *, std::vector<uint8_t>>> held;
+    };
+
+    void onNewConnection();
+    void onReadyRead(Client *client);
+    void handleFrame(Client *client, const LinkProtocol::Frame &frame);
+    void handlePacket(Client *client, const std::vector<uint8_t> &packet);
+    void dispatchPacket(Session *s, Client *client, const std::vector<uint8_t> &packet);
+    void onFileAnswer(Session *s, uint8_t cmd, const std::vector<uint8_t> &data);
+    void closeOrphanedFiles(Session *s);
+    void releaseLease(Session *s);
+    void removeClient(Client *client);
+    void connectDevice(Client *client, const QString &address);
+    void onNotification(int sessionId, const std::vector<uint8_t> &data);
+    void onDeviceLost(int sessionId);
+    void logAdapterStats();
+
+    Session *session(int id);
+    Session *sessionFor(const QString &address);
+    void send(Client *client, LinkProtocol::FrameType type, const std::vector<uint8_t> &body = {});
+    void sendToSession(int sessionId, LinkProtocol::FrameType type, const std::vector<uint8_t> &body = {});
+    std::vector<uint8_t> statusBody(Session *s);
+    std::vector<uint8_t> adaptersBody() const;
+    bool hasInFlight(const Session *s, const Client *client) const;
+
+    QLocalServer *server;
+    BleManager scanner; // Scans for every client; sessions import what it found
+    std::vector<std::unique_ptr<Client>> clients;
+    // Written on the server's thread only, under sessionsMutex so a connect
+    // worker can look its session up. Shared so that worker keeps it alive.
+    std::map<int, std::shared_ptr<Session>> sessions;
+    QMutex sessionsMutex;
+    int nextSessionId = 1;
+};
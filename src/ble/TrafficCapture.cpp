@@ -0,0 +1,117 @@
+#include "TrafficCapture.h"
+#include <chrono>
+#include <cstring>
+
+namespace TrafficCapture {
+
+namespace {
+
+const char MAGIC[8] = {'J', 'M', 'C', 'A', 'P', '0', '1', '\n'};
+
+// Packets are at most a few hundred bytes, so anything bigger means a
+// damaged file rather than a real record
+constexpr uint64_t MAX_RECORD_SIZE = 64 * 1024;
+
+int64_t steadyUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void writeVarint(std::ofstream& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.put(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+} // namespace
+
+Writer::~Writer() {
+    close();
+}
+
+bool Writer::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (out.is_open()) out.close();
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    int64_t unixUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    out.write(MAGIC, sizeof(MAGIC));
+    for (int i = 0; i < 8; ++i) out.put(static_cast<char>((unixUs >> (8 * i)) & 0xFF));
+
+    startUs = steadyUs();
+    lastUs = startUs;
+    return static_cast<bool>(out);
+}
+
+void Writer::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (out.is_open()) out.close();
+}
+
+bool Writer::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return out.is_open();
+}
+
+void Writer::record(Direction direction, const uint8_t* data, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!out.is_open()) return;
+
+    int64_t now = steadyUs();
+    out.put(static_cast<char>(direction));
+    writeVarint(out, static_cast<uint64_t>(now - lastUs));
+    writeVarint(out, size);
+    out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    lastUs = now;
+}
+
+bool Reader::open(const std::string& path) {
+    in.open(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(MAGIC)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        in.close();
+        return false;
+    }
+    unsigned char stamp[8];
+    if (!in.read(reinterpret_cast<char*>(stamp), sizeof(stamp))) return false;
+    startUnixUs = 0;
+    for (int i = 0; i < 8; ++i) startUnixUs |= static_cast<int64_t>(stamp[i]) << (8 * i);
+    currentUs = 0;
+    return true;
+}
+
+bool Reader::readVarint(uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return false;
+        value |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool Reader::next(Record& record) {
+    int direction = in.get();
+    if (direction == EOF || direction > 1) return false;
+
+    uint64_t delta = 0, size = 0;
+    if (!readVarint(delta) || !readVarint(size) || size > MAX_RECORD_SIZE) return false;
+
+    record.direction = static_cast<Direction>(direction);
+    currentUs += static_cast<int64_t>(delta);
+    record.timestampUs = currentUs;
+    record.data.resize(size);
+    if (size > 0 && !in.read(reinterpret_cast<char*>(record.data.data()), static_cast<std::streamsize>(size))) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace TrafficCapture
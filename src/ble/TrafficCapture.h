@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Compact binary log of the BLE traffic with one device.
+//
+// File layout: the 8 byte magic "JMCAP01\n", the capture start time as
+// unix microseconds (8 bytes, little endian), then one record per packet:
+//   uint8  direction (0 = host to device, 1 = device to host)
+//   varint microseconds since the previous record
+//   varint packet length
+//   bytes  packet, exactly as written to RX or notified on TX
+namespace TrafficCapture {
+
+enum class Direction : uint8_t { Sent = 0, Received = 1 };
+
+struct Record {
+    Direction direction;
+    int64_t timestampUs; // Since the start of the capture
+    std::vector<uint8_t> data;
+};
+
+class Writer {
+public:
+    ~Writer();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Safe to call from the notify thread and the GUI thread at once
+    void record(Direction direction, const uint8_t* data, size_t size);
+
+private:
+    mutable std::mutex mutex;
+    std::ofstream out;
+    int64_t startUs = 0;
+    int64_t lastUs = 0;
+};
+
+class Reader {
+public:
+    bool open(const std::string& path);
+    bool next(Record& record);
+    int64_t startTimeUnixUs() const { return startUnixUs; }
+
+private:
+    bool readVarint(uint64_t& value);
+
+    std::ifstream in;
+    int64_t startUnixUs = 0;
+    int64_t currentUs = 0;
+};
+
+} // namespace TrafficCapture
@@ -0,0 +1,163 @@
+#include "Tracer.h"
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    char phase;         // 'X' complete, 'b'/'e' async begin/end
+    int64_t tsUs;
+    int64_t durUs;
+    uint32_t tid;
+    uint64_t id;
+    std::string detail;
+};
+
+struct ThreadName {
+    uint32_t tid;
+    std::string name;
+};
+
+std::mutex traceMutex;
+std::vector<TraceEvent> events;
+std::vector<ThreadName> threadNames;
+size_t droppedEvents = 0;
+std::atomic<uint32_t> nextTid{1};
+std::atomic<uint64_t> nextAsyncId{1};
+const auto traceEpoch = std::chrono::steady_clock::now();
+
+uint32_t currentTid() {
+    // Small stable ids read better in the viewer than native thread handles
+    thread_local uint32_t tid = nextTid.fetch_add(1);
+    return tid;
+}
+
+void record(TraceEvent&& event) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (events.size() >= Tracer::MAX_EVENTS) {
+        droppedEvents++;
+        return;
+    }
+    events.push_back(std::move(event));
+}
+
+void writeEscaped(std::ofstream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+                else out << c;
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::active{false};
+
+void Tracer::start() {
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        events.clear();
+        events.reserve(64 * 1024);
+        droppedEvents = 0;
+    }
+    active.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::stop() {
+    active.store(false, std::memory_order_relaxed);
+}
+
+size_t Tracer::eventCount() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    return events.size();
+}
+
+int64_t Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+void Tracer::setThreadName(const char* name) {
+    // Hot paths (every BLE notification) name their thread on each call;
+    // only the first call per thread and name takes the lock. Names are
+    // literals, so the pointer identifies them.
+    thread_local const char* named = nullptr;
+    if (named == name) return;
+    named = name;
+    uint32_t tid = currentTid();
+    std::lock_guard<std::mutex> lock(traceMutex);
+    for (auto& t : threadNames) {
+        if (t.tid == tid) {
+            t.name = name;
+            return;
+        }
+    }
+    threadNames.push_back({tid, name});
+}
+
+void Tracer::complete(const char* name, const char* category, int64_t startUs, int64_t durationUs,
+                      const std::string& detail) {
+    if (!enabled()) return;
+    record({name, category, 'X', startUs, durationUs, currentTid(), 0, detail});
+}
+
+uint64_t Tracer::asyncBegin(const char* name, const char* category, const std::string& detail) {
+    if (!enabled()) return 0;
+    uint64_t id = nextAsyncId.fetch_add(1);
+    record({name, category, 'b', now(), 0, currentTid(), id, detail});
+    return id;
+}
+
+void Tracer::asyncEnd(const char* name, const char* category, uint64_t id) {
+    if (!enabled() || id == 0) return;
+    record({name, category, 'e', now(), 0, currentTid(), id, std::string()});
+}
+
+bool Tracer::writeJson(const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << droppedEvents << "},\"traceEvents\":[\n";
+
+    bool first = true;
+    for (const auto& t : threadNames) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << t.tid << ",\"args\":{\"name\":";
+        writeEscaped(out, t.name);
+        out << "}}";
+    }
+
+    for (const auto& e : events) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"ph\":\"" << e.phase << "\",\"name\":";
+        writeEscaped(out, e.name);
+        out << ",\"cat\":";
+        writeEscaped(out, e.category);
+        out << ",\"pid\":1,\"tid\":" << e.tid << ",\"ts\":" << e.tsUs;
+        if (e.phase == 'X') out << ",\"dur\":" << e.durUs;
+        if (e.phase != 'X') out << ",\"id\":" << e.id;
+        if (!e.detail.empty()) {
+            out << ",\"args\":{\"detail\":";
+            writeEscaped(out, e.detail);
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
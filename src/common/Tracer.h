@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Opt-in timeline recorder writing Chrome trace-event JSON (loads in
+// chrome://tracing and Perfetto). While disabled every call is a single
+// relaxed atomic load, so the hooks can stay in the hot paths.
+//
+// Names and categories must be string literals; only the optional detail
+// string is copied.
+class Tracer {
+public:
+    // Hard cap so a forgotten trace can't eat all memory
+    static constexpr size_t MAX_EVENTS = 2000000;
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    static void start();
+    static void stop();
+    static bool writeJson(const std::string& path);
+    static size_t eventCount();
+
+    // Microseconds on the trace clock
+    static int64_t now();
+
+    // Names the calling thread in the trace (e.g. "GUI", "BLE notify")
+    static void setThreadName(const char* name);
+
+    // A finished span on the calling thread
+    static void complete(const char* name, const char* category, int64_t startUs, int64_t durationUs,
+                         const std::string& detail = std::string());
+
+    // Spans that may overlap on one thread, like pipelined round trips
+    static uint64_t asyncBegin(const char* name, const char* category, const std::string& detail = std::string());
+    static void asyncEnd(const char* name, const char* category, uint64_t id);
+
+private:
+    static std::atomic<bool> active;
+};
+
+// Records the enclosing scope as a span when tracing is on
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const char* category)
+        : name(name), category(category), startUs(Tracer::enabled() ? Tracer::now() : -1) {}
+    ~TraceSpan() {
+        if (startUs >= 0 && Tracer::enabled()) {
+            Tracer::complete(name, category, startUs, Tracer::now() - startUs);
+        }
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    int64_t startUs;
+};
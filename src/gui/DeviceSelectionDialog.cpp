@@ -1,68 +1,171 @@
 #include "DeviceSelectionDialog.h"
+#include <QHeaderView>
+#include <QTimer>
+#include <QFont>
+
+namespace {
+
+// Sorts the Signal and Last Seen columns by their stored numbers rather
+// than their text
+class DeviceItem : public QTreeWidgetItem {
+public:
+    using QTreeWidgetItem::QTreeWidgetItem;
+
+    bool operator<(const QTreeWidgetItem &other) const override {
+        int column = treeWidget() ? treeWidget()->sortColumn() : 0;
+        if (column == 2 || column == 3) {
+            return data(column, Qt::UserRole + 2).toLongLong() < other.data(column, Qt::UserRole + 2).toLongLong();
+        }
+        return QTreeWidgetItem::operator<(other);
+    }
+};
+
+} // namespace
 
 DeviceSelectionDialog::DeviceSelectionDialog(QWidget *parent) : QDialog(parent) {
     setWindowTitle("Select Pixl.js Device");
-    resize(400, 300);
+    resize(520, 320);
 
     auto *layout = new QVBoxLayout(this);
-    
+
     layout->addWidget(new QLabel("Devices Found:", this));
-    
-    deviceList = new QListWidget(this);
+
+    deviceList = new QTreeWidget(this);
+    deviceList->setHeaderLabels({"Name", "Address", "Signal", "Last Seen"});
+    deviceList->setRootIsDecorated(false);
+    deviceList->setUniformRowHeights(true);
+    deviceList->header()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+    deviceList->setSortingEnabled(true);
+    deviceList->sortByColumn(SignalColumn, Qt::DescendingOrder); // Nearest first
     layout->addWidget(deviceList);
-    
+
+    auto *scanLayout = new QHBoxLayout();
+    pixlOnlyBox = new QCheckBox("Pixl devices only", this);
+    pixlOnlyBox->setChecked(true);
     scanButton = new QPushButton("Rescan", this);
-    layout->addWidget(scanButton);
-    
+    scanLayout->addWidget(pixlOnlyBox);
+    scanLayout->addStretch();
+    scanLayout->addWidget(scanButton);
+    layout->addLayout(scanLayout);
+
     auto *btnLayout = new QHBoxLayout();
     cancelButton = new QPushButton("Cancel", this);
     connectButton = new QPushButton("Connect", this);
     connectButton->setEnabled(false);
-    
+
     btnLayout->addWidget(cancelButton);
     btnLayout->addWidget(connectButton);
     layout->addLayout(btnLayout);
 
-    connect(deviceList, &QListWidget::itemSelectionChanged, [this]() {
+    clock.start();
+    flushTimer = new QTimer(this);
+    flushTimer->setInterval(FLUSH_INTERVAL_MS);
+    connect(flushTimer, &QTimer::timeout, this, &DeviceSelectionDialog::flush);
+    flushTimer->start();
+
+    connect(deviceList, &QTreeWidget::itemSelectionChanged, [this]() {
         connectButton->setEnabled(!deviceList->selectedItems().isEmpty());
     });
-    
-    connect(deviceList, &QListWidget::itemDoubleClicked, [this](QListWidgetItem *item) {
-        selectedAddress = item->data(Qt::UserRole).toString();
-        accept();
+
+    connect(deviceList, &QTreeWidget::itemDoubleClicked, [this](QTreeWidgetItem *item) {
+        choose(item);
     });
 
     connect(connectButton, &QPushButton::clicked, [this]() {
         if (!deviceList->selectedItems().isEmpty()) {
-            selectedAddress = deviceList->selectedItems().first()->data(Qt::UserRole).toString();
-            accept();
+            choose(deviceList->selectedItems().first());
         }
     });
 
     connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
-    
+
     connect(scanButton, &QPushButton::clicked, this, &DeviceSelectionDialog::scanRequested);
+    connect(pixlOnlyBox, &QCheckBox::toggled, this, &DeviceSelectionDialog::scanRequested);
 }
 
-void DeviceSelectionDialog::addDevice(const QString& name, const QString& address) {
-    // Check if exists
-    for(int i=0; i<deviceList->count(); ++i) {
-        if (deviceList->item(i)->data(Qt::UserRole).toString() == address) {
-            return;
-        }
+void DeviceSelectionDialog::addDevice(const QString& name, const QString& address, int rssi) {
+    const QString key = address.toUpper();
+    Device &device = devices[key];
+    device.address = device.address.isEmpty() ? address : device.address;
+    if (!name.isEmpty()) device.name = name;
+    device.rssi = rssi;
+    device.lastSeenMs = clock.elapsed();
+    dirty.insert(key);
+}
+
+void DeviceSelectionDialog::addKnownDevice(const QString& name, const QString& address) {
+    const QString key = address.toUpper();
+    Device &device = devices[key];
+    if (device.address.isEmpty()) device.address = address;
+    if (device.name.isEmpty()) device.name = name;
+    device.known = true;
+    dirty.insert(key);
+    flush();
+}
+
+void DeviceSelectionDialog::flush() {
+    // Ages change even without new advertisements
+    qint64 now = clock.elapsed();
+    bool refreshAges = now - lastAgeRefreshMs >= 1000;
+    if (dirty.isEmpty() && !refreshAges) return;
+
+    // One resort per batch instead of one per advertisement
+    deviceList->setSortingEnabled(false);
+    if (refreshAges) {
+        lastAgeRefreshMs = now;
+        for (auto &device : devices) updateItem(device);
+    } else {
+        for (const QString &key : dirty) updateItem(devices[key]);
+    }
+    dirty.clear();
+    deviceList->setSortingEnabled(true);
+}
+
+void DeviceSelectionDialog::updateItem(Device &device) {
+    if (!device.item) {
+        device.item = new DeviceItem(deviceList);
+        device.item->setData(0, Qt::UserRole, device.address);
     }
-    
-    QString label = name.isEmpty() ? "Unknown Device" : name;
-    label += " [" + address + "]";
-    
-    QListWidgetItem *item = new QListWidgetItem(label, deviceList);
-    item->setData(Qt::UserRole, address);
+    QTreeWidgetItem *item = device.item;
+
+    item->setText(NameColumn, device.name.isEmpty() ? "Unknown Device" : device.name);
+    item->setData(0, Qt::UserRole + 1, device.name);
+    item->setText(AddressColumn, device.address + (device.known ? " (saved)" : ""));
+
+    bool seen = device.lastSeenMs >= 0;
+    item->setText(SignalColumn, seen ? QString("%1 dBm").arg(device.rssi) : QString("-"));
+    item->setData(SignalColumn, Qt::UserRole + 2, seen ? device.rssi : NO_SIGNAL);
+
+    qint64 age = seen ? (clock.elapsed() - device.lastSeenMs) / 1000 : -1;
+    item->setText(SeenColumn, !seen ? QString("not seen") : age == 0 ? QString("now") : QString("%1 s ago").arg(age));
+    item->setData(SeenColumn, Qt::UserRole + 2, seen ? -age : -1000000);
+
+    // Known devices stay italic until the scan sees them
+    QFont font = item->font(NameColumn);
+    font.setItalic(device.known && !seen);
+    for (int column = 0; column < deviceList->columnCount(); ++column) item->setFont(column, font);
+}
+
+void DeviceSelectionDialog::choose(QTreeWidgetItem *item) {
+    selectedAddress = item->data(0, Qt::UserRole).toString();
+    selectedName = item->data(0, Qt::UserRole + 1).toString();
+    accept();
 }
 
 QString DeviceSelectionDialog::getSelectedAddress() const {
     return selectedAddress;
 }
 
+QString DeviceSelectionDialog::getSelectedName() const {
+    return selectedName;
+}
+
 void DeviceSelectionDialog::clearDevices() {
     deviceList->clear();
+    devices.clear();
+    dirty.clear();
+}
+
+bool DeviceSelectionDialog::pixlOnly() const {
+    return pixlOnlyBox->isChecked();
 }
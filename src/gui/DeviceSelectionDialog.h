@@ -1,27 +1,67 @@
 #pragma once
 
 #include <QDialog>
-#include <QListWidget>
+#include <QTreeWidget>
 #include <QPushButton>
+#include <QCheckBox>
 #include <QVBoxLayout>
 #include <QLabel>
+#include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
+
+class QTimer;
 
 class DeviceSelectionDialog : public QDialog {
     Q_OBJECT
 
 public:
     explicit DeviceSelectionDialog(QWidget *parent = nullptr);
-    void addDevice(const QString& name, const QString& address);
+
+    // Called once per advertisement. Cheap: the list is only touched when
+    // the next batch is flushed.
+    void addDevice(const QString& name, const QString& address, int rssi);
+    // Remembered device, listed before the scan finds anything. Connecting
+    // to one does not need it to show up in this scan.
+    void addKnownDevice(const QString& name, const QString& address);
     QString getSelectedAddress() const;
+    QString getSelectedName() const;
     void clearDevices();
+    bool pixlOnly() const;
+
+    static constexpr int FLUSH_INTERVAL_MS = 300;
+    static constexpr int NO_SIGNAL = -1000; // Sorts below any real RSSI
 
 signals:
     void scanRequested();
 
 private:
-    QListWidget *deviceList;
+    enum Column { NameColumn, AddressColumn, SignalColumn, SeenColumn };
+
+    struct Device {
+        QString name;
+        QString address;
+        int rssi = NO_SIGNAL;
+        qint64 lastSeenMs = -1; // On `clock`; -1 if only known from settings
+        bool known = false;
+        QTreeWidgetItem *item = nullptr;
+    };
+
+    void flush();
+    void updateItem(Device &device);
+    void choose(QTreeWidgetItem *item);
+
+    QTreeWidget *deviceList;
     QPushButton *connectButton;
     QPushButton *cancelButton;
     QPushButton *scanButton;
+    QCheckBox *pixlOnlyBox;
     QString selectedAddress;
+    QString selectedName;
+
+    QHash<QString, Device> devices; // Keyed by upper-case address
+    QSet<QString> dirty;
+    QTimer *flushTimer;
+    QElapsedTimer clock;
+    qint64 lastAgeRefreshMs = 0;
 };
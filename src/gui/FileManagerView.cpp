@@ -1,9 +1,30 @@
 #include "FileManagerView.h"
 #include "RemoteFileSystemModel.h"
 #include "../ble/BleManager.h"
+#include "../ble/LinkClient.h"
+#include "../protocol/ResponseAssembler.h"
+#include "../transfer/UploadSource.h"
+#include "../transfer/TransferMetrics.h"
+#include "../common/Tracer.h"
+#include "../transfer/StartupReport.h"
+#include "../transfer/StreamCopy.h"
+#include "../transfer/ArchiveReader.h"
+#include "../transfer/TarWriter.h"
+#include "../transfer/FolderMirror.h"
+#include "../transfer/HashIndex.h"
+#include "../transfer/LoadPlan.h"
+#include "../transfer/UploadPlan.h"
+#include "../protocol/AmiiboHeader.h"
+#include "../protocol/FirmwareProfile.h"
+#include "HeaderCache.h"
 #include <QHeaderView>
+#include <QScrollBar>
 #include <QMessageBox>
 #include <QInputDialog>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QHBoxLayout>
+#include <QSignalBlocker>
 #include <QMenu>
 #include <QFile>
 #include <QFileInfo>
@@ -14,11 +35,24 @@
 #include <QFileDialog>
 #include <QDragMoveEvent>
 #include <QDir>
+#include <QSet>
+#include <QHash>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 #include <deque>
+#include <algorithm>
+#include <functional>
 #include "DeviceSelectionDialog.h"
 #include <QtConcurrent>
 #include <QFutureWatcher>
 #include <QSettings>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QHeaderView>
 
 // Forward declaration if needed, but we included headers.
@@ -29,32 +63,455 @@ public:
     BleManager bleManager;
     RemoteFileSystemModel *remoteModel;
     QString lastRequestedPath;
-    std::vector<uint8_t> responseBuffer;
+    TransferMetrics metrics;
+
+    // Set when a link service owns the device; bleManager then forwards
+    // packets through it instead of talking to SimpleBLE
+    LinkClient *link = nullptr;
+    bool linkConnectPending = false;
+
+    // Adapter enumeration can take seconds, so it runs off the startup path.
+    // Anything that scans or connects directly waits for it first.
+    QFuture<void> bleInit;
+
+    void ensureBleInitialized() {
+        if (bleInit.isRunning()) {
+            TraceSpan span("waitBleInit", "ble");
+            bleInit.waitForFinished();
+        }
+    }
+
+    // Devices we connected to before, most recent first, so they can be
+    // reached by address without waiting for a full scan
+    static constexpr int MAX_KNOWN_DEVICES = 8;
+    QString connectingName;
+
+    std::vector<std::pair<QString, QString>> knownDevices() const {
+        std::vector<std::pair<QString, QString>> devices; // address, name
+        QSettings settings("Joysfusion", "JoyManager");
+        int count = settings.beginReadArray("knownDevices");
+        for (int i = 0; i < count; ++i) {
+            settings.setArrayIndex(i);
+            devices.emplace_back(settings.value("address").toString(), settings.value("name").toString());
+        }
+        settings.endArray();
+        return devices;
+    }
+
+    void addKnownDevices(DeviceSelectionDialog& dialog) const {
+        for (const auto &device : knownDevices()) {
+            dialog.addKnownDevice(device.second, device.first);
+        }
+    }
+
+    void rememberDevice(const QString& address, const QString& name) {
+        auto devices = knownDevices();
+        QString keptName = name;
+        for (auto it = devices.begin(); it != devices.end(); ++it) {
+            if (it->first.compare(address, Qt::CaseInsensitive) == 0) {
+                if (keptName.isEmpty()) keptName = it->second;
+                devices.erase(it);
+                break;
+            }
+        }
+        devices.insert(devices.begin(), {address, keptName});
+        if (devices.size() > MAX_KNOWN_DEVICES) devices.resize(MAX_KNOWN_DEVICES);
+
+        QSettings settings("Joysfusion", "JoyManager");
+        settings.beginWriteArray("knownDevices", static_cast<int>(devices.size()));
+        for (size_t i = 0; i < devices.size(); ++i) {
+            settings.setArrayIndex(static_cast<int>(i));
+            settings.setValue("address", devices[i].first);
+            settings.setValue("name", devices[i].second);
+        }
+        settings.endArray();
+    }
+
+    // Auto-reconnect. reconnectAddress is the device to go back to after an
+    // unexpected disconnect; it is cleared when the user disconnects.
+    static constexpr int MAX_RECONNECT_ATTEMPTS = 6;
+    bool autoReconnect = false;
+    QString reconnectAddress;
+    int reconnectAttempts = 0;
+    QString restorePath; // Remote folder to reopen once the drive list is back
 
     FileManagerViewPrivate(FileManagerView *parent) : q(parent) {}
 
-    enum class OpType { CreateFolder, UploadFile, DownloadFile, DeleteFile };
+    // Every command we send gets one response, in order. Each outstanding
+    // request owns its own assembler so chunks can't bleed between commands.
+    // If onComplete is set it handles the finished response (status, payload)
+    // instead of the per-command handling in handleBleData. If onChunk is set
+    // too, each chunk is handed over as it arrives instead of being assembled.
+    using CompletionHandler = std::function<void(const Pixl::Packet& pkt, const std::vector<uint8_t>& payload, bool corrupt)>;
+    using ChunkHandler = std::function<void(const std::vector<uint8_t>& data)>;
+    struct PendingRequest {
+        Pixl::Command cmd;
+        QString path; // Directory for ReadDir, so the listing lands on the right node
+        Pixl::ResponseAssembler assembler;
+        CompletionHandler onComplete;
+        ChunkHandler onChunk;
+        qint64 sentAtNs = 0;
+        uint64_t traceId = 0;
+        bool retried = false;
+    };
+
+    static const char* traceName(Pixl::Command cmd) {
+        const char* name = Pixl::Protocol::commandName(static_cast<uint8_t>(cmd));
+        return name ? name : "Unknown";
+    }
+    std::deque<PendingRequest> pendingRequests;
+    Pixl::BufferPool bufferPool;
+
+    void sendRequest(Pixl::Command cmd, const std::vector<uint8_t>& payload = {},
+                     const QString& path = QString(), size_t expectedSize = 0,
+                     CompletionHandler onComplete = nullptr, ChunkHandler onChunk = nullptr) {
+        if (!bleManager.isConnected()) return;
+        // Real traffic always wins over prefetching
+        if (!prefetchSending && prefetchTimer) prefetchTimer->stop();
+        PendingRequest req{cmd, path, {}, std::move(onComplete), std::move(onChunk)};
+        req.assembler.begin(bufferPool, expectedSize, !req.onChunk);
+        req.sentAtNs = metrics.recordSent(cmd, payload.size() + 4, pendingRequests.size() + 1);
+        if (Tracer::enabled()) {
+            req.traceId = Tracer::asyncBegin(traceName(cmd), "roundtrip", path.toStdString());
+        }
+        pendingRequests.push_back(std::move(req));
+        bleManager.sendCommand(cmd, payload);
+    }
+
+    // Finds the request a response belongs to. Requests queued ahead of it
+    // that never got an answer are failed, so whatever waits on them moves on.
+    PendingRequest* matchRequest(uint8_t cmd) {
+        return matchRequest(pendingRequests, cmd);
+    }
+
+    PendingRequest* matchRequest(std::deque<PendingRequest>& queue, uint8_t cmd) {
+        auto it = std::find_if(queue.begin(), queue.end(), [cmd](const PendingRequest& r) {
+            return static_cast<uint8_t>(r.cmd) == cmd;
+        });
+        if (it == queue.end()) return nullptr;
+        if (it != queue.begin()) {
+            qDebug() << "Dropping" << std::distance(queue.begin(), it) << "unanswered request(s)";
+            std::vector<PendingRequest> dropped(std::make_move_iterator(queue.begin()),
+                                                std::make_move_iterator(it));
+            queue.erase(queue.begin(), it);
+            for (auto& req : dropped) {
+                if (&queue == &pendingRequests) {
+                    metrics.recordDropped(req.cmd);
+                    Tracer::asyncEnd(traceName(req.cmd), "roundtrip", req.traceId);
+                }
+                failRequest(req);
+            }
+        }
+        return &queue.front();
+    }
+
+    void failRequest(PendingRequest& req) {
+        if (req.onComplete) {
+            Pixl::Packet pkt{static_cast<uint8_t>(req.cmd), 0xFF, 0, {}};
+            req.onComplete(pkt, {}, true);
+            return;
+        }
+        switch (req.cmd) {
+            case Pixl::Command::Rename:
+            case Pixl::Command::Remove:
+            case Pixl::Command::CreateFolder:
+                finishPipelinedOperation();
+                break;
+            case Pixl::Command::OpenFile:
+            case Pixl::Command::ReadFile:
+            case Pixl::Command::WriteFile:
+            case Pixl::Command::CloseFile:
+                processNextOperation();
+                break;
+            default:
+                break;
+        }
+    }
+
+    enum class OpType { CreateFolder, UploadFile, DownloadFile, DeleteFile, Rename };
     struct Operation {
         OpType type;
         QString source;
         QString target;
+        uint32_t size = 0; // Remote size for downloads, used to pre-size the read buffer
+        // Uploads straight out of an archive: the entry to decompress
+        std::shared_ptr<ArchiveReader> archive;
+        int entry = -1;
     };
 
     std::deque<Operation> opQueue;
     QProgressDialog *progressDialog = nullptr;
     int totalOps = 0;
     int completedOps = 0;
-    bool isProcessing = false;
+
+    // File transfers hold the device's file handle, so only one runs at a
+    // time. Single round-trip ops don't depend on each other's results and
+    // the device answers in order (a folder exists before anything sent after
+    // it goes in), so up to PIPELINE_DEPTH of them are kept in flight
+    // alongside it.
+    static constexpr int PIPELINE_DEPTH = 8;
+    bool transferActive = false;
+    int opsInFlight = 0;
+
+    // Recursive remote walk. Several ReadDirs stay in flight and run
+    // alongside the transfer queue, so files found early start moving while
+    // deeper folders are still being listed.
+    static constexpr int WALK_DEPTH = 4;
+    struct WalkDir {
+        QString remote;
+        QString local; // Local mirror (or copy destination) of this folder, if the walk needs one
+        // Called once per folder; ok is false if its listing failed
+        std::function<void(const WalkDir& dir, const std::vector<Pixl::FileEntry>& entries, bool ok)> visit;
+    };
+    std::deque<WalkDir> walkQueue;
+    int walksInFlight = 0;
+    int walkGeneration = 0; // Bumped on cancel so late listings are ignored
+
+    static bool isPipelined(OpType type) {
+        return type == OpType::Rename || type == OpType::DeleteFile || type == OpType::CreateFolder;
+    }
+
+    static QString remoteJoin(const QString& dir, const QString& name) {
+        return dir + (dir.endsWith("/") ? "" : "/") + name;
+    }
+
+    // Drops the trailing slash, except on a drive root like "E:/"
+    static QString remoteNormalize(const QString& path) {
+        QString trimmed = path;
+        if (trimmed.endsWith("/") && trimmed.length() > 3) trimmed.chop(1);
+        return trimmed;
+    }
+
+    static QString remoteParent(const QString& path) {
+        QString trimmed = remoteNormalize(path);
+        int slash = trimmed.lastIndexOf('/');
+        if (slash < 0) return "/";
+        QString parent = trimmed.left(slash);
+        if (parent.endsWith(":")) parent += "/"; // Keep drive root as "E:/"
+        return parent;
+    }
+
+    // Idle-time prefetch: once the link has been quiet for PREFETCH_IDLE_MS,
+    // list the unlisted subfolders of the folder being viewed, one ReadDir
+    // at a time, so opening one is instant. Any other request cancels the
+    // pending prefetch; the one already in flight costs at most a round trip.
+    static constexpr int PREFETCH_IDLE_MS = 250;
+    static constexpr size_t PREFETCH_MEMORY_BUDGET = 4 * 1024 * 1024;
+    QTimer *prefetchTimer = nullptr;
+    bool prefetchSending = false;
+    bool prefetchOverBudget = false;
+
+    void schedulePrefetch() {
+        if (prefetchTimer && pendingRequests.empty() && isIdle()) {
+            prefetchTimer->start(crawling ? CRAWL_IDLE_MS : PREFETCH_IDLE_MS);
+        }
+    }
+
+    void prefetchNext() {
+        if (!bleManager.isConnected() || bleManager.isReplaying()) return;
+        if (!pendingRequests.empty() || !isIdle()) return; // Rescheduled when traffic settles
+        if (remoteModel->approximateMemory() >= PREFETCH_MEMORY_BUDGET) {
+            if (!prefetchOverBudget) qDebug() << "Prefetch paused: remote tree is over its memory budget";
+            prefetchOverBudget = true;
+            if (crawling) crawlNext();
+            return;
+        }
+        prefetchOverBudget = false;
+
+        for (const QString& path : remoteModel->unfetchedSubdirs(q->remoteView->rootIndex())) {
+            if (!remoteModel->beginFetch(path)) continue;
+            TraceSpan span("prefetch", "gui");
+            auto payload = Pixl::Protocol::createStringPayload(path.toStdString());
+            prefetchSending = true;
+            sendRequest(Pixl::Command::ReadDir, payload, path, 0,
+                        [this, path](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                if (corrupt || pkt.status != 0) {
+                    remoteModel->abortFetch(path);
+                    return;
+                }
+                remoteModel->onDirectoryListing(path, Pixl::Protocol::parseDirEntries(data));
+            });
+            prefetchSending = false;
+            return;
+        }
+        if (crawling) crawlNext();
+    }
+
+    // Whole-device crawl for the search index. It takes the prefetch slot
+    // once the folder on screen is done, one listing at a time with only a
+    // short gap, and ignores the prefetch budget since the user asked for it.
+    static constexpr int CRAWL_IDLE_MS = 10;
+    bool crawling = false;
+    std::deque<QString> crawlQueue;
+    QSet<QString> crawlSkipped; // Folders that failed to list
+
+    void crawlNext() {
+        if (remoteModel->rowCount() == 0) return; // Drives not listed yet
+        for (int pass = 0; pass < 2; ++pass) {
+            while (!crawlQueue.empty()) {
+                QString path = crawlQueue.front();
+                crawlQueue.pop_front();
+                if (!remoteModel->beginFetch(path)) continue; // Listed some other way meanwhile
+                auto payload = Pixl::Protocol::createStringPayload(path.toStdString());
+                prefetchSending = true;
+                sendRequest(Pixl::Command::ReadDir, payload, path, 0,
+                            [this, path](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                    if (corrupt || pkt.status != 0) {
+                        qDebug() << "Crawl could not list" << path << "with status:" << pkt.status;
+                        remoteModel->abortFetch(path);
+                        crawlSkipped.insert(path);
+                        return;
+                    }
+                    auto entries = Pixl::Protocol::parseDirEntries(data);
+                    remoteModel->onDirectoryListing(path, entries);
+                    for (const auto& entry : entries) {
+                        if (entry.type == 1) crawlQueue.push_back(remoteJoin(path, QString::fromStdString(entry.name)));
+                    }
+                });
+                prefetchSending = false;
+                return;
+            }
+            // Pick up folders that appeared through other listings
+            for (const QString& path : remoteModel->unfetchedFolders()) {
+                if (!crawlSkipped.contains(path)) crawlQueue.push_back(path);
+            }
+        }
+        qDebug() << "Crawl finished:" << remoteModel->searchIndex().size() << "entries indexed";
+        crawling = false;
+        emit q->crawlFinished();
+    }
 
     // Current File State
-    std::unique_ptr<QFile> currentFile;
+    OpType currentOpType = OpType::CreateFolder;
+    std::unique_ptr<QFile> currentFile; // Download target
+    UploadSource uploadSource;
+    std::vector<uint8_t> chunkPayload; // Reused for every WriteFile
     qint64 currentOffset = 0;
+    qint64 currentChunk = 0; // Bytes in the WriteFile in flight; short at block and file ends
+    uint32_t currentDownloadSize = 0;
+    Operation currentUpload;
     uint8_t currentFileId = 0;
-    static constexpr int CHUNK_SIZE = 200;
+    static constexpr int CHUNK_SIZE = Pixl::FirmwareProfile::BASE_CHUNK;
+    static constexpr int WRITE_OVERHEAD = 3 + 4 + 1; // ATT header, packet header, file id
+
+    // What the connected firmware can do, from its GetVersion reply. Writes
+    // to it carry chunkSize bytes, more than CHUNK_SIZE if it takes them.
+    Pixl::FirmwareProfile firmware;
+    int chunkSize = CHUNK_SIZE;
 
+    void applyFirmware(const Pixl::FirmwareProfile& profile) {
+        firmware = profile;
+        chunkSize = firmware.maxChunk;
+        // A write without response can't be split over several ATT packets,
+        // so it's only used when a whole baseline WriteFile fits one
+        uint16_t mtu = bleManager.mtu();
+        bool commands = firmware.writeWithoutResponse && mtu >= CHUNK_SIZE + WRITE_OVERHEAD;
+        if (commands) chunkSize = std::min(chunkSize, mtu - WRITE_OVERHEAD);
+        bleManager.setWriteWithoutResponse(commands);
+        metrics.setFirmware(QString::fromStdString(firmware.describe()));
+        qDebug() << "Firmware" << QString::fromStdString(firmware.describe()) << "- MTU" << mtu << "- writing"
+                 << chunkSize << "byte chunks" << (commands ? "without response" : "with response");
+    }
+
+    // The current file transfer (or a failed op) is done; start whatever is next.
     void processNextOperation() {
-        if (opQueue.empty()) {
-            isProcessing = false;
+        transferActive = false;
+        pumpOperations();
+    }
+
+    void finishPipelinedOperation() {
+        if (opsInFlight > 0) opsInFlight--;
+        pumpOperations();
+    }
+
+    bool isIdle() const {
+        return opQueue.empty() && !transferActive && opsInFlight == 0 &&
+               walkQueue.empty() && walksInFlight == 0 && !copy && !backup && !verify && !provision;
+    }
+
+    void cancelOperations() {
+        opQueue.clear();
+        walkQueue.clear();
+        walkGeneration++;
+        if (copy) copy->cancel();
+        if (backup) backup->cancelled = true;
+        if (verify) verify->cancelled = true;
+        if (provision) provision->cancelled = true;
+        uploadedFiles.clear();
+        unverifiable = 0;
+    }
+
+    void pumpWalk() {
+        while (!walkQueue.empty() && walksInFlight < WALK_DEPTH) {
+            WalkDir dir = walkQueue.front();
+            walkQueue.pop_front();
+            walksInFlight++;
+
+            if (progressDialog && opQueue.empty() && !transferActive) {
+                progressDialog->setLabelText(QString("Listing: %1").arg(dir.remote));
+            }
+
+            int generation = walkGeneration;
+            auto payload = Pixl::Protocol::createStringPayload(dir.remote.toStdString());
+            sendRequest(Pixl::Command::ReadDir, payload, dir.remote, 0,
+                [this, dir, generation](const Pixl::Packet& pkt, const std::vector<uint8_t>& payload, bool corrupt) {
+                    walksInFlight--;
+                    if (generation == walkGeneration) {
+                        if (pkt.status != 0 || corrupt) {
+                            qDebug() << "Listing" << dir.remote << "failed with status:" << pkt.status;
+                            dir.visit(dir, {}, false);
+                        } else {
+                            auto entries = Pixl::Protocol::parseDirEntries(payload);
+                            remoteModel->onDirectoryListing(dir.remote, entries);
+                            dir.visit(dir, entries, true);
+                        }
+                    }
+                    pumpOperations();
+                });
+        }
+    }
+
+    void pumpOperations() {
+        if (progressDialog && progressDialog->wasCanceled()) {
+            cancelOperations();
+        }
+
+        pumpWalk();
+        pumpBackup();
+        pumpVerify();
+
+        // A mirrored upload or a peek holds the file handle and hands it back
+        // when done, unless the firmware has a second one to spare
+        while (!opQueue.empty() && !transferActive && (firmware.openFiles > 1 || (!mirrorUploading && !peekActive))) {
+            bool pipelined = isPipelined(opQueue.front().type);
+            if (pipelined && opsInFlight >= PIPELINE_DEPTH) break;
+
+            Operation op = opQueue.front();
+            opQueue.pop_front();
+            completedOps++;
+
+            if (progressDialog) {
+                progressDialog->setValue(completedOps);
+                progressDialog->setLabelText(QString("Processing: %1").arg(QFileInfo(op.source.isEmpty() ? op.target : op.source).fileName()));
+            }
+
+            if (!startOperation(op)) continue;
+            if (pipelined) {
+                opsInFlight++;
+            } else {
+                transferActive = true;
+            }
+        }
+
+        pumpProvision();
+
+        if (isIdle() && !uploadedFiles.empty()) {
+            startVerify();
+            pumpVerify(); // Reading back doesn't wait for the local hashes
+        }
+
+        if (isIdle()) {
+            totalOps = 0;
             if (progressDialog) {
                 progressDialog->close();
                 progressDialog->deleteLater();
@@ -62,63 +519,92 @@ public:
             }
             // Refresh
             q->onFetchRequested(lastRequestedPath);
-            return;
+            pumpMirror();
+            pumpPeek();
         }
+    }
 
-        isProcessing = true;
-        Operation op = opQueue.front();
-        opQueue.pop_front();
-        completedOps++;
-
+    void resetOperations() {
+        copy.reset();
+        abortBackup();
+        interruptMirror();
+        verify.reset();
+        abortProvision();
+        crawlQueue.clear();
+        crawlSkipped.clear();
+        peekQueue.clear();
+        peekActive = false;
+        peekGeneration++;
+        releasePeer();
+        cancelOperations();
+        transferActive = false;
+        opsInFlight = 0;
+        walksInFlight = 0;
+        totalOps = 0;
         if (progressDialog) {
-            progressDialog->setValue(completedOps);
-            progressDialog->setLabelText(QString("Processing: %1").arg(QFileInfo(op.source.isEmpty() ? op.target : op.source).fileName()));
-            if (progressDialog->wasCanceled()) {
-                opQueue.clear();
-                processNextOperation();
-                return;
-            }
+            progressDialog->close();
+            progressDialog->deleteLater();
+            progressDialog = nullptr;
         }
+    }
+
+    // Sends the first command of an op. Returns false if it failed before
+    // anything was sent.
+    bool startOperation(const Operation& op) {
+        if (!isPipelined(op.type)) currentOpType = op.type;
 
         switch (op.type) {
             case OpType::CreateFolder: {
                 auto payload = Pixl::Protocol::createStringPayload(op.target.toStdString());
-                bleManager.sendCommand(Pixl::Command::CreateFolder, payload);
+                sendRequest(Pixl::Command::CreateFolder, payload);
                 break;
             }
             case OpType::UploadFile: {
-                currentFile = std::make_unique<QFile>(op.source);
-                if (!currentFile->open(QIODevice::ReadOnly)) {
-                    processNextOperation();
-                    return;
+                bool opened = op.archive ? uploadSource.openArchiveEntry(op.archive, op.entry)
+                                         : uploadSource.open(op.source);
+                if (!opened) {
+                    return false;
                 }
                 currentOffset = 0;
+                currentUpload = op;
                 auto payload = Pixl::Protocol::createOpenFilePayload(op.target.toStdString(), 0x16);
-                bleManager.sendCommand(Pixl::Command::OpenFile, payload);
+                sendRequest(Pixl::Command::OpenFile, payload);
                 break;
             }
             case OpType::DownloadFile: {
                 currentFile = std::make_unique<QFile>(op.target);
                 if (!currentFile->open(QIODevice::WriteOnly)) {
-                     processNextOperation();
-                     return;
+                     return false;
                 }
                 currentOffset = 0;
+                currentDownloadSize = op.size;
                 auto payload = Pixl::Protocol::createOpenFilePayload(op.source.toStdString(), 0x08);
-                bleManager.sendCommand(Pixl::Command::OpenFile, payload);
+                sendRequest(Pixl::Command::OpenFile, payload);
                 break;
             }
             case OpType::DeleteFile: {
                 auto payload = Pixl::Protocol::createStringPayload(op.target.toStdString());
-                bleManager.sendCommand(Pixl::Command::Remove, payload);
+                sendRequest(Pixl::Command::Remove, payload, op.target);
+                break;
+            }
+            case OpType::Rename: {
+                auto payload = Pixl::Protocol::createRenamePayload(op.source.toStdString(), op.target.toStdString());
+                sendRequest(Pixl::Command::Rename, payload, op.target);
                 break;
             }
         }
+        return true;
     }
 
-    void startOperations(const std::vector<Operation>& ops, const QString& title, QWidget* parent) {
+    // Adds ops to a running batch, e.g. files found by a walk
+    void enqueueOperations(const std::vector<Operation>& ops) {
         for (const auto& op : ops) opQueue.push_back(op);
         totalOps += ops.size();
+        if (progressDialog) progressDialog->setMaximum(totalOps);
+    }
+
+    void startOperations(const std::vector<Operation>& ops, const QString& title, QWidget* parent) {
+        enqueueOperations(ops);
 
         if (!progressDialog) {
             progressDialog = new QProgressDialog(title, "Cancel", 0, totalOps, parent);
@@ -130,37 +616,1374 @@ public:
             progressDialog->setMaximum(totalOps);
         }
 
-        if (!isProcessing) {
-            processNextOperation();
-        }
+        pumpOperations();
     }
 
     void sendNextChunk() {
-        if (!currentFile) return;
-        currentFile->seek(currentOffset);
-        QByteArray data = currentFile->read(CHUNK_SIZE);
-        if (data.isEmpty()) {
+        TraceSpan span("sendNextChunk", "io");
+        if (!uploadSource.isOpen()) return;
+        auto chunk = uploadSource.chunkAt(currentOffset, chunkSize);
+        if (chunk.size == 0) {
+            if (uploadSource.hasError()) {
+                qDebug() << "Reading local file failed, upload truncated at offset" << currentOffset;
+            }
             std::vector<uint8_t> payload;
             payload.push_back(currentFileId);
-            bleManager.sendCommand(Pixl::Command::CloseFile, payload);
+            sendRequest(Pixl::Command::CloseFile, payload);
             return;
         }
-        std::vector<uint8_t> payload;
-        payload.push_back(currentFileId);
-        payload.insert(payload.end(), data.begin(), data.end());
-        bleManager.sendCommand(Pixl::Command::WriteFile, payload);
+        chunkPayload.clear();
+        chunkPayload.push_back(currentFileId);
+        chunkPayload.insert(chunkPayload.end(), chunk.data, chunk.data + chunk.size);
+        currentChunk = chunk.size;
+        sendRequest(Pixl::Command::WriteFile, chunkPayload);
+    }
+
+    // Builds Rename ops moving each path into targetDir. Skips items that are
+    // already there and folders that would end up inside themselves.
+    std::vector<Operation> buildMoves(const QStringList& paths, const QString& targetDir) {
+        std::vector<Operation> ops;
+        QString target = remoteNormalize(targetDir);
+        for (const QString& path : paths) {
+            QString source = remoteNormalize(path);
+            if (remoteParent(source) == target) continue;
+            if (remoteJoin(target, "").startsWith(remoteJoin(source, ""))) continue;
+            ops.push_back({OpType::Rename, source, remoteJoin(target, source.section('/', -1))});
+        }
+        return ops;
+    }
+
+    // Whether a name from a device listing is one plain local path component.
+    // Anything that could land outside the download folder is refused, as
+    // ArchiveReader does for archive entries.
+    static bool isSafeLocalName(const QString& name) {
+        return !name.isEmpty() && name != "." && name != ".." && !name.contains('/') && !name.contains('\\') &&
+               !name.contains(':') && !QDir::isAbsolutePath(name);
+    }
+
+    // Downloads the selected remote items into targetDir. Folders are walked
+    // on the device and recreated locally as their listings arrive.
+    void startDownload(const QModelIndexList& selected, const QString& targetDir, QWidget* parent) {
+        std::vector<Operation> ops;
+        std::vector<WalkDir> dirs;
+        for (const auto& index : selected) {
+            QString remotePath = remoteModel->filePath(index);
+            QString name = remoteNormalize(remotePath).section('/', -1);
+            // A drive root has no name of its own and downloads into targetDir itself
+            if (!name.isEmpty() && !isSafeLocalName(name)) {
+                qDebug() << "Not downloading" << remotePath << ": its name is not a safe local file name";
+                continue;
+            }
+            QString localPath = QDir(targetDir).absoluteFilePath(name);
+            if (remoteModel->isDir(index)) {
+                dirs.push_back({remotePath, localPath, nullptr});
+            } else {
+                ops.push_back({OpType::DownloadFile, remotePath, localPath, remoteModel->fileSize(index)});
+            }
+        }
+
+        auto visit = [this](const WalkDir& dir, const std::vector<Pixl::FileEntry>& entries, bool ok) {
+            if (!ok) return;
+            // Create the folder only once it's listed, so a failed listing leaves nothing behind
+            if (!QDir().mkpath(dir.local)) {
+                qDebug() << "Could not create local folder" << dir.local;
+                return;
+            }
+            std::vector<Operation> found;
+            for (const auto& entry : entries) {
+                QString name = QString::fromStdString(entry.name);
+                QString remotePath = remoteJoin(dir.remote, name);
+                if (!isSafeLocalName(name)) {
+                    qDebug() << "Not downloading" << remotePath << ": its name is not a safe local file name";
+                    continue;
+                }
+                QString localPath = QDir(dir.local).absoluteFilePath(name);
+                if (entry.type == 1) {
+                    walkQueue.push_back({remotePath, localPath, dir.visit});
+                } else {
+                    found.push_back({OpType::DownloadFile, remotePath, localPath, entry.size});
+                }
+            }
+            enqueueOperations(found);
+        };
+        for (auto& dir : dirs) {
+            dir.visit = visit;
+            walkQueue.push_back(dir);
+        }
+        startOperations(ops, "Downloading...", parent);
+    }
+
+    // Deletes the selected remote items. Folders are walked first: their files
+    // are removed as soon as each listing arrives, and the folders themselves
+    // once the whole subtree is known, deepest first. Removes are pipelined,
+    // and since the device handles them in order a folder is always empty by
+    // the time its own Remove runs.
+    void startDelete(const QStringList& files, const QStringList& folders, QWidget* parent) {
+        std::vector<Operation> ops;
+        for (const QString& path : files) {
+            ops.push_back({OpType::DeleteFile, "", path});
+        }
+
+        for (const QString& folder : folders) {
+            struct Subtree {
+                int pendingListings = 1;
+                QStringList dirs;
+                QStringList failed;
+            };
+            auto subtree = std::make_shared<Subtree>();
+            subtree->dirs << remoteNormalize(folder);
+
+            auto visit = [this, subtree](const WalkDir& dir, const std::vector<Pixl::FileEntry>& entries, bool ok) {
+                subtree->pendingListings--;
+                if (!ok) {
+                    subtree->failed << remoteNormalize(dir.remote);
+                }
+
+                std::vector<Operation> found;
+                for (const auto& entry : entries) {
+                    QString path = remoteJoin(dir.remote, QString::fromStdString(entry.name));
+                    if (entry.type == 1) {
+                        subtree->pendingListings++;
+                        subtree->dirs << path;
+                        walkQueue.push_back({path, QString(), dir.visit});
+                    } else {
+                        found.push_back({OpType::DeleteFile, "", path});
+                    }
+                }
+
+                if (subtree->pendingListings == 0) {
+                    std::sort(subtree->dirs.begin(), subtree->dirs.end(), [](const QString& a, const QString& b) {
+                        return a.count('/') > b.count('/');
+                    });
+                    for (const QString& path : subtree->dirs) {
+                        // A folder we couldn't list may still have content; keep it and its parents
+                        bool keep = std::any_of(subtree->failed.begin(), subtree->failed.end(), [&path](const QString& f) {
+                            return f == path || f.startsWith(remoteJoin(path, ""));
+                        });
+                        if (!keep) found.push_back({OpType::DeleteFile, "", path});
+                    }
+                }
+                enqueueOperations(found);
+            };
+            walkQueue.push_back({folder, QString(), visit});
+        }
+        startOperations(ops, "Deleting...", parent);
+    }
+
+    // Streamed copy of remote items into targetDir, on another device or on
+    // this one. Reads go through the normal request pipeline, writes through
+    // `destination`. Folders are walked and recreated as their listings
+    // arrive, and files start streaming as soon as they're found.
+    struct CopySource {
+        QString path;
+        bool folder;
+        uint32_t size;
+        QString name; // Name at the destination
+    };
+    static constexpr size_t PEER_PIPE_CAPACITY = 64 * 1024;
+    // On one device the writes are only answered once the read finishes, so
+    // reading further ahead would just hold more in memory
+    static constexpr size_t LOCAL_PIPE_CAPACITY = 8 * 1024;
+    std::unique_ptr<StreamCopy> copy;
+    QElapsedTimer copyClock;
+
+    std::vector<CopySource> copySources(const QModelIndexList& selected) const {
+        std::vector<CopySource> sources;
+        for (const auto& index : selected) {
+            QString path = remoteNormalize(remoteModel->filePath(index));
+            sources.push_back({path, remoteModel->isDir(index), remoteModel->fileSize(index), path.section('/', -1)});
+        }
+        return sources;
+    }
+
+    // "name copy.ext", then "name copy 2.ext" and so on, for a copy landing
+    // next to its original
+    QString copyName(const QString& dir, const QString& name, bool folder) const {
+        int dot = folder ? -1 : name.lastIndexOf('.');
+        QString base = dot > 0 ? name.left(dot) : name;
+        QString ext = dot > 0 ? name.mid(dot) : QString();
+        for (int n = 1;; ++n) {
+            QString candidate = base + (n == 1 ? QString(" copy") : QString(" copy %1").arg(n)) + ext;
+            if (!remoteModel->indexFromPath(remoteJoin(dir, candidate)).isValid()) return candidate;
+        }
+    }
+
+    // Duplicates remote paths into targetDir on the connected device
+    void startLocalCopy(const QStringList& paths, const QString& targetDir, QWidget* parent) {
+        QString target = remoteNormalize(targetDir);
+        std::vector<CopySource> sources;
+        for (const QString& path : paths) {
+            QString source = remoteNormalize(path);
+            QModelIndex index = remoteModel->indexFromPath(source);
+            if (!index.isValid()) continue;
+            bool folder = remoteModel->isDir(index);
+            // A folder can't be copied into itself
+            if (folder && remoteJoin(target, "").startsWith(remoteJoin(source, ""))) continue;
+            QString name = source.section('/', -1);
+            if (remoteParent(source) == target) name = copyName(target, name, folder);
+            sources.push_back({source, folder, remoteModel->fileSize(index), name});
+        }
+        if (sources.empty()) return;
+        if (copy) {
+            QMessageBox::information(parent, "Copy", "A copy is already running.");
+            return;
+        }
+        remoteModel->markStale(target);
+        startStreamCopy(sources, target,
+            [this](Pixl::Command cmd, const std::vector<uint8_t>& payload, StreamCopy::Reply reply) {
+                sendRequest(cmd, payload, QString(), 0, std::move(reply));
+            },
+            LOCAL_PIPE_CAPACITY, chunkSize, "Copying...", parent);
+    }
+
+    void startStreamCopy(const std::vector<CopySource>& sources, const QString& targetDir,
+                         StreamCopy::Sender destination, size_t pipeCapacity, int writeChunk, const QString& title,
+                         QWidget* parent, std::function<void()> onDone = nullptr) {
+        copy = std::make_unique<StreamCopy>(
+            [this](Pixl::Command cmd, const std::vector<uint8_t>& payload, StreamCopy::Reply reply) {
+                sendRequest(cmd, payload, QString(), 0, std::move(reply));
+            },
+            [this](const std::vector<uint8_t>& payload, uint32_t size, StreamCopy::ChunkHandler onChunk, StreamCopy::Reply reply) {
+                sendRequest(Pixl::Command::ReadFile, payload, QString(), size, std::move(reply), std::move(onChunk));
+            },
+            std::move(destination), pipeCapacity, writeChunk);
+        StreamCopy* job = copy.get();
+        copyClock.start();
+
+        job->setItemCallback([this](const std::string& path, bool ok) {
+            if (!ok) qDebug() << "Copy to" << QString::fromStdString(path) << "failed";
+            completedOps++;
+            if (progressDialog) {
+                progressDialog->setValue(completedOps);
+                progressDialog->setLabelText(QString("Copying: %1").arg(QString::fromStdString(path).section('/', -1)));
+                if (progressDialog->wasCanceled()) cancelOperations();
+            }
+        });
+        job->setFinishedCallback([this, job, onDone](const StreamCopy::Result& result) {
+            qDebug() << "Copy finished:" << result.files << "file(s)," << result.folders << "folder(s),"
+                     << result.bytes << "bytes," << result.failed << "failed in" << copyClock.elapsed()
+                     << "ms; pipe peaked at" << job->pipeHighWater() << "bytes";
+            // The job is still running this callback, so let it go afterwards
+            QMetaObject::invokeMethod(q, [this, job, result, onDone]() {
+                if (copy.get() != job) return;
+                copy.reset();
+                if (onDone) onDone();
+                pumpOperations();
+                if (result.failed > 0) {
+                    QMessageBox::warning(q, "Copy", QString("%1 item(s) could not be copied.").arg(result.failed));
+                }
+            }, Qt::QueuedConnection);
+        });
+
+        QString target = remoteNormalize(targetDir);
+        auto listings = std::make_shared<int>(0);
+        auto visit = [this, job, listings](const WalkDir& dir, const std::vector<Pixl::FileEntry>& entries, bool ok) {
+            if (copy.get() != job) return;
+            (*listings)--;
+            if (!ok) qDebug() << "Could not list" << dir.remote << "- its contents are not copied";
+            for (const auto& entry : entries) {
+                QString name = QString::fromStdString(entry.name);
+                QString from = remoteJoin(dir.remote, name);
+                QString to = remoteJoin(dir.local, name);
+                if (entry.type == 1) {
+                    job->addFolder(to.toStdString());
+                    (*listings)++;
+                    walkQueue.push_back({from, to, dir.visit});
+                } else {
+                    job->addFile(from.toStdString(), to.toStdString(), entry.size);
+                }
+                totalOps++;
+            }
+            if (progressDialog) progressDialog->setMaximum(totalOps);
+            if (*listings == 0) job->finishAdding();
+        };
+
+        for (const auto& source : sources) {
+            QString to = remoteJoin(target, source.name);
+            if (source.folder) {
+                job->addFolder(to.toStdString());
+                (*listings)++;
+                walkQueue.push_back({source.path, to, visit});
+            } else {
+                job->addFile(source.path.toStdString(), to.toStdString(), source.size);
+            }
+            totalOps++;
+        }
+        if (*listings == 0) job->finishAdding();
+        startOperations({}, title, parent);
+    }
+
+    // Second device for device-to-device copies, connected only while one
+    // runs. It only ever answers our own writes, so a plain FIFO will do.
+    std::unique_ptr<BleManager> peer;
+    std::deque<PendingRequest> peerRequests;
+    int peerGeneration = 0; // Bumped on release so late failures are ignored
+
+    void sendToPeer(Pixl::Command cmd, const std::vector<uint8_t>& payload, CompletionHandler onComplete) {
+        if (!peer || !peer->isConnected()) {
+            // Fail later, like a request that never got an answer
+            int generation = peerGeneration;
+            QMetaObject::invokeMethod(q, [this, cmd, generation, onComplete]() {
+                if (generation != peerGeneration) return;
+                onComplete(Pixl::Packet{static_cast<uint8_t>(cmd), 0xFF, 0, {}}, {}, true);
+            }, Qt::QueuedConnection);
+            return;
+        }
+        PendingRequest req{cmd, QString(), {}, std::move(onComplete)};
+        req.assembler.begin(bufferPool);
+        peerRequests.push_back(std::move(req));
+        peer->sendCommand(cmd, payload);
+    }
+
+    void handlePeerData(const std::vector<uint8_t>& data) {
+        try {
+            auto pkt = Pixl::Protocol::parsePacket(data);
+            auto *req = matchRequest(peerRequests, pkt.cmd);
+            if (!req) {
+                qDebug() << "Unexpected response from destination device for command" << pkt.cmd;
+                return;
+            }
+            req->assembler.feed(pkt);
+            if (pkt.hasMoreData()) return;
+
+            bool corrupt = req->assembler.state() == Pixl::ResponseAssembler::State::Corrupt;
+            auto onComplete = std::move(req->onComplete);
+            std::vector<uint8_t> payload = req->assembler.take();
+            peerRequests.pop_front();
+            if (onComplete) onComplete(pkt, payload, corrupt);
+            bufferPool.release(std::move(payload));
+        } catch (const std::exception& e) {
+            qDebug() << "Destination packet parse error:" << e.what();
+        }
+    }
+
+    void onPeerLost() {
+        qDebug() << "Destination device disconnected";
+        std::deque<PendingRequest> lost;
+        lost.swap(peerRequests);
+        for (auto& req : lost) failRequest(req);
+        if (copy) copy->cancel();
+    }
+
+    void releasePeer() {
+        peerGeneration++;
+        peerRequests.clear();
+        if (peer && peer->isConnected()) peer->disconnect();
+    }
+
+    // Backups go into a folder of snapshots. Each snapshot is a tar of the
+    // files fetched that time plus a JSON index of the whole device saying
+    // which tar holds each file. Files whose size and metadata match the
+    // latest index are not fetched again, so later snapshots stay small.
+    struct BackupFile {
+        QString path;
+        uint32_t size;
+        QString meta;
+    };
+    struct Backup {
+        QString folder;
+        QString name; // snapshot-<time>, shared by the tar and its index
+        QString base; // Index this snapshot builds on, if any
+        TarWriter tar;
+        QHash<QString, QJsonObject> previous; // Entries of the base index by path
+        QJsonArray entries;
+        QJsonArray folders;
+        std::deque<BackupFile> queue;
+        int pendingListings = 0;
+        bool fetching = false;
+        bool cancelled = false;
+        int fetched = 0;
+        int reused = 0;
+        int failed = 0;
+        uint64_t bytes = 0;
+        QElapsedTimer clock;
+
+        QString tarPath() const { return QDir(folder).filePath(name + ".tar"); }
+    };
+    std::unique_ptr<Backup> backup;
+
+    // "E:/amiibo/a.bin" is stored as "E/amiibo/a.bin"
+    static QString backupEntryName(const QString& remote) {
+        QString name = remote;
+        if (name.size() >= 2 && name[1] == ':') name.remove(1, 1);
+        return name;
     }
 
-    void recursiveScan(const QString& localPath, const QString& remotePath, std::vector<Operation>& ops) {
-        QFileInfo fi(localPath);
-        if (fi.isDir()) {
-            ops.push_back({OpType::CreateFolder, localPath, remotePath});
-            QDir dir(localPath);
-            for (const QString& entry : dir.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
-                recursiveScan(dir.absoluteFilePath(entry), remotePath + (remotePath.endsWith("/") ? "" : "/") + entry, ops);
+    // The newest snapshot of this same device in the folder. Another
+    // device's files can match by path, size and meta (every amiibo dump
+    // is 540 bytes), so its snapshots are never a base.
+    void loadBackupBase(Backup& job) {
+        QDir dir(job.folder);
+        QJsonObject index;
+        for (const QString& name : dir.entryList({"snapshot-*.json"}, QDir::Files, QDir::Name | QDir::Reversed)) {
+            QFile file(dir.filePath(name));
+            if (!file.open(QIODevice::ReadOnly)) continue;
+            QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+            if (!doc.isObject()) {
+                qDebug() << "Ignoring unreadable backup index" << file.fileName();
+                continue;
             }
+            if (doc.object().value("device").toString().compare(reconnectAddress, Qt::CaseInsensitive) != 0) {
+                qDebug() << "Ignoring backup index" << name << "of another device";
+                continue;
+            }
+            job.base = name;
+            index = doc.object();
+            break;
+        }
+        if (job.base.isEmpty()) return;
+        for (const QJsonValue& value : index.value("entries").toArray()) {
+            QJsonObject entry = value.toObject();
+            // Only reuse data that is still there
+            if (!dir.exists(entry.value("archive").toString())) continue;
+            job.previous.insert(entry.value("path").toString(), entry);
+        }
+    }
+
+    void startBackup(const QString& folder, QWidget* parent) {
+        if (backup || copy || !isIdle()) {
+            QMessageBox::information(parent, "Backup", "Wait for the current operation to finish first.");
+            return;
+        }
+        QStringList drives;
+        for (int i = 0; i < remoteModel->rowCount(); ++i) {
+            drives << remoteNormalize(remoteModel->filePath(remoteModel->index(i, 0)));
+        }
+        if (drives.isEmpty()) {
+            QMessageBox::warning(parent, "Backup", "No drives to back up.");
+            return;
+        }
+
+        backup = std::make_unique<Backup>();
+        Backup* job = backup.get();
+        job->folder = folder;
+        job->name = "snapshot-" + QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss");
+        job->clock.start();
+        loadBackupBase(*job);
+        if (!job->tar.open(QFile::encodeName(job->tarPath()).toStdString())) {
+            QString name = job->name;
+            backup.reset();
+            QMessageBox::warning(parent, "Backup", QString("Could not create %1.tar in %2.").arg(name, folder));
+            return;
+        }
+        qDebug() << "Backing up to" << job->tarPath() << "on top of" << (job->base.isEmpty() ? "nothing" : job->base)
+                 << "with" << job->previous.size() << "known file(s)";
+
+        auto visit = [this, job](const WalkDir& dir, const std::vector<Pixl::FileEntry>& entries, bool ok) {
+            if (backup.get() != job) return;
+            job->pendingListings--;
+            if (!ok) {
+                qDebug() << "Could not list" << dir.remote << "- it is missing from the backup";
+                job->failed++;
+            }
+            for (const auto& entry : entries) {
+                QString path = remoteJoin(dir.remote, QString::fromStdString(entry.name));
+                if (entry.type == 1) {
+                    job->folders.append(path);
+                    job->pendingListings++;
+                    walkQueue.push_back({path, QString(), dir.visit});
+                    continue;
+                }
+                QString meta = QString::fromStdString(entry.meta);
+                auto it = job->previous.constFind(path);
+                if (it != job->previous.constEnd() && it->value("size").toVariant().toULongLong() == entry.size &&
+                    it->value("meta").toString() == meta) {
+                    job->entries.append(*it);
+                    job->reused++;
+                } else {
+                    job->queue.push_back({path, entry.size, meta});
+                    totalOps++;
+                }
+            }
+            if (progressDialog) progressDialog->setMaximum(totalOps);
+        };
+        for (const QString& drive : drives) {
+            job->folders.append(drive);
+            job->pendingListings++;
+            walkQueue.push_back({drive, QString(), visit});
+        }
+        startOperations({}, "Backing up...", parent);
+    }
+
+    // Fetches one file at a time straight into the tar: the header goes out
+    // with the listed size and each ReadFile chunk is appended as it arrives.
+    // Called from pumpOperations, which tidies up once the backup is gone.
+    void pumpBackup() {
+        if (!backup || backup->fetching) return;
+        Backup* job = backup.get();
+        if (job->queue.empty() || job->cancelled) {
+            if (job->pendingListings == 0 || job->cancelled) finishBackup();
+            return;
+        }
+
+        BackupFile file = job->queue.front();
+        job->queue.pop_front();
+        job->fetching = true;
+        if (progressDialog) progressDialog->setLabelText(QString("Backing up: %1").arg(file.path.section('/', -1)));
+
+        auto done = [this, job, file](bool ok) {
+            if (backup.get() != job) return;
+            if (ok) {
+                job->entries.append(QJsonObject{{"path", file.path}, {"size", static_cast<qint64>(file.size)},
+                                                {"meta", file.meta}, {"archive", job->name + ".tar"}});
+                job->fetched++;
+                job->bytes += file.size;
+            } else {
+                qDebug() << "Backing up" << file.path << "failed";
+                job->failed++;
+            }
+            completedOps++;
+            if (progressDialog) progressDialog->setValue(completedOps);
+            job->fetching = false;
+            pumpOperations();
+        };
+
+        auto payload = Pixl::Protocol::createOpenFilePayload(file.path.toStdString(), 0x08);
+        sendRequest(Pixl::Command::OpenFile, payload, QString(), 0,
+            [this, job, file, done](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                if (backup.get() != job) return;
+                if (pkt.status != 0 || corrupt || data.empty()) {
+                    done(false);
+                    return;
+                }
+                uint8_t fileId = data[0];
+                // Listings carry no times, so entries get none rather than
+                // the backup's, which would make unchanged files differ
+                job->tar.beginFile(backupEntryName(file.path).toStdString(), file.size);
+                sendRequest(Pixl::Command::ReadFile, {fileId}, QString(), file.size,
+                    [this, job, fileId, done](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                        if (backup.get() != job) return;
+                        // A short or failed read is dropped from the tar as
+                        // well as the index
+                        bool ok = pkt.status == 0 && !corrupt;
+                        if (ok) ok = job->tar.endFile();
+                        else job->tar.discardFile();
+                        sendRequest(Pixl::Command::CloseFile, {fileId}, QString(), 0,
+                            [done, ok](const Pixl::Packet&, const std::vector<uint8_t>&, bool) { done(ok); });
+                    },
+                    [job](const std::vector<uint8_t>& chunk) { job->tar.write(chunk.data(), chunk.size()); });
+            });
+    }
+
+    void finishBackup() {
+        std::unique_ptr<Backup> job = std::move(backup);
+        bool written = job->tar.close();
+        if (job->cancelled || !written) {
+            QFile::remove(job->tarPath());
+            qDebug() << "Backup" << job->name << (written ? "cancelled" : "could not be written");
+            if (!written) {
+                QMetaObject::invokeMethod(q, [this]() {
+                    QMessageBox::warning(q, "Backup", "The backup could not be written.");
+                }, Qt::QueuedConnection);
+            }
+            return;
+        }
+        // Nothing changed since the last snapshot: the index alone covers it
+        if (job->fetched == 0) QFile::remove(job->tarPath());
+
+        QJsonObject index{
+            {"created", QDateTime::currentDateTime().toString(Qt::ISODate)},
+            {"device", reconnectAddress},
+            {"base", job->base},
+            {"archive", job->fetched > 0 ? job->name + ".tar" : QString()},
+            {"failed", job->failed},
+            {"folders", job->folders},
+            {"entries", job->entries},
+        };
+        QSaveFile file(QDir(job->folder).filePath(job->name + ".json"));
+        bool saved = file.open(QIODevice::WriteOnly) && file.write(QJsonDocument(index).toJson()) >= 0 && file.commit();
+
+        qDebug() << "Backup" << job->name << "finished:" << job->fetched << "file(s) fetched," << job->bytes << "bytes,"
+                 << job->reused << "unchanged," << job->failed << "failed in" << job->clock.elapsed() << "ms";
+        QString summary = saved
+            ? QString("%1 file(s) backed up, %2 unchanged since the last snapshot.").arg(job->fetched).arg(job->reused)
+            : QString("The backup index could not be written.");
+        if (saved && job->failed > 0) summary += QString("\n%1 item(s) could not be read.").arg(job->failed);
+        QMetaObject::invokeMethod(q, [this, summary, saved]() {
+            if (saved) QMessageBox::information(q, "Backup", summary);
+            else QMessageBox::warning(q, "Backup", summary);
+        }, Qt::QueuedConnection);
+    }
+
+    // Disconnected mid-backup: the tar is incomplete, so drop it
+    void abortBackup() {
+        if (!backup) return;
+        backup->tar.close();
+        QFile::remove(backup->tarPath());
+        qDebug() << "Backup" << backup->name << "aborted";
+        backup.reset();
+    }
+
+    // Puts a snapshot back. Its index lists the whole tree, with each file
+    // in whichever tar of the chain last fetched it, so every tar it names
+    // is opened and the files go out as archive uploads in tar order.
+    void startRestore(const QString& indexFile, QWidget* parent) {
+        if (backup || copy || !isIdle()) {
+            QMessageBox::information(parent, "Restore", "Wait for the current operation to finish first.");
+            return;
+        }
+        QFile file(indexFile);
+        QJsonDocument doc = file.open(QIODevice::ReadOnly) ? QJsonDocument::fromJson(file.readAll()) : QJsonDocument();
+        if (!doc.isObject()) {
+            QMessageBox::warning(parent, "Restore", QString("%1 is not a backup index.").arg(indexFile));
+            return;
+        }
+        QDir dir = QFileInfo(indexFile).dir();
+
+        struct Tar {
+            std::shared_ptr<ArchiveReader> reader;
+            QHash<QString, int> entries; // Entry index by name
+        };
+        QHash<QString, Tar> tars;
+        QStringList missing;
+        std::vector<Operation> uploads;
+        for (const QJsonValue& value : doc.object().value("entries").toArray()) {
+            QJsonObject entry = value.toObject();
+            QString path = entry.value("path").toString();
+            QString archive = entry.value("archive").toString();
+            if (!tars.contains(archive)) {
+                Tar tar;
+                tar.reader = std::make_shared<ArchiveReader>();
+                if (tar.reader->open(QFile::encodeName(dir.filePath(archive)).toStdString())) {
+                    const auto& list = tar.reader->entries();
+                    for (size_t i = 0; i < list.size(); ++i) {
+                        if (!list[i].folder) tar.entries.insert(QString::fromStdString(list[i].path), static_cast<int>(i));
+                    }
+                } else {
+                    qDebug() << "Restore: could not open" << archive << ":" << QString::fromStdString(tar.reader->error());
+                }
+                tars.insert(archive, tar);
+            }
+            const Tar& tar = tars[archive];
+            int index = tar.entries.value(backupEntryName(path), -1);
+            if (index < 0) {
+                missing << path;
+                continue;
+            }
+            Operation op{OpType::UploadFile, dir.filePath(archive) + "/" + backupEntryName(path), path};
+            op.archive = tar.reader;
+            op.entry = index;
+            uploads.push_back(op);
+        }
+        if (!missing.isEmpty()) {
+            QMessageBox::warning(parent, "Restore", QString("%1 file(s) of this snapshot are not in its tars, e.g. %2.\n"
+                                                            "Nothing was restored.").arg(missing.size()).arg(missing.first()));
+            return;
+        }
+        // Tars read cheapest front to back
+        std::stable_sort(uploads.begin(), uploads.end(), [](const Operation& a, const Operation& b) {
+            if (a.archive != b.archive) return std::less<ArchiveReader*>()(a.archive.get(), b.archive.get());
+            return a.entry < b.entry;
+        });
+
+        QStringList folders;
+        for (const QJsonValue& value : doc.object().value("folders").toArray()) {
+            QString folder = remoteNormalize(value.toString());
+            if (!(folder.size() == 3 && folder.endsWith(":/"))) folders << folder; // Drive roots are already there
+        }
+        std::sort(folders.begin(), folders.end(), [](const QString& a, const QString& b) {
+            int da = a.count('/'), db = b.count('/');
+            return da != db ? da < db : a < b;
+        });
+        std::vector<Operation> ops;
+        for (const QString& folder : folders) ops.push_back({OpType::CreateFolder, QString(), folder});
+        ops.insert(ops.end(), uploads.begin(), uploads.end());
+        qDebug() << "Restoring" << indexFile << ":" << folders.size() << "folder(s)," << uploads.size()
+                 << "file(s) from" << tars.size() << "tar(s)";
+        startOperations(ops, "Restoring...", parent);
+    }
+
+    // Live mirror of a local folder into a device folder. Changes go out in
+    // the background one at a time, only while nothing else is queued, and
+    // the mirror survives disconnects: whatever was missed is pushed once
+    // the device is back.
+    std::unique_ptr<FolderMirror> mirror;
+    QString mirrorLocal; // Empty when no mirror is set up
+    QString mirrorTarget;
+    bool mirrorReady = false;     // Target listed and the watch running
+    bool mirrorBusy = false;      // A change is being applied
+    bool mirrorUploading = false; // That change holds the device's file handle
+    uint8_t mirrorFileId = 0;
+    int mirrorGeneration = 0;     // Bumped on stop or disconnect so late replies are ignored
+    std::deque<FolderMirror::Change> mirrorBatch;
+    UploadSource mirrorSource;
+    std::vector<uint8_t> mirrorChunk;
+
+    void startMirror(const QString& local, const QString& target) {
+        stopMirror();
+        if (!mirror) {
+            mirror = std::make_unique<FolderMirror>();
+            mirror->setChangedCallback([this]() { pumpMirror(); });
+        }
+        mirrorLocal = local;
+        mirrorTarget = remoteNormalize(target);
+        qDebug() << "Mirroring" << mirrorLocal << "to" << mirrorTarget;
+        listMirrorTarget();
+    }
+
+    void stopMirror() {
+        if (mirrorLocal.isEmpty()) return;
+        qDebug() << "Stopped mirroring" << mirrorLocal;
+        if (mirrorUploading) sendRequest(Pixl::Command::CloseFile, {mirrorFileId}, QString(), 0, [](const Pixl::Packet&, const std::vector<uint8_t>&, bool) {});
+        interruptMirror();
+        mirror->stop();
+        mirrorLocal.clear();
+        mirrorTarget.clear();
+        mirrorReady = false;
+    }
+
+    // Drops the change in flight; it is still pending in the mirror, so it
+    // goes out again on the next pass
+    void interruptMirror() {
+        mirrorGeneration++;
+        mirrorBusy = false;
+        mirrorUploading = false;
+        mirrorBatch.clear();
+        mirrorSource.close();
+    }
+
+    // After a (re)connect: list the target if that never finished, or push
+    // whatever changed while the device was away
+    void resumeMirror() {
+        if (mirrorLocal.isEmpty()) return;
+        if (!mirrorReady) listMirrorTarget();
+        else mirror->rescan();
+    }
+
+    // What the target already holds becomes the starting point, so setting
+    // up a mirror over an earlier upload only sends what differs
+    void listMirrorTarget() {
+        if (!bleManager.isConnected()) return;
+        int generation = mirrorGeneration;
+        QStringList parts = mirrorTarget.split('/', Qt::SkipEmptyParts);
+        QString path = parts.value(0) + "/";
+        for (int i = 1; i < parts.size(); ++i) {
+            path = remoteJoin(path, parts[i]);
+            sendRequest(Pixl::Command::CreateFolder, Pixl::Protocol::createStringPayload(path.toStdString()), path, 0,
+                        [](const Pixl::Packet&, const std::vector<uint8_t>&, bool) {});
+        }
+        listMirrorFolder(generation, std::make_shared<FolderMirror::Tree>(),
+                         std::make_shared<std::deque<QString>>(std::deque<QString>{QString()}));
+    }
+
+    void listMirrorFolder(int generation, std::shared_ptr<FolderMirror::Tree> tree,
+                          std::shared_ptr<std::deque<QString>> folders) {
+        if (folders->empty()) {
+            mirrorReady = true;
+            qDebug() << "Mirror target holds" << tree->size() << "item(s)";
+            mirror->start(mirrorLocal, *tree);
+            return;
+        }
+        QString relative = folders->front();
+        folders->pop_front();
+        QString remote = relative.isEmpty() ? mirrorTarget : remoteJoin(mirrorTarget, relative);
+        sendRequest(Pixl::Command::ReadDir, Pixl::Protocol::createStringPayload(remote.toStdString()), remote, 0,
+            [this, generation, tree, folders, relative, remote](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                if (generation != mirrorGeneration) return;
+                if (pkt.status != 0 || corrupt) {
+                    qDebug() << "Mirror: could not list" << remote << "with status:" << pkt.status;
+                    if (relative.isEmpty()) {
+                        QString target = mirrorTarget;
+                        stopMirror();
+                        emit q->mirrorStopped();
+                        QMessageBox::warning(q, "Mirror", QString("Could not open %1 on the device.").arg(target));
+                        return;
+                    }
+                } else {
+                    auto entries = Pixl::Protocol::parseDirEntries(data);
+                    remoteModel->onDirectoryListing(remote, entries);
+                    for (const auto& entry : entries) {
+                        QString path = relative.isEmpty() ? QString::fromStdString(entry.name)
+                                                          : relative + "/" + QString::fromStdString(entry.name);
+                        FolderMirror::Node node;
+                        node.folder = entry.type == 1;
+                        node.size = entry.size;
+                        tree->insert(path, node);
+                        if (node.folder) folders->push_back(path);
+                    }
+                }
+                listMirrorFolder(generation, tree, folders);
+            });
+    }
+
+    void pumpMirror() {
+        if (!mirrorReady || mirrorBusy || peekActive) return;
+        if (!bleManager.isConnected() || bleManager.isReplaying() || !isIdle()) return; // Resumed when things settle
+        if (mirrorBatch.empty()) {
+            if (!mirror->isDirty()) return;
+            for (auto& change : mirror->changes()) mirrorBatch.push_back(std::move(change));
+            if (mirrorBatch.empty()) return;
+            qDebug() << "Mirror: pushing" << mirrorBatch.size() << "change(s)";
+            remoteModel->markStale(mirrorTarget);
+        }
+
+        FolderMirror::Change change = mirrorBatch.front();
+        mirrorBatch.pop_front();
+        mirrorBusy = true;
+        int generation = mirrorGeneration;
+        QString remote = remoteJoin(mirrorTarget, change.path);
+
+        auto done = [this, change, generation, remote](bool ok) {
+            if (generation != mirrorGeneration) return;
+            mirrorBusy = false;
+            mirrorUploading = false;
+            if (!ok) {
+                // Later changes may depend on this one; the retry redoes them all
+                qDebug() << "Mirror:" << remote << "failed, retrying in" << FolderMirror::RETRY_MS << "ms";
+                mirrorBatch.clear();
+            }
+            if (ok && change.type == FolderMirror::Change::Upload) {
+                remoteModel->fileWritten(remote, static_cast<uint32_t>(change.node.size));
+            } else if (ok && change.type == FolderMirror::Change::Remove) {
+                remoteModel->removePath(remote);
+            }
+            mirror->applied(change, ok);
+            if (mirrorBatch.empty() && lastRequestedPath.startsWith(mirrorTarget)) {
+                q->onFetchRequested(lastRequestedPath);
+            }
+            // Anything the user queued meanwhile goes first
+            if (!opQueue.empty()) {
+                pumpOperations();
+            } else {
+                pumpMirror();
+                pumpPeek();
+            }
+        };
+        auto statusOk = [done](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+            done(pkt.status == 0 && !corrupt);
+        };
+
+        switch (change.type) {
+            case FolderMirror::Change::Rename: {
+                QString from = remoteJoin(mirrorTarget, change.from);
+                sendRequest(Pixl::Command::Rename, Pixl::Protocol::createRenamePayload(from.toStdString(), remote.toStdString()),
+                            remote, 0, statusOk);
+                break;
+            }
+            case FolderMirror::Change::Remove:
+                sendRequest(Pixl::Command::Remove, Pixl::Protocol::createStringPayload(remote.toStdString()), remote, 0, statusOk);
+                break;
+            case FolderMirror::Change::CreateFolder:
+                sendRequest(Pixl::Command::CreateFolder, Pixl::Protocol::createStringPayload(remote.toStdString()), remote, 0,
+                    [done](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                        done((pkt.status == 0 || pkt.status == 1) && !corrupt); // 1: already there
+                    });
+                break;
+            case FolderMirror::Change::Upload: {
+                if (!mirrorSource.open(QDir(mirrorLocal).filePath(change.path))) {
+                    done(false);
+                    return;
+                }
+                mirrorUploading = true;
+                sendRequest(Pixl::Command::OpenFile, Pixl::Protocol::createOpenFilePayload(remote.toStdString(), 0x16), remote, 0,
+                    [this, generation, done](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                        if (generation != mirrorGeneration) return;
+                        if (pkt.status != 0 || corrupt || data.empty()) {
+                            mirrorSource.close();
+                            done(false);
+                            return;
+                        }
+                        mirrorFileId = data[0];
+                        sendMirrorChunk(generation, 0, done);
+                    });
+                break;
+            }
+        }
+    }
+
+    void sendMirrorChunk(int generation, qint64 offset, std::function<void(bool)> done) {
+        auto chunk = mirrorSource.chunkAt(offset, chunkSize);
+        if (chunk.size == 0) {
+            bool complete = !mirrorSource.hasError();
+            mirrorSource.close();
+            sendRequest(Pixl::Command::CloseFile, {mirrorFileId}, QString(), 0,
+                [this, generation, complete, done](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                    if (generation != mirrorGeneration) return;
+                    done(complete && pkt.status == 0 && !corrupt);
+                });
+            return;
+        }
+        mirrorChunk.clear();
+        mirrorChunk.push_back(mirrorFileId);
+        mirrorChunk.insert(mirrorChunk.end(), chunk.data, chunk.data + chunk.size);
+        qint64 next = offset + chunk.size;
+        sendRequest(Pixl::Command::WriteFile, mirrorChunk, QString(), 0,
+            [this, generation, next, done](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                if (generation != mirrorGeneration) return;
+                if (pkt.status != 0 || corrupt) {
+                    mirrorSource.close();
+                    sendRequest(Pixl::Command::CloseFile, {mirrorFileId}, QString(), 0,
+                        [done](const Pixl::Packet&, const std::vector<uint8_t>&, bool) { done(false); });
+                    return;
+                }
+                sendMirrorChunk(generation, next, done);
+            });
+    }
+
+    // Peeks read just the head of a file. ReadFile has no offset or length,
+    // so the device still sends the whole file, but only the first bytes
+    // are kept, nothing is written to disk, and the decoded result is
+    // cached by path, size and metadata so each file is peeked once. Like
+    // the mirror, peeks only run while nothing else is queued.
+    using PeekHandler = std::function<void(bool ok, const std::vector<uint8_t>& head)>;
+    std::unique_ptr<HeaderCache> headerCache;
+    std::deque<QString> peekQueue; // Rows of the folder on screen waiting for the Contents column
+    bool peekActive = false;       // A peek holds the device's file handle
+    int peekGeneration = 0;
+
+    void peek(const QString& path, uint32_t size, size_t bytes, PeekHandler done) {
+        peekActive = true;
+        int generation = peekGeneration;
+        auto head = std::make_shared<std::vector<uint8_t>>();
+        head->reserve(std::min<size_t>(bytes, size));
+        auto finish = [this, generation, head, done](bool ok) {
+            if (generation != peekGeneration) return;
+            peekActive = false;
+            done(ok, *head);
+        };
+        sendRequest(Pixl::Command::OpenFile, Pixl::Protocol::createOpenFilePayload(path.toStdString(), 0x08), path, 0,
+            [this, generation, head, size, bytes, finish](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                if (generation != peekGeneration) return;
+                if (pkt.status != 0 || corrupt || data.empty()) {
+                    finish(false);
+                    return;
+                }
+                uint8_t fileId = data[0];
+                sendRequest(Pixl::Command::ReadFile, {fileId}, QString(), size,
+                    [this, generation, fileId, head, bytes, finish](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                        if (generation != peekGeneration) return;
+                        // A bad tail doesn't matter if the head came through
+                        bool ok = head->size() >= bytes || (pkt.status == 0 && !corrupt);
+                        sendRequest(Pixl::Command::CloseFile, {fileId}, QString(), 0,
+                            [finish, ok](const Pixl::Packet&, const std::vector<uint8_t>&, bool) { finish(ok); });
+                    },
+                    [head, bytes](const std::vector<uint8_t>& chunk) {
+                        if (head->size() >= bytes) return;
+                        size_t n = std::min(bytes - head->size(), chunk.size());
+                        head->insert(head->end(), chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(n));
+                    });
+            });
+    }
+
+    // Rows on screen ask for a peek of their header; the model only looks
+    // up what is cached. Scrolling, resizing, new rows and changing folder
+    // all restart the timer, so a burst of them scans the rows once.
+    static constexpr int PEEK_SCAN_MS = 50;
+    QTimer *peekScanTimer = nullptr;
+
+    void schedulePeekScan() {
+        if (peekScanTimer) peekScanTimer->start();
+    }
+
+    void peekVisibleRows() {
+        QTreeView *view = q->remoteView;
+        if (!view->isVisible()) return;
+        const int bottom = view->viewport()->height();
+        for (QModelIndex index = view->indexAt(QPoint(0, 0)); index.isValid() && view->visualRect(index).top() < bottom;
+             index = view->indexBelow(index)) {
+            remoteModel->requestPeek(index);
+        }
+    }
+
+    void queuePeek(const QString& path) {
+        if (std::find(peekQueue.begin(), peekQueue.end(), path) == peekQueue.end()) peekQueue.push_back(path);
+        pumpPeek();
+    }
+
+    void pumpPeek() {
+        if (peekActive || mirrorBusy || !bleManager.isConnected() || bleManager.isReplaying() || !isIdle()) return;
+        QString folder = remoteNormalize(q->remotePathLabel->text());
+        while (!peekQueue.empty()) {
+            QString path = peekQueue.front();
+            peekQueue.pop_front();
+            // Only rows still on screen are worth the traffic
+            if (remoteParent(path) != folder) continue;
+            QModelIndex index = remoteModel->indexFromPath(path);
+            if (!index.isValid()) continue;
+            uint32_t size = remoteModel->fileSize(index);
+            QByteArray meta = remoteModel->fileMeta(index);
+            peek(path, size, Pixl::AmiiboHeader::HEADER_BYTES,
+                 [this, path, size, meta](bool ok, const std::vector<uint8_t>& head) {
+                if (ok) {
+                    auto header = Pixl::AmiiboHeader::decode(head);
+                    // Not an amiibo: cached as empty so it isn't peeked again
+                    headerCache->store(path, size, meta, header ? QString::fromStdString(header->summary()) : QString(""));
+                    remoteModel->headerChanged(path);
+                } else {
+                    qDebug() << "Peek of" << path << "failed";
+                }
+                if (!opQueue.empty()) {
+                    pumpOperations();
+                } else {
+                    pumpPeek();
+                    pumpMirror();
+                }
+            });
+            return;
+        }
+    }
+
+    // Optional check after uploads: every uploaded file is read back and
+    // its CRC-32 compared with the local source's. Local hashes come from
+    // the hash index, or are computed on the thread pool while the device
+    // is reading back. Zip entries use the CRC the archive records; tar
+    // entries have none and are left out.
+    struct VerifyFile {
+        QString remote;
+        QString local;
+        uint32_t size = 0;
+        bool localKnown = false;
+        uint32_t localCrc = 0;
+        bool remoteOk = false;
+        uint32_t remoteCrc = 0;
+    };
+    struct HashResult {
+        bool ok = false;
+        uint32_t crc = 0;
+    };
+    struct Verify {
+        std::vector<VerifyFile> files;
+        size_t next = 0; // Next file to read back
+        bool reading = false;
+        bool hashing = false;
+        bool cancelled = false;
+        int skipped = 0;
+        QElapsedTimer clock;
+    };
+    bool verifyUploads = false;
+    std::vector<VerifyFile> uploadedFiles; // Waiting for the next verify pass
+    int unverifiable = 0;
+    std::unique_ptr<Verify> verify;
+    std::unique_ptr<HashIndex> hashIndex;
+
+    void recordUpload(const Operation& op, uint32_t size) {
+        VerifyFile file;
+        file.remote = op.target;
+        file.size = size;
+        if (op.archive) {
+            if (!op.archive->hasCrc()) {
+                unverifiable++;
+                return;
+            }
+            file.localKnown = true;
+            file.localCrc = op.archive->entries()[op.entry].crc;
+        } else {
+            file.local = QFileInfo(op.source).absoluteFilePath();
+        }
+        uploadedFiles.push_back(file);
+    }
+
+    void startVerify() {
+        verify = std::make_unique<Verify>();
+        Verify* job = verify.get();
+        job->files = std::move(uploadedFiles);
+        job->skipped = unverifiable;
+        uploadedFiles.clear();
+        unverifiable = 0;
+        job->clock.start();
+
+        QStringList toHash;
+        std::vector<size_t> hashSlots;
+        std::vector<std::pair<qint64, qint64>> stamps; // Size and mtime when hashing started
+        for (size_t i = 0; i < job->files.size(); ++i) {
+            VerifyFile& file = job->files[i];
+            if (file.localKnown) continue;
+            QFileInfo info(file.local);
+            qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+            if (hashIndex->lookup(file.local, info.size(), mtime, &file.localCrc)) {
+                file.localKnown = true;
+                continue;
+            }
+            toHash << file.local;
+            hashSlots.push_back(i);
+            stamps.emplace_back(info.size(), mtime);
+        }
+        qDebug() << "Verifying" << job->files.size() << "upload(s):" << toHash.size() << "to hash locally,"
+                 << job->files.size() - toHash.size() << "hash(es) known";
+
+        totalOps += static_cast<int>(job->files.size());
+        if (progressDialog) {
+            progressDialog->setMaximum(totalOps);
+            progressDialog->setLabelText("Verifying...");
+        }
+
+        if (toHash.isEmpty()) return;
+        job->hashing = true;
+        auto *watcher = new QFutureWatcher<HashResult>(q);
+        QObject::connect(watcher, &QFutureWatcher<HashResult>::finished, q, [this, job, watcher, toHash, hashSlots, stamps]() {
+            watcher->deleteLater();
+            if (verify.get() != job) return;
+            for (int i = 0; i < toHash.size(); ++i) {
+                HashResult result = watcher->resultAt(i);
+                if (!result.ok) continue;
+                VerifyFile& file = job->files[hashSlots[i]];
+                file.localKnown = true;
+                file.localCrc = result.crc;
+                hashIndex->store(file.local, stamps[i].first, stamps[i].second, result.crc);
+            }
+            hashIndex->save();
+            job->hashing = false;
+            pumpOperations();
+        });
+        watcher->setFuture(QtConcurrent::mapped(toHash, [](const QString& path) {
+            HashResult result;
+            result.ok = HashIndex::hashFile(path, &result.crc);
+            return result;
+        }));
+    }
+
+    // Reads uploads back one at a time, hashing each chunk as it arrives.
+    // Called from pumpOperations like pumpBackup.
+    void pumpVerify() {
+        if (!verify || verify->reading) return;
+        Verify* job = verify.get();
+        if (job->cancelled || job->next >= job->files.size()) {
+            if (!job->hashing || job->cancelled) finishVerify();
+            return;
+        }
+
+        size_t index = job->next++;
+        job->reading = true;
+        const VerifyFile& file = job->files[index];
+        if (progressDialog) progressDialog->setLabelText(QString("Verifying: %1").arg(file.remote.section('/', -1)));
+
+        auto crc = std::make_shared<uint32_t>(HashIndex::update(0, nullptr, 0));
+        auto received = std::make_shared<uint64_t>(0);
+        auto done = [this, job, index, crc, received](bool ok) {
+            if (verify.get() != job) return;
+            VerifyFile& file = job->files[index];
+            file.remoteOk = ok && *received == file.size;
+            file.remoteCrc = *crc;
+            completedOps++;
+            if (progressDialog) progressDialog->setValue(completedOps);
+            job->reading = false;
+            pumpOperations();
+        };
+        sendRequest(Pixl::Command::OpenFile, Pixl::Protocol::createOpenFilePayload(file.remote.toStdString(), 0x08),
+                    file.remote, 0,
+            [this, job, size = file.size, crc, received, done](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                if (verify.get() != job) return;
+                if (pkt.status != 0 || corrupt || data.empty()) {
+                    done(false);
+                    return;
+                }
+                uint8_t fileId = data[0];
+                sendRequest(Pixl::Command::ReadFile, {fileId}, QString(), size,
+                    [this, job, fileId, done](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                        if (verify.get() != job) return;
+                        bool ok = pkt.status == 0 && !corrupt;
+                        sendRequest(Pixl::Command::CloseFile, {fileId}, QString(), 0,
+                            [done, ok](const Pixl::Packet&, const std::vector<uint8_t>&, bool) { done(ok); });
+                    },
+                    [crc, received](const std::vector<uint8_t>& chunk) {
+                        *crc = HashIndex::update(*crc, chunk.data(), chunk.size());
+                        *received += chunk.size();
+                    });
+            });
+    }
+
+    void finishVerify() {
+        std::unique_ptr<Verify> job = std::move(verify);
+        if (job->cancelled) {
+            qDebug() << "Verify cancelled";
+            return;
+        }
+        QStringList bad;
+        int unchecked = job->skipped;
+        for (const auto& file : job->files) {
+            if (!file.localKnown) {
+                qDebug() << "Verify: could not hash" << file.local;
+                unchecked++;
+            } else if (!file.remoteOk || file.remoteCrc != file.localCrc) {
+                qDebug() << "Verify:" << file.remote << (file.remoteOk ? "differs from" : "could not be read back to compare with")
+                         << (file.local.isEmpty() ? QString("its archive entry") : file.local);
+                bad << file.remote;
+            }
+        }
+        int verified = static_cast<int>(job->files.size()) - bad.size() - (unchecked - job->skipped);
+        qDebug() << "Verify finished:" << verified << "ok," << bad.size() << "bad," << unchecked << "unchecked in"
+                 << job->clock.elapsed() << "ms";
+
+        QString summary = QString("%1 uploaded file(s) verified.").arg(verified);
+        if (unchecked > 0) summary += QString("\n%1 file(s) could not be checked.").arg(unchecked);
+        if (!bad.isEmpty()) {
+            summary = QString("%1 uploaded file(s) do not match their source:\n%2%3\n\n")
+                          .arg(bad.size())
+                          .arg(bad.mid(0, 10).join('\n'))
+                          .arg(bad.size() > 10 ? QString("\n...") : QString()) + summary;
+        }
+        bool failed = !bad.isEmpty();
+        QMetaObject::invokeMethod(q, [this, summary, failed]() {
+            if (failed) QMessageBox::warning(q, "Verify", summary);
+            else QMessageBox::information(q, "Verify", summary);
+        }, Qt::QueuedConnection);
+    }
+
+    // Golden-image provisioning: format a drive, then replay a load plan
+    // onto it through the normal op queue.
+    // Each phase is timed and the result appended to a log next to the plan,
+    // one line per device.
+    struct Provision {
+        QString planFile;
+        QString drive;
+        QString device;
+        LoadPlan plan;
+        bool formatting = true;
+        bool failed = false;
+        bool cancelled = false;
+        qint64 formatMs = -1;
+        qint64 loadMs = -1;
+        QElapsedTimer clock;
+    };
+    std::unique_ptr<Provision> provision;
+
+    // The plan's hashes are the local side of the verify pass, so its
+    // uploads verify without reading the source tree again. Only files
+    // still exactly as hashed are stored; the rest get hashed when verified.
+    void rememberPlanHashes(const LoadPlan& plan) {
+        QDir source(plan.source());
+        for (const auto& item : plan.items()) {
+            if (item.folder) continue;
+            QString path = source.filePath(item.path);
+            QFileInfo info(path);
+            if (info.size() != item.size || info.lastModified().toMSecsSinceEpoch() != item.mtime) continue;
+            hashIndex->store(path, item.size, item.mtime, item.crc);
+        }
+        hashIndex->save();
+    }
+
+    void startProvision(const QString& planFile, const LoadPlan& plan, const QString& drive, QWidget* parent) {
+        if (backup || copy || !isIdle()) {
+            QMessageBox::information(parent, "Provision", "Wait for the current operation to finish first.");
+            return;
+        }
+        // Only ever format a drive the device listed, named as "E:/"
+        bool listed = false;
+        for (int i = 0; i < remoteModel->rowCount() && !listed; ++i) {
+            listed = remoteNormalize(remoteModel->filePath(remoteModel->index(i, 0))) == drive;
+        }
+        auto payload = drive.size() == 3 && drive.endsWith(":/")
+            ? Pixl::Protocol::createDriveFormatPayload(drive.at(0).toLatin1())
+            : std::vector<uint8_t>();
+        if (!listed || payload.empty()) {
+            QMessageBox::warning(parent, "Provision", QString("%1 is not a drive on this device.").arg(drive));
+            return;
+        }
+        provision = std::make_unique<Provision>();
+        Provision* job = provision.get();
+        job->planFile = planFile;
+        job->drive = drive;
+        job->device = reconnectAddress;
+        job->plan = plan;
+        job->clock.start();
+
+        rememberPlanHashes(plan);
+
+        qDebug() << "Provisioning" << job->device << drive << "from" << planFile << ":" << plan.fileCount()
+                 << "file(s)," << plan.totalBytes() << "bytes";
+        startOperations({}, QString("Formatting %1...").arg(drive), parent);
+
+        sendRequest(Pixl::Command::DriveFormat, payload, drive, 0,
+            [this, job](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                if (provision.get() != job) return;
+                job->formatting = false;
+                job->formatMs = job->clock.elapsed();
+                if (pkt.status != 0 || corrupt) {
+                    qDebug() << "Formatting" << job->drive << "failed with status:" << pkt.status;
+                    job->failed = true;
+                } else if (!job->cancelled) {
+                    remoteModel->onDirectoryListing(job->drive, {});
+                    remoteModel->setDriveUsage(job->drive, 0);
+                    QDir source(job->plan.source());
+                    std::vector<Operation> ops;
+                    ops.reserve(job->plan.items().size());
+                    for (const auto& item : job->plan.items()) {
+                        QString target = remoteJoin(job->drive, item.path);
+                        if (item.folder) ops.push_back({OpType::CreateFolder, QString(), target});
+                        else ops.push_back({OpType::UploadFile, source.filePath(item.path), target});
+                    }
+                    enqueueOperations(ops);
+                    if (progressDialog) progressDialog->setLabelText("Loading...");
+                }
+                pumpOperations();
+            });
+    }
+
+    // Called from pumpOperations once the op loop has run: waits for the
+    // plan to drain, then for the verify pass if there is one
+    void pumpProvision() {
+        if (!provision || provision->formatting) return;
+        if (!opQueue.empty() || transferActive || opsInFlight > 0 || verify) return;
+        Provision* job = provision.get();
+        if (job->loadMs < 0) job->loadMs = job->clock.elapsed() - job->formatMs;
+        if (!uploadedFiles.empty() && !job->cancelled && !job->failed) {
+            startVerify();
+            pumpVerify();
+            return;
+        }
+        finishProvision();
+    }
+
+    void finishProvision() {
+        std::unique_ptr<Provision> job = std::move(provision);
+        qint64 totalMs = job->clock.elapsed();
+        qint64 verifyMs = totalMs - job->formatMs - job->loadMs;
+        if (job->cancelled || job->failed) {
+            qDebug() << "Provisioning" << job->device << (job->failed ? "failed" : "cancelled") << "after" << totalMs << "ms";
+            if (job->failed) {
+                QString drive = job->drive;
+                QMetaObject::invokeMethod(q, [this, drive]() {
+                    QMessageBox::warning(q, "Provision", QString("%1 could not be formatted.").arg(drive));
+                }, Qt::QueuedConnection);
+            }
+            return;
+        }
+
+        qint64 bytes = job->plan.totalBytes();
+        double rate = job->loadMs > 0 ? bytes / 1024.0 / (job->loadMs / 1000.0) : 0.0;
+        qDebug() << "Provisioned" << job->device << job->drive << "in" << totalMs << "ms: format" << job->formatMs
+                 << "ms, load" << job->loadMs << "ms (" << rate << "KB/s ), verify" << verifyMs << "ms";
+
+        QFile log(job->planFile + ".log");
+        bool header = !log.exists();
+        if (log.open(QIODevice::Append | QIODevice::Text)) {
+            QTextStream out(&log);
+            if (header) out << "time\tdevice\tdrive\tfiles\tbytes\tformat_ms\tload_ms\tverify_ms\ttotal_ms\n";
+            out << QDateTime::currentDateTime().toString(Qt::ISODate) << '\t' << job->device << '\t' << job->drive << '\t'
+                << job->plan.fileCount() << '\t' << bytes << '\t' << job->formatMs << '\t' << job->loadMs << '\t'
+                << verifyMs << '\t' << totalMs << '\n';
         } else {
-            ops.push_back({OpType::UploadFile, localPath, remotePath});
+            qDebug() << "Could not write" << log.fileName() << ":" << log.errorString();
+        }
+
+        QString summary = QString("%1 loaded with %2 file(s) in %3 s.\n\nFormat: %4 s\nLoad: %5 s (%6 KB/s)")
+                              .arg(job->drive)
+                              .arg(job->plan.fileCount())
+                              .arg(totalMs / 1000.0, 0, 'f', 1)
+                              .arg(job->formatMs / 1000.0, 0, 'f', 1)
+                              .arg(job->loadMs / 1000.0, 0, 'f', 1)
+                              .arg(rate, 0, 'f', 1);
+        if (verifyMs > 0) summary += QString("\nVerify: %1 s").arg(verifyMs / 1000.0, 0, 'f', 1);
+        QMetaObject::invokeMethod(q, [this, summary]() {
+            QMessageBox::information(q, "Provision", summary);
+        }, Qt::QueuedConnection);
+    }
+
+    // Disconnected mid-way: whatever made it onto the drive stays, untimed
+    void abortProvision() {
+        if (!provision) return;
+        qDebug() << "Provisioning" << provision->device << "interrupted after" << provision->clock.elapsed() << "ms";
+        provision.reset();
+    }
+
+    // Upload ops for a dropped or selected local item going into remoteDir;
+    // an archive is unpacked on the way (see UploadPlan)
+    void scanUploadSource(const QString& localPath, const QString& remoteDir, std::vector<Operation>& ops) {
+        for (const UploadPlan::Item& item : UploadPlan::scan(localPath, remoteDir).items()) {
+            Operation op{item.folder ? OpType::CreateFolder : OpType::UploadFile, item.source, item.target};
+            op.archive = item.archive;
+            op.entry = item.entry;
+            ops.push_back(op);
         }
     }
 };
@@ -173,29 +1996,108 @@ FileManagerView::FileManagerView(QWidget *parent) : QWidget(parent) {
     connect(connectButton, &QPushButton::clicked, this, &FileManagerView::onConnectClicked);
     
     // Setup BLE callbacks
-    d->bleManager.initialize();
+    d->bleInit = QtConcurrent::run([this]() {
+        d->bleManager.initialize();
+        StartupReport::mark("BLE adapters ready");
+    });
+    d->autoReconnect = QSettings("Joysfusion", "JoyManager").value("autoReconnect", false).toBool();
+    d->verifyUploads = QSettings("Joysfusion", "JoyManager").value("verifyUploads", false).toBool();
+    d->hashIndex = std::make_unique<HashIndex>(
+        QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("hashes.json"));
     
+    d->prefetchTimer = new QTimer(this);
+    d->prefetchTimer->setSingleShot(true);
+    d->prefetchTimer->setInterval(FileManagerViewPrivate::PREFETCH_IDLE_MS);
+    connect(d->prefetchTimer, &QTimer::timeout, this, [this]() { d->prefetchNext(); });
+
     d->bleManager.setDataReceivedCallback([this](const std::vector<uint8_t>& data) {
-        // Handle data on UI thread
-        QMetaObject::invokeMethod(this, [this, data]() {
+        // Handle data on UI thread. The time spent waiting in the event loop
+        // shows up in traces as its own span.
+        int64_t notifiedAt = Tracer::enabled() ? Tracer::now() : -1;
+        QMetaObject::invokeMethod(this, [this, data, notifiedAt]() {
+            if (notifiedAt >= 0) {
+                Tracer::complete("queued notification", "eventloop", notifiedAt, Tracer::now() - notifiedAt);
+            }
             handleBleData(data);
+            d->schedulePrefetch();
         }, Qt::QueuedConnection);
     });
     
      d->bleManager.setDisconnectedCallback([this]() {
           QMetaObject::invokeMethod(this, [this]() {
-             connectButton->setText("Connect to Device");
-             connectButton->setEnabled(true);
-             d->remoteModel->clear();
-             QMessageBox::warning(this, "Disconnected", "Device disconnected");
+             onDisconnected();
          }, Qt::QueuedConnection);
      });
     
+    d->bleManager.setReplayFinishedCallback([this](const std::string& summary) {
+        QMetaObject::invokeMethod(this, [this, summary]() {
+            connectButton->setText("Connect to Device");
+            connectButton->setEnabled(true);
+            d->pendingRequests.clear();
+            d->resetOperations();
+            QMessageBox::information(this, "Replay Finished", QString::fromStdString(summary));
+        }, Qt::QueuedConnection);
+    });
+
     // Connect Model
     connect(d->remoteModel, &RemoteFileSystemModel::fetchRequested, this, &FileManagerView::onFetchRequested);
+
+    setupLink();
+}
+
+void FileManagerView::setupLink() {
+    d->link = new LinkClient(this);
+
+    connect(d->link, &LinkClient::attached, this, [this]() {
+        qDebug() << "Attached to link service";
+        d->link->requestStatus();
+    });
+    connect(d->link, &LinkClient::detached, this, [this]() {
+        if (d->bleManager.hasExternalLink()) {
+            d->bleManager.detachExternalLink();
+            onDisconnected();
+        }
+    });
+    // Another process kept the device connected, so start warm
+    connect(d->link, &LinkClient::status, this, [this](bool connected, const QString &address, const QString &adapter) {
+        if (!connected || d->bleManager.isConnected()) return;
+        d->bleManager.attachExternalLink([this](const std::vector<uint8_t> &packet) {
+            d->link->sendPacket(packet);
+        });
+        d->reconnectAddress = address;
+        onConnected(address, adapter);
+    });
+    connect(d->link, &LinkClient::deviceConnected, this, [this](bool ok, const QString &address, const QString &adapter) {
+        bool requested = d->linkConnectPending;
+        d->linkConnectPending = false;
+        if (ok && !d->bleManager.isConnected()) {
+            d->bleManager.attachExternalLink([this](const std::vector<uint8_t> &packet) {
+                d->link->sendPacket(packet);
+            });
+            if (requested) {
+                onConnectFinished(true, address, adapter);
+            } else {
+                d->reconnectAddress = address;
+                onConnected(address, adapter);
+            }
+        } else if (!ok && requested) {
+            onConnectFinished(false, address, adapter);
+        }
+    });
+    connect(d->link, &LinkClient::deviceDisconnected, this, [this]() {
+        if (!d->bleManager.hasExternalLink()) return;
+        d->bleManager.detachExternalLink();
+        onDisconnected();
+    });
+    connect(d->link, &LinkClient::notification, this, [this](const QByteArray &packet) {
+        d->bleManager.deliverNotification(std::vector<uint8_t>(packet.begin(), packet.end()));
+    });
+
+    d->link->connectToServiceAsync();
 }
 
 FileManagerView::~FileManagerView() {
+    d->bleInit.waitForFinished();
     QSettings settings("Joysfusion", "JoyManager");
     settings.setValue("localPath", localModel->filePath(localView->rootIndex()));
     settings.setValue("localHeaderState", localView->header()->saveState());
@@ -221,12 +2123,12 @@ void FileManagerView::setupUi() {
     
     localView = new QTreeView(localWidget);
     localModel = new QFileSystemModel(this);
-    localModel->setRootPath(QDir::homePath());
     localView->setModel(localModel);
     
+    // Only the folder being shown is loaded and watched, not all of home
     QString lastLocalPath = settings.value("localPath", QDir::homePath()).toString();
-    localView->setRootIndex(localModel->index(lastLocalPath));
-    localPathLabel->setText(lastLocalPath);
+    if (!QFileInfo(lastLocalPath).isDir()) lastLocalPath = QDir::homePath();
+    setLocalRoot(lastLocalPath);
 
     localView->setRootIsDecorated(false);
     localView->setItemsExpandable(false);
@@ -257,7 +2159,21 @@ void FileManagerView::setupUi() {
     
     d->remoteModel = new RemoteFileSystemModel(this);
     d->remoteModel->setBleManager(&d->bleManager);
+    d->headerCache = std::make_unique<HeaderCache>(
+        QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("headers.json"));
+    d->remoteModel->setHeaderCache(d->headerCache.get());
+    connect(d->remoteModel, &RemoteFileSystemModel::peekRequested, this, [this](const QString &path) {
+        d->queuePeek(path);
+    });
     remoteView->setModel(d->remoteModel);
+    d->peekScanTimer = new QTimer(this);
+    d->peekScanTimer->setSingleShot(true);
+    d->peekScanTimer->setInterval(FileManagerViewPrivate::PEEK_SCAN_MS);
+    connect(d->peekScanTimer, &QTimer::timeout, this, [this]() { d->peekVisibleRows(); });
+    connect(remoteView->verticalScrollBar(), &QScrollBar::valueChanged, this, [this]() { d->schedulePeekScan(); });
+    connect(d->remoteModel, &QAbstractItemModel::rowsInserted, this, [this]() { d->schedulePeekScan(); });
+    connect(d->remoteModel, &QAbstractItemModel::modelReset, this, [this]() { d->schedulePeekScan(); });
+    connect(d->remoteModel, &QAbstractItemModel::layoutChanged, this, [this]() { d->schedulePeekScan(); });
     remoteView->setRootIsDecorated(false);
     remoteView->setItemsExpandable(false);
     remoteView->header()->setSectionResizeMode(0, QHeaderView::Stretch);
@@ -270,8 +2186,22 @@ void FileManagerView::setupUi() {
     remoteLayout->addWidget(remoteLabel);
     remoteLayout->addWidget(connectButton);
     remoteLayout->addWidget(remoteUpButton);
+    remoteSearch = new QLineEdit(remoteWidget);
+    remoteSearch->setPlaceholderText("Search device files");
+    remoteSearch->setClearButtonEnabled(true);
+    crawlButton = new QPushButton("Index All", remoteWidget);
+    crawlButton->setCheckable(true);
+    crawlButton->setToolTip("List every folder on the device in the background so search covers all of it");
+    searchResults = new QListWidget(remoteWidget);
+    searchResults->hide();
+    QHBoxLayout *searchLayout = new QHBoxLayout();
+    searchLayout->addWidget(remoteSearch);
+    searchLayout->addWidget(crawlButton);
+
     remoteLayout->addWidget(remotePathLabel);
+    remoteLayout->addLayout(searchLayout);
     remoteLayout->addWidget(remoteView);
+    remoteLayout->addWidget(searchResults);
     
     // Add to Splitter
     splitter->addWidget(localWidget);
@@ -288,11 +2218,8 @@ void FileManagerView::setupUi() {
             QString localPath = localModel->filePath(index);
             if (localPath.isEmpty()) return;
             
-            QFileInfo fi(localPath);
-            QString remotePath = d->lastRequestedPath + (d->lastRequestedPath.endsWith("/") ? "" : "/") + fi.fileName();
-            
             std::vector<FileManagerViewPrivate::Operation> ops;
-            d->recursiveScan(localPath, remotePath, ops);
+            d->scanUploadSource(localPath, d->lastRequestedPath, ops);
             d->startOperations(ops, "Uploading...", this);
         });
         menu.exec(localView->mapToGlobal(pos));
@@ -323,14 +2250,59 @@ void FileManagerView::setupUi() {
             QString targetDir = QFileDialog::getExistingDirectory(this, "Select Download Directory");
             if (targetDir.isEmpty()) return;
 
-            std::vector<FileManagerViewPrivate::Operation> ops;
-            for (const auto& index : selected) {
-                QString remotePath = d->remoteModel->filePath(index);
-                QFileInfo fi(remotePath);
-                QString localPath = QDir(targetDir).absoluteFilePath(fi.fileName());
-                ops.push_back({FileManagerViewPrivate::OpType::DownloadFile, remotePath, localPath});
+            d->startDownload(selected, targetDir, this);
+        });
+        menu.addAction("Copy to...", [this]() {
+            QModelIndexList selected = remoteView->selectionModel()->selectedRows();
+            if (selected.isEmpty()) return;
+
+            bool ok = false;
+            QString targetDir = QInputDialog::getText(this, "Copy", "Destination folder on device:",
+                                                      QLineEdit::Normal, d->lastRequestedPath, &ok).trimmed();
+            if (!ok || targetDir.isEmpty()) return;
+
+            QStringList paths;
+            for (const auto& index : selected) paths << d->remoteModel->filePath(index);
+            d->startLocalCopy(paths, targetDir, this);
+        });
+        menu.addAction("Copy to Another Device...", [this]() {
+            QModelIndexList selected = remoteView->selectionModel()->selectedRows();
+            if (selected.isEmpty()) return;
+            copyToPeer(selected);
+        });
+        menu.addAction("Rename...", [this]() {
+            QModelIndexList selected = remoteView->selectionModel()->selectedRows();
+            if (selected.size() != 1) return;
+
+            QString oldPath = d->remoteModel->filePath(selected.first());
+            QString oldName = selected.first().data().toString();
+            bool ok = false;
+            QString newName = QInputDialog::getText(this, "Rename", "New name:", QLineEdit::Normal, oldName, &ok).trimmed();
+            if (!ok || newName.isEmpty() || newName == oldName) return;
+            if (newName.contains('/')) {
+                QMessageBox::warning(this, "Rename", "Names can't contain '/'. Use Move to... to change folders.");
+                return;
+            }
+
+            QString newPath = FileManagerViewPrivate::remoteJoin(FileManagerViewPrivate::remoteParent(oldPath), newName);
+            d->startOperations({{FileManagerViewPrivate::OpType::Rename, oldPath, newPath}}, "Renaming...", this);
+        });
+        menu.addAction("Move to...", [this]() {
+            QModelIndexList selected = remoteView->selectionModel()->selectedRows();
+            if (selected.isEmpty()) return;
+
+            bool ok = false;
+            QString targetDir = QInputDialog::getText(this, "Move", "Destination folder on device:",
+                                                      QLineEdit::Normal, d->lastRequestedPath, &ok).trimmed();
+            if (!ok || targetDir.isEmpty()) return;
+
+            QStringList paths;
+            for (const auto& index : selected) paths << d->remoteModel->filePath(index);
+            auto ops = d->buildMoves(paths, targetDir);
+            if (!ops.empty()) {
+                d->remoteModel->markStale(targetDir);
+                d->startOperations(ops, "Moving...", this);
             }
-            d->startOperations(ops, "Downloading...", this);
         });
         menu.addAction("Delete", [this]() {
             QModelIndexList selected = remoteView->selectionModel()->selectedRows();
@@ -340,12 +2312,12 @@ void FileManagerView::setupUi() {
                                              QString("Are you sure you want to delete %1 selected items?").arg(selected.size()),
                                              QMessageBox::Yes | QMessageBox::No);
             if (reply == QMessageBox::Yes) {
-                std::vector<FileManagerViewPrivate::Operation> ops;
+                QStringList files, folders;
                 for (const auto& index : selected) {
                     QString path = d->remoteModel->filePath(index);
-                    ops.push_back({FileManagerViewPrivate::OpType::DeleteFile, "", path});
+                    (d->remoteModel->isDir(index) ? folders : files) << path;
                 }
-                d->startOperations(ops, "Deleting...", this);
+                d->startDelete(files, folders, this);
             }
         });
         menu.exec(remoteView->mapToGlobal(pos));
@@ -355,8 +2327,7 @@ void FileManagerView::setupUi() {
     connect(localUpButton, &QPushButton::clicked, [this]() {
         QModelIndex parent = localView->rootIndex().parent();
         if (parent.isValid()) {
-            localView->setRootIndex(parent);
-            localPathLabel->setText(localModel->filePath(parent));
+            setLocalRoot(localModel->filePath(parent));
         }
     });
 
@@ -364,12 +2335,13 @@ void FileManagerView::setupUi() {
         QModelIndex parent = remoteView->rootIndex().parent();
         remoteView->setRootIndex(parent);
         remotePathLabel->setText(d->remoteModel->filePath(parent));
+        d->schedulePeekScan();
+        d->schedulePrefetch();
     });
 
     connect(localView, &QTreeView::doubleClicked, [this](const QModelIndex &index) {
         if (localModel->isDir(index)) {
-            localView->setRootIndex(index);
-            localPathLabel->setText(localModel->filePath(index));
+            setLocalRoot(localModel->filePath(index));
         }
     });
 
@@ -377,8 +2349,88 @@ void FileManagerView::setupUi() {
         if (d->remoteModel->isDir(index)) {
             remoteView->setRootIndex(index);
             remotePathLabel->setText(d->remoteModel->filePath(index));
+            d->schedulePeekScan();
+            d->schedulePrefetch();
+        }
+    });
+
+    // Search runs against the index on every keystroke. New listings, e.g.
+    // from the crawl, refresh the results once they stop arriving.
+    QTimer *searchRefresh = new QTimer(this);
+    searchRefresh->setSingleShot(true);
+    searchRefresh->setInterval(200);
+    connect(searchRefresh, &QTimer::timeout, this, &FileManagerView::runSearch);
+    connect(remoteSearch, &QLineEdit::textChanged, this, &FileManagerView::runSearch);
+    connect(d->remoteModel, &QAbstractItemModel::rowsInserted, searchRefresh, [this, searchRefresh]() {
+        if (!remoteSearch->text().isEmpty()) searchRefresh->start();
+    });
+    connect(d->remoteModel, &QAbstractItemModel::modelReset, this, &FileManagerView::runSearch);
+    connect(searchResults, &QListWidget::itemActivated, [this](QListWidgetItem *item) {
+        showRemotePath(item->data(Qt::UserRole).toString(), item->data(Qt::UserRole + 1).toBool());
+    });
+    connect(crawlButton, &QPushButton::toggled, [this](bool on) {
+        d->crawling = on;
+        if (on) {
+            qDebug() << "Crawling the device for search";
+            d->schedulePrefetch();
         }
     });
+    connect(this, &FileManagerView::crawlFinished, crawlButton, [this]() {
+        QSignalBlocker blocker(crawlButton);
+        crawlButton->setChecked(false);
+    });
+}
+
+void FileManagerView::runSearch() {
+    static constexpr size_t MAX_RESULTS = 500;
+    QString query = remoteSearch->text().trimmed();
+    searchResults->setVisible(!query.isEmpty());
+    remoteView->setVisible(query.isEmpty());
+    searchResults->clear();
+    if (query.isEmpty()) {
+        d->schedulePeekScan();
+        return;
+    }
+
+    TraceSpan span("search", "gui");
+    const RemoteSearchIndex &index = d->remoteModel->searchIndex();
+    for (const auto &result : index.search(query.toStdString(), MAX_RESULTS)) {
+        QString path = QString::fromStdString(result.path);
+        auto *item = new QListWidgetItem(result.folder ? path + "/" : path, searchResults);
+        item->setData(Qt::UserRole, path);
+        item->setData(Qt::UserRole + 1, result.folder);
+        if (!result.folder) item->setToolTip(QString("%1 bytes").arg(result.size));
+    }
+    if (searchResults->count() == 0) {
+        auto *item = new QListWidgetItem(QString("No matches among %1 listed items").arg(index.size()), searchResults);
+        item->setFlags(Qt::NoItemFlags);
+    }
+}
+
+void FileManagerView::showRemotePath(const QString &path, bool folder) {
+    QString dir = folder ? path : FileManagerViewPrivate::remoteParent(path);
+    QModelIndex dirIndex = d->remoteModel->indexFromPath(dir);
+    if (!dirIndex.isValid() && dir != "/") return;
+    remoteSearch->clear();
+    remoteView->setRootIndex(dirIndex);
+    remotePathLabel->setText(d->remoteModel->filePath(dirIndex));
+    d->schedulePeekScan();
+    if (!folder) {
+        QModelIndex index = d->remoteModel->indexFromPath(path);
+        remoteView->setCurrentIndex(index);
+        remoteView->scrollTo(index);
+    }
+    d->schedulePrefetch();
+}
+
+void FileManagerView::setLocalRoot(const QString &path) {
+    localModel->setRootPath(path);
+    localView->setRootIndex(localModel->index(path));
+    localPathLabel->setText(path);
+}
+
+TransferMetrics* FileManagerView::metrics() const {
+    return &d->metrics;
 }
 
 void FileManagerView::setBleManager(void* manager) {
@@ -386,66 +2438,445 @@ void FileManagerView::setBleManager(void* manager) {
 }
 
 void FileManagerView::onConnectClicked() {
+    // A deliberate disconnect must not trigger auto-reconnect
+    d->reconnectAddress.clear();
+    if (d->bleManager.hasExternalLink()) {
+        d->link->disconnectDevice();
+        return;
+    }
     if (d->bleManager.isConnected()) {
         d->bleManager.disconnect();
         return;
     }
     
-    // Show Dialog
+    d->ensureBleInitialized();
+
+    if (d->link->isAttached()) {
+        // The link service owns the adapter, so scan and connect through it
+        DeviceSelectionDialog dialog(this);
+        d->addKnownDevices(dialog);
+        auto found = connect(d->link, &LinkClient::deviceFound, &dialog, &DeviceSelectionDialog::addDevice);
+        connect(&dialog, &DeviceSelectionDialog::scanRequested, [this, &dialog]() {
+            d->link->stopScan();
+            dialog.clearDevices();
+            d->addKnownDevices(dialog);
+            d->link->startScan(dialog.pixlOnly());
+        });
+        d->link->startScan(dialog.pixlOnly());
+
+        bool accepted = dialog.exec() == QDialog::Accepted;
+        disconnect(found);
+        d->link->stopScan();
+        if (accepted && !dialog.getSelectedAddress().isEmpty()) {
+            connectToDevice(dialog.getSelectedAddress(), dialog.getSelectedName());
+        }
+        return;
+    }
+
+    QString name;
+    QString address = pickDevice(d->bleManager, QString(), &name);
+    if (!address.isEmpty()) {
+        connectToDevice(address, name);
+    }
+}
+
+QString FileManagerView::pickDevice(BleManager &manager, const QString &title, QString *name) {
     DeviceSelectionDialog dialog(this);
-    
+    if (!title.isEmpty()) dialog.setWindowTitle(title);
+    d->addKnownDevices(dialog);
+
     // Start scan immediately or on dialog open
-    d->bleManager.startScan([&dialog](const std::string& name, const std::string& address) {
-        QMetaObject::invokeMethod(&dialog, [&dialog, name, address]() {
-            dialog.addDevice(QString::fromStdString(name), QString::fromStdString(address));
+    auto onFound = [&dialog](const std::string& name, const std::string& address, int16_t rssi) {
+        QMetaObject::invokeMethod(&dialog, [&dialog, name, address, rssi]() {
+            dialog.addDevice(QString::fromStdString(name), QString::fromStdString(address), rssi);
         });
-    });
+    };
+    manager.setScanFilter(dialog.pixlOnly());
+    manager.startScan(onFound);
     
     // Handle rescan
-    connect(&dialog, &DeviceSelectionDialog::scanRequested, [this, &dialog]() {
-         d->bleManager.stopScan();
+    connect(&dialog, &DeviceSelectionDialog::scanRequested, [this, &manager, &dialog, onFound]() {
+         manager.stopScan();
          dialog.clearDevices();
-         d->bleManager.startScan([&dialog](const std::string& name, const std::string& address) {
-            QMetaObject::invokeMethod(&dialog, [&dialog, name, address]() {
-                dialog.addDevice(QString::fromStdString(name), QString::fromStdString(address));
-            });
-        });
+         d->addKnownDevices(dialog);
+         manager.setScanFilter(dialog.pixlOnly());
+         manager.startScan(onFound);
     });
     
-    if (dialog.exec() == QDialog::Accepted) {
-        d->bleManager.stopScan();
-        QString address = dialog.getSelectedAddress();
-        if (!address.isEmpty()) {
-             connectButton->setEnabled(false);
-             connectButton->setText("Connecting...");
-             
-             // Use QFutureWatcher to handle async result
-             auto watcher = new QFutureWatcher<bool>(this);
-             connect(watcher, &QFutureWatcher<bool>::finished, [this, watcher]() {
-                 bool success = watcher->result();
-                 if (success) {
-                     connectButton->setText("Disconnect");
-                     connectButton->setEnabled(true);
-                     
-                     // Step 1: Get Version (Triggered from background or here)
-                     d->bleManager.sendCommand(Pixl::Command::GetVersion);
-                 } else {
-                     connectButton->setText("Connect to Device");
-                     connectButton->setEnabled(true);
-                     QMessageBox::warning(this, "Connection Failed", "Could not connect to device.");
-                 }
-                 watcher->deleteLater();
-             });
-
-             // Run connect in background
-             QFuture<bool> future = QtConcurrent::run([this, address]() {
-                 return d->bleManager.connect(address.toStdString());
-             });
-             watcher->setFuture(future);
-        }
-    } else {
-        d->bleManager.stopScan();
+    bool accepted = dialog.exec() == QDialog::Accepted;
+    manager.stopScan();
+    if (!accepted) return QString();
+    if (name) *name = dialog.getSelectedName();
+    return dialog.getSelectedAddress();
+}
+
+void FileManagerView::copyToPeer(const QModelIndexList &selected) {
+    // The selection can change while the dialogs are up
+    auto sources = d->copySources(selected);
+    if (d->copy) {
+        QMessageBox::information(this, "Copy", "A copy is already running.");
+        return;
+    }
+
+    // The destination gets its own session; with several adapters it lands
+    // on a different radio than the source. It reuses the adapters the main
+    // session enumerated off the GUI thread at startup.
+    if (!d->bleInit.isFinished()) {
+        QMessageBox::information(this, "Copy", "Bluetooth is still starting up. Try again in a moment.");
+        return;
+    }
+    if (!d->peer) {
+        d->peer = std::make_unique<BleManager>();
+        d->peer->shareAdapters(d->bleManager);
+        d->peer->setDataReceivedCallback([this](const std::vector<uint8_t>& data) {
+            QMetaObject::invokeMethod(this, [this, data]() { d->handlePeerData(data); }, Qt::QueuedConnection);
+        });
+        d->peer->setDisconnectedCallback([this]() {
+            QMetaObject::invokeMethod(this, [this]() { d->onPeerLost(); }, Qt::QueuedConnection);
+        });
+    }
+
+    QString name;
+    QString address = pickDevice(*d->peer, "Select Destination Device", &name);
+    if (address.isEmpty()) return;
+    if (address.compare(d->reconnectAddress, Qt::CaseInsensitive) == 0) {
+        QMessageBox::warning(this, "Copy", "Choose a different device than the one being copied from.");
+        return;
+    }
+
+    bool ok = false;
+    QString targetDir = QInputDialog::getText(this, "Copy to Another Device", "Destination folder on that device:",
+                                              QLineEdit::Normal, d->lastRequestedPath, &ok).trimmed();
+    if (!ok || targetDir.isEmpty()) return;
+
+    auto watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, [this, watcher, sources, targetDir, name, address]() {
+        watcher->deleteLater();
+        if (!watcher->result()) {
+            QMessageBox::warning(this, "Copy", "Could not connect to the destination device.");
+            return;
+        }
+        qDebug() << "Copying to" << address << "on" << QString::fromStdString(d->peer->adapterIdentifier());
+        d->startStreamCopy(sources, targetDir,
+            [this](Pixl::Command cmd, const std::vector<uint8_t>& payload, StreamCopy::Reply reply) {
+                d->sendToPeer(cmd, payload, std::move(reply));
+            },
+            // The other device's firmware isn't asked, so it gets the baseline
+            FileManagerViewPrivate::PEER_PIPE_CAPACITY, FileManagerViewPrivate::CHUNK_SIZE, QString("Copying to %1...").arg(name.isEmpty() ? address : name),
+            this, [this]() { d->releasePeer(); });
+    });
+    watcher->setFuture(QtConcurrent::run([this, address]() {
+        return d->peer->connect(address.toStdString());
+    }));
+}
+
+void FileManagerView::connectToDevice(const QString &address, const QString &name) {
+    if (!name.isEmpty()) d->connectingName = name;
+    connectButton->setEnabled(false);
+    connectButton->setText(d->reconnectAttempts > 0 ? "Reconnecting..." : "Connecting...");
+
+    if (d->link->isAttached()) {
+        d->linkConnectPending = true;
+        d->link->connectDevice(address);
+        return;
+    }
+
+    // Use QFutureWatcher to handle async result
+    auto watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, [this, watcher, address]() {
+        onConnectFinished(watcher->result(), address, QString::fromStdString(d->bleManager.adapterIdentifier()));
+        watcher->deleteLater();
+    });
+
+    // Run connect in background; unknown addresses get a targeted scan
+    QFuture<bool> future = QtConcurrent::run([this, address]() {
+        d->bleInit.waitForFinished();
+        return d->bleManager.connect(address.toStdString());
+    });
+    watcher->setFuture(future);
+}
+
+void FileManagerView::onConnectFinished(bool ok, const QString &address, const QString &adapter) {
+    if (ok) {
+        d->rememberDevice(address, d->connectingName);
+        d->reconnectAddress = address;
+        d->reconnectAttempts = 0;
+        onConnected(address, adapter);
+        return;
+    }
+
+    if (!d->reconnectAddress.isEmpty() && ++d->reconnectAttempts < FileManagerViewPrivate::MAX_RECONNECT_ATTEMPTS) {
+        scheduleReconnect();
+        return;
+    }
+
+    bool wasReconnecting = !d->reconnectAddress.isEmpty();
+    d->reconnectAddress.clear();
+    d->reconnectAttempts = 0;
+    d->restorePath.clear();
+    connectButton->setText("Connect to Device");
+    connectButton->setEnabled(true);
+    QMessageBox::warning(this, "Connection Failed", wasReconnecting
+        ? "Device disconnected and could not be reconnected."
+        : "Could not connect to device.");
+}
+
+void FileManagerView::scheduleReconnect() {
+    // 1, 2, 4, 8... seconds between attempts
+    int delayMs = 1000 << qMin(d->reconnectAttempts, 4);
+    qDebug() << "Reconnecting to" << d->reconnectAddress << "in" << delayMs << "ms, attempt" << d->reconnectAttempts + 1;
+    connectButton->setEnabled(false);
+    connectButton->setText("Reconnecting...");
+    QTimer::singleShot(delayMs, this, [this]() {
+        if (d->reconnectAddress.isEmpty() || d->bleManager.isConnected()) return;
+        connectToDevice(d->reconnectAddress, QString());
+    });
+}
+
+void FileManagerView::setAutoReconnect(bool enabled) {
+    d->autoReconnect = enabled;
+    QSettings settings("Joysfusion", "JoyManager");
+    settings.setValue("autoReconnect", enabled);
+}
+
+bool FileManagerView::autoReconnect() const {
+    return d->autoReconnect;
+}
+
+void FileManagerView::setVerifyUploads(bool enabled) {
+    d->verifyUploads = enabled;
+    QSettings("Joysfusion", "JoyManager").setValue("verifyUploads", enabled);
+}
+
+bool FileManagerView::verifyUploads() const {
+    return d->verifyUploads;
+}
+
+void FileManagerView::backupDevice() {
+    if (!d->bleManager.isConnected()) {
+        QMessageBox::warning(this, "Backup", "Connect to a device first.");
+        return;
+    }
+    QSettings settings("Joysfusion", "JoyManager");
+    QString folder = QFileDialog::getExistingDirectory(this, "Select Backup Folder",
+                                                       settings.value("backupFolder").toString());
+    if (folder.isEmpty()) return;
+    settings.setValue("backupFolder", folder);
+    d->startBackup(folder, this);
+}
+
+void FileManagerView::createLoadPlan() {
+    QSettings settings("Joysfusion", "JoyManager");
+    QString source = QFileDialog::getExistingDirectory(this, "Select Folder to Load onto Devices",
+                                                       settings.value("planSource").toString());
+    if (source.isEmpty()) return;
+    QString suggested = QDir(QFileInfo(settings.value("planFile").toString()).absolutePath())
+                            .filePath(QFileInfo(source).fileName() + ".joyplan");
+    QString file = QFileDialog::getSaveFileName(this, "Save Load Plan", suggested, "Load plans (*.joyplan)");
+    if (file.isEmpty()) return;
+    settings.setValue("planSource", source);
+    settings.setValue("planFile", file);
+
+    auto *progress = new QProgressDialog("Hashing files...", QString(), 0, 0, this);
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setMinimumDuration(0);
+    progress->show();
+
+    auto *watcher = new QFutureWatcher<LoadPlan>(this);
+    connect(watcher, &QFutureWatcher<LoadPlan>::finished, this, [this, watcher, progress, file]() {
+        watcher->deleteLater();
+        progress->close();
+        progress->deleteLater();
+        LoadPlan plan = watcher->result();
+        QString error = plan.error();
+        if (plan.isValid() && plan.save(file, &error)) {
+            d->rememberPlanHashes(plan);
+            QMessageBox::information(this, "Load Plan", QString("Plan for %1 file(s), %2 bytes, saved to %3.")
+                                                            .arg(plan.fileCount()).arg(plan.totalBytes()).arg(file));
+        } else {
+            QMessageBox::warning(this, "Load Plan", QString("The plan could not be created: %1").arg(error));
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([source]() { return LoadPlan::build(source); }));
+}
+
+void FileManagerView::provisionDevice() {
+    if (!d->bleManager.isConnected()) {
+        QMessageBox::warning(this, "Provision", "Connect to a device first.");
+        return;
+    }
+    if (isMirroring()) {
+        QMessageBox::information(this, "Provision", "Stop the mirror first.");
+        return;
+    }
+    QSettings settings("Joysfusion", "JoyManager");
+    QString file = QFileDialog::getOpenFileName(this, "Open Load Plan", settings.value("planFile").toString(),
+                                                "Load plans (*.joyplan)");
+    if (file.isEmpty()) return;
+    settings.setValue("planFile", file);
+
+    QString error;
+    LoadPlan plan = LoadPlan::load(file, &error);
+    if (!plan.isValid()) {
+        QMessageBox::warning(this, "Provision", QString("Could not read %1: %2").arg(file, error));
+        return;
+    }
+    QStringList changed = plan.changedFiles();
+    if (!changed.isEmpty()) {
+        QMessageBox::warning(this, "Provision", QString("%1 file(s) changed since the plan was made, e.g. %2.\n"
+                                                        "Create the plan again.").arg(changed.size()).arg(changed.first()));
+        return;
+    }
+
+    QStringList drives;
+    for (int i = 0; i < d->remoteModel->rowCount(); ++i) {
+        drives << FileManagerViewPrivate::remoteNormalize(d->remoteModel->filePath(d->remoteModel->index(i, 0)));
+    }
+    if (drives.isEmpty()) {
+        QMessageBox::warning(this, "Provision", "No drives to provision.");
+        return;
     }
+    QString drive = drives.first();
+    if (drives.size() > 1) {
+        bool ok = false;
+        drive = QInputDialog::getItem(this, "Provision", "Drive to format:", drives, 0, false, &ok);
+        if (!ok) return;
+    }
+    auto answer = QMessageBox::question(this, "Provision",
+        QString("Erase everything on %1 and load %2 file(s) from %3?").arg(drive).arg(plan.fileCount()).arg(plan.source()));
+    if (answer != QMessageBox::Yes) return;
+    d->startProvision(file, plan, drive, this);
+}
+
+void FileManagerView::restoreBackup() {
+    if (!d->bleManager.isConnected()) {
+        QMessageBox::warning(this, "Restore", "Connect to a device first.");
+        return;
+    }
+    QSettings settings("Joysfusion", "JoyManager");
+    QString index = QFileDialog::getOpenFileName(this, "Select Snapshot to Restore", settings.value("backupFolder").toString(),
+                                                 "Backup snapshots (snapshot-*.json)");
+    if (index.isEmpty()) return;
+    auto answer = QMessageBox::question(this, "Restore",
+        QString("Upload every file of %1 back to the device? Files with the same names are overwritten.")
+            .arg(QFileInfo(index).completeBaseName()));
+    if (answer != QMessageBox::Yes) return;
+    d->startRestore(index, this);
+}
+
+bool FileManagerView::startMirror() {
+    if (!d->bleManager.isConnected()) {
+        QMessageBox::warning(this, "Mirror", "Connect to a device first.");
+        return false;
+    }
+    QSettings settings("Joysfusion", "JoyManager");
+    QString local = QFileDialog::getExistingDirectory(this, "Select Folder to Mirror",
+                                                      settings.value("mirrorLocal").toString());
+    if (local.isEmpty()) return false;
+    QString current = remotePathLabel->text().isEmpty() ? QString("E:/") : remotePathLabel->text();
+    QString suggested = settings.value("mirrorLocal").toString() == local
+        ? settings.value("mirrorTarget").toString()
+        : FileManagerViewPrivate::remoteJoin(current, QFileInfo(local).fileName());
+    bool ok = false;
+    QString target = QInputDialog::getText(this, "Mirror", "Mirror into this folder on the device:",
+                                           QLineEdit::Normal, suggested, &ok).trimmed();
+    if (!ok || target.isEmpty()) return false;
+    settings.setValue("mirrorLocal", local);
+    settings.setValue("mirrorTarget", target);
+    d->startMirror(local, target);
+    return true;
+}
+
+void FileManagerView::stopMirror() {
+    d->stopMirror();
+}
+
+bool FileManagerView::isMirroring() const {
+    return !d->mirrorLocal.isEmpty();
+}
+
+void FileManagerView::onConnected(const QString &address, const QString &adapter) {
+    connectButton->setText("Disconnect");
+    connectButton->setEnabled(true);
+    d->metrics.setDevice(address, adapter);
+
+    // Step 1: Get Version (Triggered from background or here)
+    d->pendingRequests.clear();
+    d->sendRequest(Pixl::Command::GetVersion);
+    d->resumeMirror();
+}
+
+void FileManagerView::onDisconnected() {
+    // Remember where we were before the model is cleared
+    QString currentPath = remotePathLabel->text();
+    connectButton->setText("Connect to Device");
+    connectButton->setEnabled(true);
+    d->pendingRequests.clear();
+    d->resetOperations();
+    d->remoteModel->clear();
+    d->applyFirmware(Pixl::FirmwareProfile()); // Baseline until the next device answers
+    remoteLabel->setText("Device Files");
+    remoteLabel->setToolTip(QString());
+
+    if (d->autoReconnect && !d->reconnectAddress.isEmpty()) {
+        d->restorePath = currentPath;
+        d->reconnectAttempts = 0;
+        scheduleReconnect();
+        return;
+    }
+    d->reconnectAddress.clear();
+    QMessageBox::warning(this, "Disconnected", "Device disconnected");
+}
+
+void FileManagerView::restoreRemotePath(const QStringList &chain, int depth) {
+    // Lists each folder from the drive root down, then shows the deepest one
+    // that still exists
+    auto navigate = [this, chain](int deepest) {
+        if (deepest < 0) return;
+        QModelIndex index = d->remoteModel->indexFromPath(chain[deepest]);
+        if (index.isValid()) {
+            remoteView->setRootIndex(index);
+            remotePathLabel->setText(chain[deepest]);
+            d->schedulePeekScan();
+        }
+    };
+    if (depth >= chain.size()) {
+        navigate(chain.size() - 1);
+        return;
+    }
+
+    const QString path = chain[depth];
+    auto payload = Pixl::Protocol::createStringPayload(path.toStdString());
+    d->sendRequest(Pixl::Command::ReadDir, payload, path, 0,
+                   [this, chain, depth, path, navigate](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+        if (corrupt || pkt.status != 0) {
+            qDebug() << "Could not restore remote path at" << path;
+            navigate(depth - 1);
+            return;
+        }
+        d->remoteModel->onDirectoryListing(path, Pixl::Protocol::parseDirEntries(data));
+        restoreRemotePath(chain, depth + 1);
+    });
+}
+
+bool FileManagerView::startCapture(const QString &path) {
+    return d->bleManager.startCapture(path.toStdString());
+}
+
+void FileManagerView::stopCapture() {
+    d->bleManager.stopCapture();
+}
+
+bool FileManagerView::replayCapture(const QString &path, bool realTime) {
+    d->pendingRequests.clear();
+    d->resetOperations();
+    d->remoteModel->clear();
+    d->bleManager.detachExternalLink();
+    d->reconnectAddress.clear();
+    d->restorePath.clear();
+    if (!d->bleManager.startReplay(path.toStdString(), realTime)) return false;
+    onConnected("replay:" + QFileInfo(path).fileName(), realTime ? "replay (real time)" : "replay (max speed)");
+    return true;
 }
 
 void FileManagerView::onFetchRequested(const QString &path) {
@@ -460,15 +2891,26 @@ void FileManagerView::onFetchRequested(const QString &path) {
     qDebug() << "Requesting ReadDir for:" << actualPath;
     
     auto payload = Pixl::Protocol::createStringPayload(actualPath.toStdString());
-    d->bleManager.sendCommand(Pixl::Command::ReadDir, payload);
+    d->sendRequest(Pixl::Command::ReadDir, payload, actualPath);
 }
 
 void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
+    TraceSpan span("handleBleData", "gui");
     try {
         auto pkt = Pixl::Protocol::parsePacket(data);
-        
-        // Append payload to buffer
-        d->responseBuffer.insert(d->responseBuffer.end(), pkt.payload.begin(), pkt.payload.end());
+        d->metrics.recordChunk(data.size());
+
+        auto *req = d->matchRequest(pkt.cmd);
+        if (!req) {
+            qDebug() << "Unexpected response for command" << pkt.cmd;
+            return;
+        }
+
+        req->assembler.feed(pkt);
+        if (req->onChunk && pkt.status == 0 &&
+            req->assembler.state() != Pixl::ResponseAssembler::State::Corrupt) {
+            req->onChunk(pkt.payload);
+        }
         
         // If more data coming, wait
         if (pkt.hasMoreData()) {
@@ -476,12 +2918,62 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
         }
         
         // Process complete response
-        std::vector<uint8_t> fullPayload = std::move(d->responseBuffer);
-        d->responseBuffer.clear();
+        bool corrupt = req->assembler.state() == Pixl::ResponseAssembler::State::Corrupt;
+        QString corruptReason = QString::fromStdString(req->assembler.error());
+        QString requestPath = req->path;
+        auto onComplete = std::move(req->onComplete);
+        qint64 sentAtNs = req->sentAtNs;
+        Tracer::asyncEnd(FileManagerViewPrivate::traceName(req->cmd), "roundtrip", req->traceId);
+        bool retried = req->retried;
+        std::vector<uint8_t> fullPayload = req->assembler.take();
+        d->pendingRequests.pop_front();
+        d->metrics.recordResponse(static_cast<Pixl::Command>(pkt.cmd), sentAtNs, fullPayload.size(),
+                                  pkt.status, corrupt, d->pendingRequests.size());
+        struct BufferReturn {
+            Pixl::BufferPool& pool;
+            std::vector<uint8_t>& buffer;
+            ~BufferReturn() { pool.release(std::move(buffer)); }
+        } bufferReturn{d->bufferPool, fullPayload};
+
+        // Listings are safe to repeat, so give a damaged one a second chance.
+        // Without a link the retry couldn't be sent, so it fails below like
+        // any corrupt listing and whatever waits on it still hears back.
+        if (corrupt && !retried && pkt.cmd == static_cast<uint8_t>(Pixl::Command::ReadDir) &&
+            d->bleManager.isConnected()) {
+            qDebug() << "Retrying listing of" << requestPath << ":" << corruptReason;
+            d->metrics.recordRetry(Pixl::Command::ReadDir);
+            auto payload = Pixl::Protocol::createStringPayload(requestPath.toStdString());
+            d->sendRequest(Pixl::Command::ReadDir, payload, requestPath, 0, std::move(onComplete));
+            if (!d->pendingRequests.empty()) d->pendingRequests.back().retried = true;
+            return;
+        }
+
+        if (onComplete) {
+            onComplete(pkt, fullPayload, corrupt);
+            return;
+        }
+
+        if (corrupt && pkt.cmd != static_cast<uint8_t>(Pixl::Command::ReadFile)) {
+            qDebug() << "Discarding corrupt response for command" << pkt.cmd << ":" << corruptReason;
+            if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::Rename) ||
+                pkt.cmd == static_cast<uint8_t>(Pixl::Command::Remove) ||
+                pkt.cmd == static_cast<uint8_t>(Pixl::Command::CreateFolder)) {
+                d->finishPipelinedOperation();
+            } else if (pkt.cmd != static_cast<uint8_t>(Pixl::Command::ReadDir) &&
+                pkt.cmd != static_cast<uint8_t>(Pixl::Command::GetDriveList) &&
+                pkt.cmd != static_cast<uint8_t>(Pixl::Command::GetVersion)) {
+                d->processNextOperation();
+            }
+            return;
+        }
         
         if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::GetVersion)) {
-            qDebug() << "Got Version, requesting Drive List...";
-            d->bleManager.sendCommand(Pixl::Command::GetDriveList);
+            d->applyFirmware(Pixl::FirmwareProfile::parse(fullPayload));
+            QString version = QString::fromStdString(d->firmware.version);
+            remoteLabel->setText(version.isEmpty() ? QString("Device Files") : QString("Device Files (%1)").arg(version));
+            remoteLabel->setToolTip(QString::fromStdString(d->firmware.describe()));
+            qDebug() << "Requesting Drive List...";
+            d->sendRequest(Pixl::Command::GetDriveList);
         }
         else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::GetDriveList)) {
             qDebug() << "Got Drive List";
@@ -489,6 +2981,7 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
             if (fullPayload.empty()) return;
             uint8_t count = fullPayload[offset++]; 
             std::vector<Pixl::FileEntry> entries;
+            std::vector<std::pair<QString, uint32_t>> driveUsage;
             for (uint8_t i = 0; i < count; ++i) {
                 if (offset + 2 > fullPayload.size()) break;
                 
@@ -501,12 +2994,30 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
                 entry.meta = longName; 
                 entry.size = Pixl::Protocol::parseUInt32(fullPayload, offset);
                 uint32_t used = Pixl::Protocol::parseUInt32(fullPayload, offset);
+                driveUsage.emplace_back(QString::fromStdString(entry.name), used);
 
                 entry.type = 1;
                 entries.push_back(entry);
             }
             d->remoteModel->onDirectoryListing("/", entries);
+            for (const auto& [drive, used] : driveUsage) d->remoteModel->setDriveUsage(drive, used);
             
+            // After an auto-reconnect, go back to the folder that was open
+            if (!d->restorePath.isEmpty()) {
+                QString path = FileManagerViewPrivate::remoteNormalize(d->restorePath);
+                d->restorePath.clear();
+                QStringList chain;
+                for (QString p = path; p != "/" && !chain.contains(p); p = FileManagerViewPrivate::remoteParent(p)) {
+                    chain.prepend(p); // remoteParent of a drive root is the root itself
+                }
+                bool driveExists = !chain.isEmpty() && std::any_of(entries.begin(), entries.end(),
+                    [&chain](const Pixl::FileEntry& e) { return QString::fromStdString(e.name) == chain.first(); });
+                if (driveExists) {
+                    restoreRemotePath(chain, 0);
+                    return;
+                }
+            }
+
             if (!entries.empty()) {
                 QString firstDrivePath = QString::fromStdString(entries[0].name);
                 onFetchRequested(firstDrivePath);
@@ -516,6 +3027,7 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
                 if (driveIndex.isValid()) {
                     remoteView->setRootIndex(driveIndex);
                     remotePathLabel->setText(firstDrivePath);
+                    d->schedulePeekScan();
                 }
             }
         }
@@ -525,24 +3037,8 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
                 return;
             }
             
-            size_t offset = 0;
-            std::vector<Pixl::FileEntry> entries;
-            while(offset < fullPayload.size()) {
-                Pixl::FileEntry entry;
-                entry.name = Pixl::Protocol::parseString(fullPayload, offset);
-                entry.size = Pixl::Protocol::parseUInt32(fullPayload, offset);
-                if (offset < fullPayload.size()) entry.type = fullPayload[offset++];
-                if (offset < fullPayload.size()) {
-                    uint8_t metaLen = fullPayload[offset++];
-                    offset += metaLen;
-                }
-
-                if (!entry.name.empty())
-                   entries.push_back(entry);
-                else break;
-            }
-            
-            d->remoteModel->onDirectoryListing(d->lastRequestedPath, entries);
+            auto entries = Pixl::Protocol::parseDirEntries(fullPayload);
+            d->remoteModel->onDirectoryListing(requestPath, entries);
         }
         else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::OpenFile)) {
             if (pkt.status != 0) {
@@ -554,28 +3050,12 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
             d->currentFileId = fullPayload[0];
             
             // Check op type to decide next step
-            if (!d->opQueue.empty()) {
-                // Actually, currentFile is already set. We just need to know if we are uploading or downloading.
-                // We can check if currentFile is open for read or write.
-                if (d->currentFile->openMode() == QIODevice::ReadOnly) {
-                    d->sendNextChunk();
-                } else {
-                    std::vector<uint8_t> payload;
-                    payload.push_back(d->currentFileId);
-                    d->bleManager.sendCommand(Pixl::Command::ReadFile, payload);
-                }
-            } else {
-                // This shouldn't happen if queue-based?
-                // Actually, we popped the op already. Let's look at what we are doing.
-                // Wait, I should probably keep the 'currentOpType' or similar. 
-                // Alternatively, I can check the file's open mode.
-                if (d->currentFile && d->currentFile->openMode() == QIODevice::ReadOnly) {
-                    d->sendNextChunk();
-                } else if (d->currentFile && d->currentFile->openMode() == QIODevice::WriteOnly) {
-                    std::vector<uint8_t> payload;
-                    payload.push_back(d->currentFileId);
-                    d->bleManager.sendCommand(Pixl::Command::ReadFile, payload);
-                }
+            if (d->currentOpType == FileManagerViewPrivate::OpType::UploadFile) {
+                d->sendNextChunk();
+            } else if (d->currentOpType == FileManagerViewPrivate::OpType::DownloadFile && d->currentFile) {
+                std::vector<uint8_t> payload;
+                payload.push_back(d->currentFileId);
+                d->sendRequest(Pixl::Command::ReadFile, payload, QString(), d->currentDownloadSize);
             }
         }
         else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::ReadFile)) {
@@ -584,13 +3064,23 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
                 d->processNextOperation();
                 return;
             }
+            if (!corrupt && d->currentDownloadSize != 0 && fullPayload.size() != d->currentDownloadSize) {
+                corrupt = true;
+                corruptReason = QString("Got %1 bytes, expected %2").arg(fullPayload.size()).arg(d->currentDownloadSize);
+            }
             if (d->currentFile) {
-                d->currentFile->write(reinterpret_cast<const char*>(fullPayload.data()), fullPayload.size());
-                d->currentFile->close();
+                if (corrupt) {
+                    // Don't leave a damaged copy behind
+                    qDebug() << "Download of" << d->currentFile->fileName() << "corrupt:" << corruptReason;
+                    d->currentFile->remove();
+                } else {
+                    d->currentFile->write(reinterpret_cast<const char*>(fullPayload.data()), fullPayload.size());
+                    d->currentFile->close();
+                }
             }
             std::vector<uint8_t> payload;
             payload.push_back(d->currentFileId);
-            d->bleManager.sendCommand(Pixl::Command::CloseFile, payload);
+            d->sendRequest(Pixl::Command::CloseFile, payload);
         }
         else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::WriteFile)) {
             if (pkt.status != 0) {
@@ -598,41 +3088,65 @@ void FileManagerView::handleBleData(const std::vector<uint8_t>& data) {
                 d->processNextOperation();
                 return;
             }
-            d->currentOffset += d->CHUNK_SIZE;
+            d->currentOffset += d->currentChunk;
             d->sendNextChunk();
         }
         else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::CloseFile)) {
+            if (pkt.status == 0 && d->currentOpType == FileManagerViewPrivate::OpType::UploadFile &&
+                d->uploadSource.isOpen() && !d->uploadSource.hasError()) {
+                // What actually went out, which a short source leaves below its size
+                auto size = static_cast<uint32_t>(d->currentOffset);
+                if (d->currentOffset != d->uploadSource.size()) {
+                    qDebug() << "Upload of" << d->currentUpload.target << "wrote" << d->currentOffset << "of"
+                             << d->uploadSource.size() << "bytes";
+                }
+                d->remoteModel->fileWritten(d->currentUpload.target, size);
+                if (d->verifyUploads) d->recordUpload(d->currentUpload, size);
+            }
             if (d->currentFile) d->currentFile->close();
+            d->uploadSource.close();
             d->processNextOperation();
         }
         else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::CreateFolder)) {
             if (pkt.status != 0 && pkt.status != 1) { // 1 might be "already exists"? 
                 qDebug() << "CreateFolder failed with status:" << pkt.status;
             }
-            d->processNextOperation();
+            d->finishPipelinedOperation();
         }
         else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::Remove)) {
             if (pkt.status != 0) {
-                qDebug() << "Remove failed with status:" << pkt.status;
+                qDebug() << "Remove of" << requestPath << "failed with status:" << pkt.status;
+            } else {
+                d->remoteModel->removePath(requestPath);
+            }
+            d->finishPipelinedOperation();
+        }
+        else if (pkt.cmd == static_cast<uint8_t>(Pixl::Command::Rename)) {
+            if (pkt.status != 0) {
+                qDebug() << "Rename to" << requestPath << "failed with status:" << pkt.status;
+            } else {
+                // The destination folder's cached listing no longer matches the device
+                d->remoteModel->markStale(FileManagerViewPrivate::remoteParent(requestPath));
             }
-            d->processNextOperation();
+            d->finishPipelinedOperation();
         }
     } catch (const std::exception& e) {
         qDebug() << "Packet parse error:" << e.what();
-        d->responseBuffer.clear();
     }
 }
 
 bool FileManagerView::eventFilter(QObject *obj, QEvent *event) {
-    if (event->type() == QEvent::DragEnter) {
+    if (event->type() == QEvent::Resize && obj == remoteView->viewport()) {
+        d->schedulePeekScan();
+    } else if (event->type() == QEvent::DragEnter) {
         auto *de = static_cast<QDragEnterEvent*>(event);
-        if (de->mimeData()->hasUrls()) {
+        if (de->mimeData()->hasUrls() || de->mimeData()->hasFormat(RemoteFileSystemModel::PATHS_MIME_TYPE)) {
             de->acceptProposedAction();
             return true;
         }
     } else if (event->type() == QEvent::DragMove) {
         auto *de = static_cast<QDragMoveEvent*>(event);
-        if (de->mimeData()->hasUrls()) {
+        if (de->mimeData()->hasUrls() || de->mimeData()->hasFormat(RemoteFileSystemModel::PATHS_MIME_TYPE)) {
             de->acceptProposedAction();
             return true;
         }
@@ -647,14 +3161,30 @@ bool FileManagerView::eventFilter(QObject *obj, QEvent *event) {
                 targetDir = d->remoteModel->filePath(index);
             }
 
+            if (de->mimeData()->hasFormat(RemoteFileSystemModel::PATHS_MIME_TYPE)) {
+                // Dragged within the remote pane: move on the device, or copy with Ctrl held
+                QStringList paths = QString::fromUtf8(de->mimeData()->data(RemoteFileSystemModel::PATHS_MIME_TYPE))
+                                        .split('\n', Qt::SkipEmptyParts);
+                if (de->modifiers() & Qt::ControlModifier) {
+                    d->startLocalCopy(paths, targetDir, this);
+                    de->acceptProposedAction();
+                    return true;
+                }
+                auto ops = d->buildMoves(paths, targetDir);
+                if (!ops.empty()) {
+                    d->remoteModel->markStale(targetDir);
+                    d->startOperations(ops, "Moving...", this);
+                }
+                de->acceptProposedAction();
+                return true;
+            }
+
             if (de->mimeData()->hasUrls()) {
                 std::vector<FileManagerViewPrivate::Operation> ops;
                 for (const QUrl &url : de->mimeData()->urls()) {
                     QString localPath = url.toLocalFile();
                     if (!localPath.isEmpty()) {
-                        QFileInfo fi(localPath);
-                        QString remotePath = targetDir + (targetDir.endsWith("/") ? "" : "/") + fi.fileName();
-                        d->recursiveScan(localPath, remotePath, ops);
+                        d->scanUploadSource(localPath, targetDir, ops);
                     }
                 }
                 if (!ops.empty()) {
@@ -673,15 +3203,8 @@ bool FileManagerView::eventFilter(QObject *obj, QEvent *event) {
 
             // Check if source is remoteView
             QModelIndexList selected = remoteView->selectionModel()->selectedRows();
-            if (!selected.isEmpty()) {
-                std::vector<FileManagerViewPrivate::Operation> ops;
-                for (const auto& remoteIdx : selected) {
-                    QString remotePath = d->remoteModel->filePath(remoteIdx);
-                    QFileInfo fi(remotePath);
-                    QString localPath = QDir(targetDir).absoluteFilePath(fi.fileName());
-                    ops.push_back({FileManagerViewPrivate::OpType::DownloadFile, remotePath, localPath});
-                }
-                d->startOperations(ops, "Downloading...", this);
+            if (de->mimeData()->hasFormat(RemoteFileSystemModel::PATHS_MIME_TYPE) && !selected.isEmpty()) {
+                d->startDownload(selected, targetDir, this);
                 de->acceptProposedAction();
                 return true;
             }
@@ -8,6 +8,11 @@
 #include <QLabel>
 #include <QPushButton>
 
+class TransferMetrics;
+class QLineEdit;
+class QListWidget;
+class BleManager;
+
 class FileManagerView : public QWidget {
     Q_OBJECT
 
@@ -15,12 +20,68 @@ public:
     explicit FileManagerView(QWidget *parent = nullptr);
     ~FileManagerView() override;
     void setBleManager(void* manager); // Pointer to key logic
+    TransferMetrics* metrics() const;
+
+    // BLE traffic capture, and offline replay of a capture through the same
+    // protocol and transfer code
+    bool startCapture(const QString &path);
+    void stopCapture();
+    bool replayCapture(const QString &path, bool realTime);
+
+    // Reconnect on its own after an unexpected disconnect and reopen the
+    // remote folder that was showing. Persisted in the settings.
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect() const;
+
+    // Read every upload back and compare it with a hash of its source.
+    // Persisted in the settings.
+    void setVerifyUploads(bool enabled);
+    bool verifyUploads() const;
+
+    // Asks for a snapshot folder and backs the whole device up into it,
+    // fetching only what changed since the snapshot before
+    void backupDevice();
+    // Uploads a snapshot's files again, from whichever tars of its chain hold them
+    void restoreBackup();
+
+    // Golden-image provisioning. createLoadPlan walks and hashes a local
+    // tree once and saves the result; provisionDevice formats a drive and
+    // loads a saved plan onto it, timing each phase.
+    void createLoadPlan();
+    void provisionDevice();
+
+    // Keeps a device folder in step with a local one as it is edited.
+    // startMirror asks for both folders and returns whether it started.
+    bool startMirror();
+    void stopMirror();
+    bool isMirroring() const;
+
+signals:
+    // The mirror gave up on its own, e.g. the target could not be opened
+    void mirrorStopped();
+    // Every folder on the device has been listed for search
+    void crawlFinished();
 
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
 
 private:
     void setupUi();
+    void onConnected(const QString &address, const QString &adapter);
+    void onDisconnected();
+    void connectToDevice(const QString &address, const QString &name);
+    void onConnectFinished(bool ok, const QString &address, const QString &adapter);
+    void scheduleReconnect();
+    void restoreRemotePath(const QStringList &chain, int depth);
+    void setupLink();
+    void setLocalRoot(const QString &path);
+    void runSearch();
+    // Opens the folder of a search result and selects it
+    void showRemotePath(const QString &path, bool folder);
+    // Runs the device dialog scanning with manager; empty if cancelled
+    QString pickDevice(BleManager &manager, const QString &title, QString *name);
+    // Streams the selected remote items to a second device
+    void copyToPeer(const QModelIndexList &selected);
     
     QSplitter *splitter;
     
@@ -40,6 +101,9 @@ private:
     QPushButton *remoteUpButton;
     QLabel *remotePathLabel;
     QTreeView *remoteView;
+    QLineEdit *remoteSearch;
+    QPushButton *crawlButton;
+    QListWidget *searchResults;
     QPushButton *connectButton; // Temporary placeholder until main window handles it?
 
 private slots:
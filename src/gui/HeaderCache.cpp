@@ -0,0 +1,78 @@
+#include "HeaderCache.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+
+HeaderCache::HeaderCache(const QString &file) : fileName(file) {
+    QFile in(fileName);
+    if (!in.open(QIODevice::ReadOnly)) return;
+    QJsonDocument document = QJsonDocument::fromJson(in.readAll());
+    // [key, summary] pairs, most recently used first
+    for (const QJsonValue &value : document.array()) {
+        if (entries.size() >= MAX_ENTRIES) break;
+        QJsonArray pair = value.toArray();
+        QString entryKey = pair.at(0).toString();
+        if (entryKey.isEmpty() || entries.contains(entryKey)) continue;
+        recency.push_back(entryKey);
+        entries.insert(entryKey, {pair.at(1).toString(), std::prev(recency.end())});
+    }
+    qDebug() << "Loaded" << entries.size() << "cached file header(s)";
+}
+
+HeaderCache::~HeaderCache() {
+    save();
+}
+
+QString HeaderCache::key(const QString &path, uint32_t size, const QByteArray &meta) {
+    return path + '\n' + QString::number(size) + '\n' + QString::fromLatin1(meta.toHex());
+}
+
+QString HeaderCache::summary(const QString &path, uint32_t size, const QByteArray &meta) const {
+    auto it = entries.constFind(key(path, size, meta));
+    return it == entries.constEnd() ? QString() : (it->summary.isNull() ? QString("") : it->summary);
+}
+
+bool HeaderCache::touch(const QString &path, uint32_t size, const QByteArray &meta) {
+    auto it = entries.find(key(path, size, meta));
+    if (it == entries.end()) return false;
+    recency.splice(recency.begin(), recency, it->use);
+    return true;
+}
+
+void HeaderCache::store(const QString &path, uint32_t size, const QByteArray &meta, const QString &summary) {
+    insert(key(path, size, meta), summary.isNull() ? QString("") : summary);
+    if (++unsaved >= SAVE_EVERY) save();
+}
+
+void HeaderCache::insert(const QString &key, const QString &summary) {
+    auto it = entries.find(key);
+    if (it != entries.end()) {
+        it->summary = summary;
+        recency.splice(recency.begin(), recency, it->use);
+        return;
+    }
+    if (entries.size() >= MAX_ENTRIES) {
+        entries.remove(recency.back());
+        recency.pop_back();
+    }
+    recency.push_front(key);
+    entries.insert(key, {summary, recency.begin()});
+}
+
+void HeaderCache::save() {
+    if (unsaved == 0) return;
+    QJsonArray array;
+    for (const QString &entryKey : recency) array.append(QJsonArray{entryKey, entries.value(entryKey).summary});
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile out(fileName);
+    if (!out.open(QIODevice::WriteOnly) || out.write(QJsonDocument(array).toJson(QJsonDocument::Compact)) < 0 ||
+        !out.commit()) {
+        qDebug() << "Could not save the header cache to" << fileName;
+        return;
+    }
+    unsaved = 0;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <cstdint>
+#include <list>
+
+// Decoded file headers from peeks, kept across sessions. An entry is keyed
+// by path, size and the device's metadata blob, so a file that changed in
+// any visible way is peeked again rather than shown stale. Past
+// MAX_ENTRIES the least recently used entry goes; the file keeps the order.
+class HeaderCache {
+public:
+    static constexpr int MAX_ENTRIES = 50000;
+    // Unsaved entries are written out once there are this many
+    static constexpr int SAVE_EVERY = 50;
+
+    explicit HeaderCache(const QString &file);
+    ~HeaderCache();
+
+    // Null if the file was never peeked; empty if it was but had nothing to show
+    QString summary(const QString &path, uint32_t size, const QByteArray &meta) const;
+    // Marks the entry as just used (shown on screen). False if there isn't one.
+    bool touch(const QString &path, uint32_t size, const QByteArray &meta);
+    void store(const QString &path, uint32_t size, const QByteArray &meta, const QString &summary);
+    void save();
+
+private:
+    struct Entry {
+        QString summary;
+        std::list<QString>::iterator use;
+    };
+
+    static QString key(const QString &path, uint32_t size, const QByteArray &meta);
+    void insert(const QString &key, const QString &summary);
+
+    QString fileName;
+    QHash<QString, Entry> entries;
+    std::list<QString> recency; // Keys, most recently used first
+    int unsaved = 0;
+};
@@ -1,5 +1,10 @@
 #include "RemoteFileSystemModel.h"
 #include <QIcon>
+#include <QMimeData>
+#include <QLocale>
+#include "../common/Tracer.h"
+#include "../protocol/AmiiboHeader.h"
+#include "HeaderCache.h"
 #include <algorithm>
 
 RemoteFileSystemModel::RemoteFileSystemModel(QObject *parent)
@@ -20,6 +25,13 @@ void RemoteFileSystemModel::clear()
     rootNode->children.clear();
     rootNode->fetched = false;
     rootNode->fetching = false;
+    rootNode->totalBytes = 0;
+    rootNode->totalFiles = 0;
+    rootNode->unlisted = 0;
+    rootNode->listed = false;
+    memoryBytes = 0;
+    nameIndex.clear();
+    peekAsked.clear();
     endResetModel();
 }
 
@@ -37,7 +49,29 @@ QVariant RemoteFileSystemModel::data(const QModelIndex &index, int role) const
 
     if (role == Qt::DisplayRole) {
         if (index.column() == 0) return node->name;
-        if (index.column() == 1) return QString::number(node->size);
+        if (index.column() == 1) {
+            if (!node->isDir) return QString::number(node->size);
+            QLocale locale;
+            if (node->parent == rootNode && node->size > 0) {
+                // Drives: the device's own figures, no listing needed
+                return QString("%1 of %2 used (%3%)")
+                    .arg(locale.formattedDataSize(node->used), locale.formattedDataSize(node->size))
+                    .arg(node->used * 100 / node->size);
+            }
+            if (!node->listed) return QVariant();
+            return QString("%1%2, %3 files")
+                .arg(node->unlisted > 0 ? QString(">= ") : QString(), locale.formattedDataSize(node->totalBytes))
+                .arg(node->totalFiles);
+        }
+    }
+    if (role == Qt::DisplayRole && index.column() == 2 && !node->isDir && headerCache) {
+        return headerCache->summary(node->path, node->size, node->meta);
+    }
+    if (role == Qt::ToolTipRole && index.column() == 1 && node->isDir && node->listed) {
+        QString tip = QString("%1 bytes in %2 files listed so far")
+                          .arg(node->totalBytes).arg(node->totalFiles);
+        if (node->unlisted > 0) tip += QString("\n%1 folder(s) inside not listed yet").arg(node->unlisted);
+        return tip;
     }
     if (role == Qt::DecorationRole && index.column() == 0) {
         return node->isDir ? QIcon::fromTheme("folder") : QIcon::fromTheme("text-x-generic");
@@ -51,7 +85,9 @@ Qt::ItemFlags RemoteFileSystemModel::flags(const QModelIndex &index) const
     if (!index.isValid())
         return Qt::NoItemFlags;
 
-    return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    Qt::ItemFlags f = Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled;
+    if (nodeFromIndex(index)->isDir) f |= Qt::ItemIsDropEnabled;
+    return f;
 }
 
 QVariant RemoteFileSystemModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -59,6 +95,7 @@ QVariant RemoteFileSystemModel::headerData(int section, Qt::Orientation orientat
     if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
         if (section == 0) return "Name";
         if (section == 1) return "Size";
+        if (section == 2) return "Contents";
     }
     return QVariant();
 }
@@ -102,7 +139,7 @@ int RemoteFileSystemModel::rowCount(const QModelIndex &parent) const
 
 int RemoteFileSystemModel::columnCount(const QModelIndex &parent) const
 {
-    return 2;
+    return 3;
 }
 
 bool RemoteFileSystemModel::hasChildren(const QModelIndex &parent) const
@@ -126,6 +163,79 @@ void RemoteFileSystemModel::fetchMore(const QModelIndex &parent)
     emit fetchRequested(node->path);
 }
 
+QStringList RemoteFileSystemModel::mimeTypes() const
+{
+    return { PATHS_MIME_TYPE };
+}
+
+QMimeData *RemoteFileSystemModel::mimeData(const QModelIndexList &indexes) const
+{
+    QStringList paths;
+    for (const auto &index : indexes) {
+        if (index.isValid() && index.column() == 0) paths << nodeFromIndex(index)->path;
+    }
+    auto *mime = new QMimeData;
+    mime->setData(PATHS_MIME_TYPE, paths.join('\n').toUtf8());
+    return mime;
+}
+
+void RemoteFileSystemModel::markStale(const QString &path)
+{
+    RemoteFileNode *node = nodeFromPath(path);
+    if (node) node->fetched = false;
+}
+
+QStringList RemoteFileSystemModel::unfetchedSubdirs(const QModelIndex &parent) const
+{
+    QStringList paths;
+    for (auto child : nodeFromIndex(parent)->children) {
+        if (child->isDir && !child->fetched && !child->fetching) paths << child->path;
+    }
+    return paths;
+}
+
+QStringList RemoteFileSystemModel::unfetchedFolders() const
+{
+    QStringList paths;
+    QList<RemoteFileNode*> queue{rootNode};
+    while (!queue.isEmpty()) {
+        RemoteFileNode *node = queue.takeFirst();
+        for (auto child : node->children) {
+            if (!child->isDir) continue;
+            if (child->fetched) queue.append(child);
+            else if (!child->fetching) paths << child->path;
+        }
+    }
+    return paths;
+}
+
+bool RemoteFileSystemModel::beginFetch(const QString &path)
+{
+    RemoteFileNode *node = nodeFromPath(path);
+    if (!node || node->fetched || node->fetching) return false;
+    node->fetching = true;
+    return true;
+}
+
+void RemoteFileSystemModel::abortFetch(const QString &path)
+{
+    RemoteFileNode *node = nodeFromPath(path);
+    if (node) node->fetching = false;
+}
+
+size_t RemoteFileSystemModel::nodeBytes(const RemoteFileNode *node)
+{
+    // QString storage is UTF-16, plus the slot in the parent's children
+    return sizeof(RemoteFileNode) + (node->name.size() + node->path.size()) * sizeof(QChar) + node->meta.size() + sizeof(void*);
+}
+
+size_t RemoteFileSystemModel::subtreeBytes(const RemoteFileNode *node)
+{
+    size_t total = nodeBytes(node);
+    for (auto child : node->children) total += subtreeBytes(child);
+    return total;
+}
+
 void RemoteFileSystemModel::refresh(const QModelIndex &parent)
 {
     RemoteFileNode *node = nodeFromIndex(parent);
@@ -143,7 +253,142 @@ bool RemoteFileSystemModel::isDir(const QModelIndex &index) const
     return nodeFromIndex(index)->isDir;
 }
 
+uint32_t RemoteFileSystemModel::fileSize(const QModelIndex &index) const
+{
+    return nodeFromIndex(index)->size;
+}
+
+QModelIndex RemoteFileSystemModel::indexOf(RemoteFileNode *node, int column) const
+{
+    if (!node || node == rootNode) return QModelIndex();
+    return createIndex(node->parent->children.indexOf(node), column, node);
+}
+
+void RemoteFileSystemModel::addTotals(RemoteFileNode *node, int64_t bytes, int64_t files, int64_t unlisted)
+{
+    if (bytes == 0 && files == 0 && unlisted == 0) return;
+    for (RemoteFileNode *n = node; n; n = n->parent) {
+        n->totalBytes = static_cast<uint64_t>(static_cast<int64_t>(n->totalBytes) + bytes);
+        n->totalFiles = static_cast<uint32_t>(static_cast<int64_t>(n->totalFiles) + files);
+        n->unlisted = static_cast<uint32_t>(static_cast<int64_t>(n->unlisted) + unlisted);
+        if (n != rootNode) {
+            QModelIndex index = indexOf(n, 1);
+            emit dataChanged(index, index);
+        }
+    }
+}
+
+void RemoteFileSystemModel::fileWritten(const QString &path, uint32_t size)
+{
+    QString normalized = path;
+    if (normalized.endsWith("/") && normalized.length() > 3) normalized.chop(1);
+    int slash = normalized.lastIndexOf('/');
+    if (slash < 0) return;
+    RemoteFileNode *parent = nodeFromPath(normalized.left(slash + 1));
+    if (!parent || !parent->listed) return; // Its listing will show the file
+    QString name = normalized.mid(slash + 1);
+
+    for (auto child : parent->children) {
+        if (child->name != name) continue;
+        if (child->isDir) return;
+        int64_t delta = static_cast<int64_t>(size) - child->size;
+        child->size = size;
+        child->totalBytes = size;
+        adjustDriveUsage(parent, delta);
+        addTotals(parent, delta, 0, 0);
+        QModelIndex index = indexOf(child, 1);
+        emit dataChanged(index, index);
+        return;
+    }
+
+    // Same order as a listing: folders first, then by name
+    int row = 0;
+    while (row < parent->children.size() &&
+           (parent->children[row]->isDir || parent->children[row]->name.toStdString() < name.toStdString())) {
+        row++;
+    }
+    auto *child = new RemoteFileNode{name, normalized, size, false};
+    child->parent = parent;
+    child->totalBytes = size;
+    child->totalFiles = 1;
+    child->listed = true;
+    beginInsertRows(indexOf(parent), row, row);
+    parent->children.insert(row, child);
+    memoryBytes += nodeBytes(child);
+    endInsertRows();
+    adjustDriveUsage(parent, size);
+    addTotals(parent, size, 1, 0);
+    nameIndex.insert(parent->path.toStdString(), {normalized.toStdString(), name.toStdString(), size, false});
+}
+
+void RemoteFileSystemModel::removePath(const QString &path)
+{
+    RemoteFileNode *node = nodeFromPath(path);
+    if (!node || node == rootNode || node->parent == rootNode) return;
+    RemoteFileNode *parent = node->parent;
+    adjustDriveUsage(parent, -static_cast<int64_t>(node->totalBytes));
+    addTotals(parent, -static_cast<int64_t>(node->totalBytes), -static_cast<int64_t>(node->totalFiles),
+              -static_cast<int64_t>(node->unlisted));
+    int row = parent->children.indexOf(node);
+    beginRemoveRows(indexOf(parent), row, row);
+    memoryBytes -= std::min(memoryBytes, subtreeBytes(node));
+    parent->children.removeAt(row);
+    nameIndex.remove(node->path.toStdString());
+    delete node;
+    endRemoveRows();
+}
+
+// Our own writes and deletes move the device's figure too, until the
+// next drive list brings the real one
+void RemoteFileSystemModel::adjustDriveUsage(RemoteFileNode *node, int64_t bytes)
+{
+    while (node && node->parent != rootNode) node = node->parent;
+    if (!node || node == rootNode) return;
+    node->used = static_cast<uint64_t>(std::max<int64_t>(0, static_cast<int64_t>(node->used) + bytes));
+}
+
+void RemoteFileSystemModel::requestPeek(const QModelIndex &index)
+{
+    if (!index.isValid() || !headerCache) return;
+    RemoteFileNode *node = nodeFromIndex(index);
+    // A cached header on screen counts as a use, so it stays in the cache
+    if (node->isDir || headerCache->touch(node->path, node->size, node->meta) || peekAsked.contains(node->path) ||
+        !Pixl::AmiiboHeader::isCandidate(node->name.toStdString(), node->size)) {
+        return;
+    }
+    peekAsked.insert(node->path);
+    emit peekRequested(node->path);
+}
+
+void RemoteFileSystemModel::headerChanged(const QString &path)
+{
+    QModelIndex index = indexOf(nodeFromPath(path), 2);
+    if (index.isValid()) emit dataChanged(index, index);
+}
+
+QByteArray RemoteFileSystemModel::fileMeta(const QModelIndex &index) const
+{
+    return nodeFromIndex(index)->meta;
+}
+
+void RemoteFileSystemModel::setDriveUsage(const QString &drive, uint64_t used)
+{
+    RemoteFileNode *node = nodeFromPath(drive);
+    if (!node || node->parent != rootNode) return;
+    node->used = used;
+    QModelIndex index = indexOf(node, 1);
+    emit dataChanged(index, index);
+}
+
 QModelIndex RemoteFileSystemModel::indexFromPath(const QString &path) const
+{
+    RemoteFileNode* node = nodeFromPath(path);
+    if (!node || node == rootNode) return QModelIndex();
+    int row = node->parent->children.indexOf(node);
+    return createIndex(row, 0, node);
+}
+
+RemoteFileNode *RemoteFileSystemModel::nodeFromPath(const QString &path) const
 {
     QString normalizedSearch = path;
     if (normalizedSearch.endsWith("/") && normalizedSearch.length() > 3) normalizedSearch.chop(1);
@@ -157,19 +402,18 @@ QModelIndex RemoteFileSystemModel::indexFromPath(const QString &path) const
         if (currNormalized.endsWith("/") && currNormalized.length() > 3) currNormalized.chop(1);
 
         if (currNormalized == normalizedSearch) {
-            if (curr == rootNode) return QModelIndex();
-            int row = curr->parent->children.indexOf(curr);
-            return createIndex(row, 0, curr);
+            return curr;
         }
         for(auto child : curr->children) {
             queue.append(child);
         }
     }
-    return QModelIndex();
+    return nullptr;
 }
 
 void RemoteFileSystemModel::onDirectoryListing(const QString &path, const std::vector<Pixl::FileEntry> &entries)
 {
+    TraceSpan span("onDirectoryListing", "model");
     auto sortedEntries = entries;
     std::sort(sortedEntries.begin(), sortedEntries.end(), [](const Pixl::FileEntry& a, const Pixl::FileEntry& b) {
         if (a.type != b.type) return a.type > b.type; // Dirs first
@@ -210,8 +454,15 @@ void RemoteFileSystemModel::onDirectoryListing(const QString &path, const std::v
     // Update children
     // BeginInsert...
     // For simplicity, remove all and add new (if refreshing)
+    // What the old listing contributed comes off the totals up the chain;
+    // the new one goes on below, so nothing above is summed again
+    int64_t oldBytes = static_cast<int64_t>(target->totalBytes);
+    int64_t oldFiles = target->totalFiles;
+    int64_t oldUnlisted = target->unlisted;
+
     if (!target->children.isEmpty()) {
         beginRemoveRows(parentIndex, 0, target->children.count() - 1);
+        for (auto child : target->children) memoryBytes -= std::min(memoryBytes, subtreeBytes(child));
         qDeleteAll(target->children);
         target->children.clear();
         endRemoveRows();
@@ -229,12 +480,39 @@ void RemoteFileSystemModel::onDirectoryListing(const QString &path, const std::v
             }
             child->size = entry.size;
             child->isDir = (entry.type == 1);
+            child->meta = QByteArray::fromStdString(entry.meta);
+            if (child->isDir) {
+                child->unlisted = 1;
+            } else {
+                child->totalBytes = entry.size;
+                child->totalFiles = 1;
+                child->listed = true;
+            }
             child->parent = target;
             target->children.append(child);
+            memoryBytes += nodeBytes(child);
         }
         endInsertRows();
     }
-    
+
+    std::vector<RemoteSearchIndex::Item> items;
+    items.reserve(target->children.size());
+    for (auto child : target->children) {
+        items.push_back({child->path.toStdString(), child->name.toStdString(), child->size, child->isDir});
+    }
+    nameIndex.replaceFolder(target->path.toStdString(), items);
+
+    int64_t newBytes = 0;
+    int64_t newFiles = 0;
+    int64_t newUnlisted = 0;
+    for (auto child : target->children) {
+        newBytes += static_cast<int64_t>(child->totalBytes);
+        newFiles += child->totalFiles;
+        newUnlisted += child->unlisted;
+    }
+    target->listed = true;
+    addTotals(target, newBytes - oldBytes, newFiles - oldFiles, newUnlisted - oldUnlisted);
+
     target->fetched = true;
 }
 
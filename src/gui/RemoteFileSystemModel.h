@@ -4,22 +4,39 @@
 #include <QVector>
 #include <QString>
 #include <QVariant>
+#include <QStringList>
+#include <QByteArray>
+#include <QSet>
 #include <memory>
 #include <map>
 #include "../protocol/PixlProtocol.h"
+#include "RemoteSearchIndex.h"
 
 class BleManager;
+class QMimeData;
+class HeaderCache;
 
 struct RemoteFileNode {
     QString name;
     QString path;
     uint32_t size;
     bool isDir;
+    QByteArray meta; // The device's metadata blob, as listed
     RemoteFileNode *parent = nullptr;
     QVector<RemoteFileNode*> children;
     bool fetched = false;
     bool fetching = false;
 
+    // Totals over the listed part of the subtree, updated along the parent
+    // chain as listings, uploads and deletes come in. unlisted counts the
+    // folders (this one included) whose contents aren't known yet; while it
+    // is above zero the totals are a lower bound.
+    uint64_t totalBytes = 0;
+    uint32_t totalFiles = 0;
+    uint32_t unlisted = 0;
+    bool listed = false;
+    uint64_t used = 0; // Drives only: bytes in use as the device reports them, size is the capacity
+
     ~RemoteFileNode() {
         qDeleteAll(children);
     }
@@ -29,6 +46,9 @@ class RemoteFileSystemModel : public QAbstractItemModel {
     Q_OBJECT
 
 public:
+    // Drag payload for remote items: newline-separated device paths
+    static constexpr const char *PATHS_MIME_TYPE = "application/x-joymanager-remote-paths";
+
     explicit RemoteFileSystemModel(QObject *parent = nullptr);
     ~RemoteFileSystemModel();
 
@@ -46,16 +66,47 @@ public:
     bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
     bool canFetchMore(const QModelIndex &parent) const override;
     void fetchMore(const QModelIndex &parent) override;
+    QStringList mimeTypes() const override;
+    QMimeData *mimeData(const QModelIndexList &indexes) const override;
 
     QString filePath(const QModelIndex &index) const;
     bool isDir(const QModelIndex &index) const;
+    uint32_t fileSize(const QModelIndex &index) const;
     QModelIndex indexFromPath(const QString &path) const;
 
     // Actions
     void refresh(const QModelIndex &parent);
+    void markStale(const QString &path);
+
+    // Keep the tree (and its totals) current without a new listing
+    void fileWritten(const QString &path, uint32_t size);
+    void removePath(const QString &path);
+    void setDriveUsage(const QString &drive, uint64_t used);
+
+    // Contents column: headers decoded from peeks. The view calls
+    // requestPeek for the rows it shows; one without a cached entry asks
+    // for a peek, once per session.
+    void setHeaderCache(HeaderCache *cache) { headerCache = cache; }
+    void requestPeek(const QModelIndex &index);
+    void headerChanged(const QString &path);
+    QByteArray fileMeta(const QModelIndex &index) const;
+
+    // Prefetch support. Folders under parent that were never listed, and a
+    // way to claim one so the view's own fetchMore doesn't list it twice.
+    QStringList unfetchedSubdirs(const QModelIndex &parent) const;
+    bool beginFetch(const QString &path);
+    void abortFetch(const QString &path);
+    // Rough heap footprint of the tree, for the prefetch budget
+    size_t approximateMemory() const { return memoryBytes; }
+
+    // Name search over everything listed so far, kept in step with the tree
+    const RemoteSearchIndex &searchIndex() const { return nameIndex; }
+    // Folders anywhere in the tree that were never listed, for a full crawl
+    QStringList unfetchedFolders() const;
 
 signals:
     void fetchRequested(const QString &path);
+    void peekRequested(const QString &path);
 
 public slots:
     void onDirectoryListing(const QString &path, const std::vector<Pixl::FileEntry>& entries);
@@ -63,6 +114,18 @@ public slots:
 private:
     BleManager* bleManager = nullptr;
     RemoteFileNode* rootNode;
+    size_t memoryBytes = 0;
+    RemoteSearchIndex nameIndex;
+    HeaderCache *headerCache = nullptr;
+    QSet<QString> peekAsked;
+
+    static size_t nodeBytes(const RemoteFileNode *node);
+    static size_t subtreeBytes(const RemoteFileNode *node);
     
+    QModelIndex indexOf(RemoteFileNode *node, int column = 0) const;
+    // Adds the deltas to node and every folder above it
+    void addTotals(RemoteFileNode *node, int64_t bytes, int64_t files, int64_t unlisted);
+    void adjustDriveUsage(RemoteFileNode *node, int64_t bytes);
     RemoteFileNode* nodeFromIndex(const QModelIndex &index) const;
+    RemoteFileNode* nodeFromPath(const QString &path) const;
 };
@@ -0,0 +1,158 @@
+#include "RemoteSearchIndex.h"
+#include <algorithm>
+
+namespace {
+
+// Removed entries stay in the postings until there are this many of them
+// and more than live ones, then everything is rebuilt in one go
+constexpr size_t COMPACT_THRESHOLD = 4096;
+
+} // namespace
+
+std::string RemoteSearchIndex::lower(const std::string& text) {
+    std::string result = text;
+    for (char& c : result) {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    return result;
+}
+
+// Same rule as the model: no trailing slash except on a drive root like "E:/"
+std::string RemoteSearchIndex::normalize(const std::string& path) {
+    if (path.size() > 3 && path.back() == '/') return path.substr(0, path.size() - 1);
+    return path;
+}
+
+void RemoteSearchIndex::clear() {
+    entries.clear();
+    names.clear();
+    children.clear();
+    postings.clear();
+    live = 0;
+}
+
+void RemoteSearchIndex::replaceFolder(const std::string& folder, const std::vector<Item>& items) {
+    std::string key = normalize(folder);
+    removeSubtree(key);
+    auto& ids = children[key];
+    ids.reserve(items.size());
+    for (const auto& item : items) add(key, item);
+
+    size_t dead = entries.size() - live;
+    if (dead > COMPACT_THRESHOLD && dead > live) compact();
+}
+
+void RemoteSearchIndex::insert(const std::string& folder, const Item& item) {
+    std::string key = normalize(folder);
+    remove(item.path);
+    add(key, item);
+}
+
+void RemoteSearchIndex::remove(const std::string& path) {
+    std::string key = normalize(path);
+    size_t slash = key.find_last_of('/');
+    if (slash == std::string::npos) return;
+    auto it = children.find(normalize(key.substr(0, slash + 1)));
+    if (it == children.end()) return;
+    auto& ids = it->second;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        Entry& entry = entries[ids[i]];
+        if (!entry.alive || normalize(entry.item.path) != key) continue;
+        if (entry.item.folder) removeSubtree(key);
+        entry.alive = false;
+        live--;
+        ids.erase(ids.begin() + static_cast<std::ptrdiff_t>(i));
+        return;
+    }
+}
+
+void RemoteSearchIndex::removeSubtree(const std::string& folder) {
+    auto it = children.find(folder);
+    if (it == children.end()) return;
+    std::vector<uint32_t> ids = std::move(it->second);
+    children.erase(it);
+    for (uint32_t id : ids) {
+        Entry& entry = entries[id];
+        if (!entry.alive) continue;
+        if (entry.item.folder) removeSubtree(normalize(entry.item.path));
+        entry.alive = false;
+        live--;
+    }
+}
+
+void RemoteSearchIndex::add(const std::string& folder, const Item& item) {
+    uint32_t id = static_cast<uint32_t>(entries.size());
+    std::string key = lower(item.name);
+    entries.push_back({item, key, names.size(), true});
+    names += key;
+    names += '\n';
+    children[folder].push_back(id);
+    live++;
+
+    if (key.size() < 3) return;
+    std::vector<uint32_t> grams;
+    grams.reserve(key.size() - 2);
+    for (size_t i = 0; i + 3 <= key.size(); ++i) grams.push_back(trigram(key.data() + i));
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    for (uint32_t gram : grams) postings[gram].push_back(id);
+}
+
+void RemoteSearchIndex::compact() {
+    std::vector<Entry> old = std::move(entries);
+    std::unordered_map<std::string, std::vector<uint32_t>> folders = std::move(children);
+    clear();
+    for (auto& [folder, ids] : folders) {
+        children[folder]; // Listed folders stay known even when empty
+        for (uint32_t id : ids) {
+            if (old[id].alive) add(folder, old[id].item);
+        }
+    }
+}
+
+std::vector<RemoteSearchIndex::Item> RemoteSearchIndex::search(const std::string& query, size_t limit) const {
+    std::vector<Item> results;
+    std::string needle = lower(query);
+    if (needle.empty() || limit == 0) return results;
+
+    // Names starting with the query come first, so the scan only stops
+    // early once those alone fill the limit
+    std::vector<Item> others;
+    auto take = [&](const Entry& entry) {
+        if (entry.key.compare(0, needle.size(), needle) == 0) {
+            results.push_back(entry.item);
+        } else if (others.size() < limit) {
+            others.push_back(entry.item);
+        }
+        return results.size() < limit;
+    };
+
+    if (needle.size() < 3) {
+        size_t pos = 0;
+        while ((pos = names.find(needle, pos)) != std::string::npos) {
+            auto next = std::upper_bound(entries.begin(), entries.end(), pos,
+                                         [](size_t offset, const Entry& entry) { return offset < entry.offset; });
+            const Entry& entry = *(next - 1);
+            if (entry.alive && !take(entry)) break;
+            if (next == entries.end()) break;
+            pos = next->offset;
+        }
+    } else {
+        // Every match contains all the query's trigrams, so the shortest
+        // posting list is enough to find them
+        const std::vector<uint32_t>* shortest = nullptr;
+        for (size_t i = 0; i + 3 <= needle.size(); ++i) {
+            auto it = postings.find(trigram(needle.data() + i));
+            if (it == postings.end()) return results;
+            if (!shortest || it->second.size() < shortest->size()) shortest = &it->second;
+        }
+        for (uint32_t id : *shortest) {
+            const Entry& entry = entries[id];
+            if (entry.alive && entry.key.find(needle) != std::string::npos && !take(entry)) break;
+        }
+    }
+
+    size_t room = std::min(others.size(), limit - results.size());
+    results.insert(results.end(), others.begin(), others.begin() + room);
+    return results;
+}
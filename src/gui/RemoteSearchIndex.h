@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// Filename search over every remote entry that has been listed. Names are
+// indexed by their lowercase trigrams, so a query only looks at the entries
+// sharing its rarest trigram. One or two letter queries scan all the names,
+// which are also kept back to back in one buffer so that stays fast.
+// Updated listing by listing: a listing replaces its folder's whole subtree,
+// just as it does in RemoteFileSystemModel.
+class RemoteSearchIndex {
+public:
+    struct Item {
+        std::string path;
+        std::string name;
+        uint32_t size = 0;
+        bool folder = false;
+    };
+
+    void replaceFolder(const std::string& folder, const std::vector<Item>& items);
+    // Single entries changing without a new listing, e.g. after an upload
+    void insert(const std::string& folder, const Item& item);
+    void remove(const std::string& path);
+    void clear();
+
+    // Case-insensitive substring match on names. Returns at most limit
+    // items, those whose name starts with the query first.
+    std::vector<Item> search(const std::string& query, size_t limit) const;
+    size_t size() const { return live; }
+
+private:
+    struct Entry {
+        Item item;
+        std::string key; // Lowercase name
+        size_t offset;   // Of key in names
+        bool alive = true;
+    };
+
+    void removeSubtree(const std::string& folder);
+    void add(const std::string& folder, const Item& item);
+    void compact();
+    static std::string lower(const std::string& text);
+    static std::string normalize(const std::string& path);
+    static uint32_t trigram(const char* p) {
+        return static_cast<uint32_t>(static_cast<uint8_t>(p[0])) << 16 |
+               static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 8 | static_cast<uint8_t>(p[2]);
+    }
+
+    std::vector<Entry> entries;
+    std::string names; // Every key, '\n' terminated, in entry order
+    std::unordered_map<std::string, std::vector<uint32_t>> children; // Entry ids by folder
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings;     // Entry ids by trigram, ascending
+    size_t live = 0;
+};
@@ -0,0 +1,127 @@
+#include "TransferStatsPanel.h"
+#include "../transfer/TransferMetrics.h"
+#include "../ble/BleManager.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QFile>
+#include <QJsonDocument>
+#include <QMessageBox>
+
+static QString formatLatency(qint64 us) {
+    if (us >= 1000) return QString::number(us / 1000.0, 'f', 1) + " ms";
+    return QString::number(us) + " us";
+}
+
+static QString formatRate(double bytesPerSecond) {
+    if (bytesPerSecond >= 1024) return QString::number(bytesPerSecond / 1024.0, 'f', 1) + " KB/s";
+    return QString::number(bytesPerSecond, 'f', 0) + " B/s";
+}
+
+TransferStatsPanel::TransferStatsPanel(const TransferMetrics *metrics, QWidget *parent)
+    : QWidget(parent), metrics(metrics) {
+    auto *layout = new QVBoxLayout(this);
+
+    summaryLabel = new QLabel(this);
+    summaryLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(summaryLabel);
+
+    adaptersLabel = new QLabel(this);
+    adaptersLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    layout->addWidget(adaptersLabel);
+
+    table = new QTableWidget(0, 9, this);
+    table->setHorizontalHeaderLabels({"Command", "Sent", "Errors", "Dropped", "Retries",
+                                      "p50", "p90", "p99", "Max"});
+    table->verticalHeader()->setVisible(false);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    layout->addWidget(table);
+
+    auto *buttons = new QHBoxLayout();
+    csvButton = new QPushButton("Export CSV", this);
+    jsonButton = new QPushButton("Export JSON", this);
+    resetButton = new QPushButton("Reset", this);
+    buttons->addWidget(csvButton);
+    buttons->addWidget(jsonButton);
+    buttons->addStretch();
+    buttons->addWidget(resetButton);
+    layout->addLayout(buttons);
+
+    connect(csvButton, &QPushButton::clicked, this, &TransferStatsPanel::exportCsv);
+    connect(jsonButton, &QPushButton::clicked, this, &TransferStatsPanel::exportJson);
+    connect(resetButton, &QPushButton::clicked, this, &TransferStatsPanel::resetRequested);
+    connect(&refreshTimer, &QTimer::timeout, this, &TransferStatsPanel::refresh);
+    refreshTimer.start(500);
+    refresh();
+}
+
+void TransferStatsPanel::refresh() {
+    // No point redrawing while the dock is hidden
+    if (!isVisible()) return;
+
+    summaryLabel->setText(QString("TX %1 (%2 total)   RX %3 (%4 total)   In flight %5 (peak %6)")
+        .arg(formatRate(metrics->txBytesPerSecond())).arg(metrics->totalBytesSent())
+        .arg(formatRate(metrics->rxBytesPerSecond())).arg(metrics->totalBytesReceived())
+        .arg(metrics->inFlight()).arg(metrics->maxInFlight()));
+
+    // Sessions in this process per radio; the link service reports its own with --adapters
+    QStringList adapters;
+    for (const auto &adapter : BleManager::adapterStats()) {
+        adapters << QString("%1: %2 connection(s), %3")
+            .arg(QString::fromStdString(adapter.identifier))
+            .arg(adapter.connections)
+            .arg(formatRate(adapter.bytesPerSecond));
+    }
+    adaptersLabel->setText(adapters.join("   "));
+    adaptersLabel->setVisible(!adapters.isEmpty());
+
+    const auto &commands = metrics->commands();
+    table->setRowCount(static_cast<int>(commands.size()));
+    int row = 0;
+    for (const auto &[cmd, s] : commands) {
+        const QStringList cells = {
+            TransferMetrics::commandName(cmd),
+            QString::number(s.sent),
+            QString::number(s.failed + s.corrupt),
+            QString::number(s.dropped),
+            QString::number(s.retries),
+            formatLatency(s.percentileUs(50)),
+            formatLatency(s.percentileUs(90)),
+            formatLatency(s.percentileUs(99)),
+            formatLatency(s.maxLatencyUs),
+        };
+        for (int col = 0; col < cells.size(); ++col) {
+            auto *item = table->item(row, col);
+            if (!item) {
+                item = new QTableWidgetItem;
+                table->setItem(row, col, item);
+            }
+            item->setText(cells[col]);
+        }
+        ++row;
+    }
+}
+
+void TransferStatsPanel::exportCsv() {
+    QString path = QFileDialog::getSaveFileName(this, "Export Transfer Stats", "joymanager-stats.csv", "CSV (*.csv)");
+    if (path.isEmpty()) return;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QMessageBox::warning(this, "Export Failed", file.errorString());
+        return;
+    }
+    file.write(metrics->toCsv().toUtf8());
+}
+
+void TransferStatsPanel::exportJson() {
+    QString path = QFileDialog::getSaveFileName(this, "Export Transfer Stats", "joymanager-stats.json", "JSON (*.json)");
+    if (path.isEmpty()) return;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        QMessageBox::warning(this, "Export Failed", file.errorString());
+        return;
+    }
+    file.write(QJsonDocument(metrics->toJson()).toJson());
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QWidget>
+#include <QTableWidget>
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+
+class TransferMetrics;
+
+// Live view of TransferMetrics, meant to sit in a dock widget.
+class TransferStatsPanel : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit TransferStatsPanel(const TransferMetrics *metrics, QWidget *parent = nullptr);
+
+signals:
+    void resetRequested();
+
+private slots:
+    void refresh();
+    void exportCsv();
+    void exportJson();
+
+private:
+    const TransferMetrics *metrics;
+    QLabel *summaryLabel;
+    QLabel *adaptersLabel;
+    QTableWidget *table;
+    QPushButton *csvButton;
+    QPushButton *jsonButton;
+    QPushButton *resetButton;
+    QTimer refreshTimer;
+};
@@ -1,9 +1,225 @@
 #include <QApplication>
 #include <QMainWindow>
+#include <QDockWidget>
+#include <QMenuBar>
 #include "gui/FileManagerView.h"
+#include "gui/TransferStatsPanel.h"
+#include "transfer/TransferMetrics.h"
+#include "common/Tracer.h"
+#include "transfer/StartupReport.h"
+#include <QTimer>
+#include <QDebug>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+#include "ble/LinkServer.h"
+#include "ble/LinkClient.h"
+#include "protocol/PixlProtocol.h"
+#include "protocol/FirmwareProfile.h"
+#include "transfer/UploadPlan.h"
+#include "transfer/UploadSource.h"
+
+// Attaches to the link service and checks it has a device
+static bool attachToDevice(LinkClient &client, QTextStream &err) {
+    if (!client.connectToService()) {
+        err << "Link service is not running (start it with --daemon)\n";
+        return false;
+    }
+
+    bool connected = false, finished = false;
+    auto conn = QObject::connect(&client, &LinkClient::status, [&](bool isConnected, const QString &, const QString &) {
+        connected = isConnected;
+        finished = true;
+    });
+    client.requestStatus();
+    while (!finished && client.waitForFrame(3000)) {}
+    QObject::disconnect(conn);
+    if (!connected) {
+        err << "No device connected to the link service\n";
+        return false;
+    }
+    return true;
+}
+
+// Sends one command through the link and waits for its whole response.
+// Returns the status, or -1 if no answer came.
+static int linkRequest(LinkClient &client, Pixl::Command cmd, const std::vector<uint8_t> &payload,
+                       std::vector<uint8_t> *response = nullptr) {
+    bool finished = false;
+    int status = -1;
+    std::vector<uint8_t> data;
+    auto conn = QObject::connect(&client, &LinkClient::notification, [&](const QByteArray &bytes) {
+        std::vector<uint8_t> raw(bytes.begin(), bytes.end());
+        if (raw.size() < 4 || raw[0] != static_cast<uint8_t>(cmd)) return;
+        Pixl::Packet pkt = Pixl::Protocol::parsePacket(raw);
+        status = pkt.status;
+        data.insert(data.end(), pkt.payload.begin(), pkt.payload.end());
+        finished = !pkt.hasMoreData();
+    });
+    client.sendPacket(Pixl::Protocol::createPacket(cmd, payload));
+    while (!finished && client.waitForFrame(10000)) {}
+    QObject::disconnect(conn);
+    if (response) *response = std::move(data);
+    return finished ? status : -1;
+}
+
+// Lists a remote folder through the link service without opening a window
+static int runList(const QString &path) {
+    QTextStream out(stdout), err(stderr);
+    LinkClient client;
+    if (!attachToDevice(client, err)) return 1;
+
+    std::vector<uint8_t> listing;
+    if (linkRequest(client, Pixl::Command::ReadDir, Pixl::Protocol::createStringPayload(path.toStdString()), &listing) != 0) {
+        err << "Could not list " << path << "\n";
+        return 1;
+    }
+
+    for (const auto &entry : Pixl::Protocol::parseDirEntries(listing)) {
+        out << (entry.type == 1 ? "d " : "- ") << qSetFieldWidth(10) << entry.size << qSetFieldWidth(0)
+            << " " << QString::fromStdString(entry.name) << "\n";
+    }
+    return 0;
+}
+
+// Uploads a local file, folder or archive into a remote folder through the
+// link service, planned exactly as a drop in the window (see UploadPlan).
+// Files are sent chunk by chunk from an UploadSource, never read whole.
+static int runUpload(const QString &localPath, const QString &remoteDir) {
+    QTextStream out(stdout), err(stderr);
+    LinkClient client;
+    if (!attachToDevice(client, err)) return 1;
+
+    // Same write size as the window would pick for this firmware
+    std::vector<uint8_t> version;
+    linkRequest(client, Pixl::Command::GetVersion, {}, &version);
+    const qint64 chunkSize = static_cast<qint64>(Pixl::FirmwareProfile::parse(version).maxChunk);
+
+    int failed = 0;
+    auto createFolder = [&](const QString &path) {
+        int status = linkRequest(client, Pixl::Command::CreateFolder, Pixl::Protocol::createStringPayload(path.toStdString()));
+        if (status != 0 && status != 1) { // 1: already there
+            err << "Could not create " << path << "\n";
+            failed++;
+        }
+    };
+    auto uploadFile = [&](const UploadPlan::Item &item) {
+        UploadSource source;
+        bool opened = item.archive ? source.openArchiveEntry(item.archive, item.entry) : source.open(item.source);
+        if (!opened) {
+            err << "Could not read " << item.source << "\n";
+            failed++;
+            return;
+        }
+        std::vector<uint8_t> response;
+        auto openPayload = Pixl::Protocol::createOpenFilePayload(item.target.toStdString(), 0x16);
+        if (linkRequest(client, Pixl::Command::OpenFile, openPayload, &response) != 0 || response.empty()) {
+            err << "Could not open " << item.target << "\n";
+            failed++;
+            return;
+        }
+        uint8_t fileId = response[0];
+        bool ok = true;
+        qint64 offset = 0;
+        std::vector<uint8_t> packet;
+        while (ok) {
+            UploadSource::Chunk chunk = source.chunkAt(offset, chunkSize);
+            if (chunk.size == 0) break;
+            packet.assign(1, fileId);
+            packet.insert(packet.end(), chunk.data, chunk.data + chunk.size);
+            ok = linkRequest(client, Pixl::Command::WriteFile, packet) == 0;
+            offset += chunk.size;
+        }
+        ok = ok && !source.hasError() && offset == source.size();
+        ok = linkRequest(client, Pixl::Command::CloseFile, {fileId}) == 0 && ok;
+        if (!ok) {
+            err << "Could not write " << item.target << "\n";
+            failed++;
+            return;
+        }
+        out << item.target << " (" << offset << " bytes)\n";
+    };
+
+    for (const UploadPlan::Item &item : UploadPlan::scan(localPath, remoteDir).items()) {
+        if (item.folder) createFolder(item.target);
+        else uploadFile(item);
+    }
+
+    if (failed > 0) err << failed << " item(s) failed\n";
+    return failed > 0 ? 1 : 0;
+}
+
+// Prints the link service's adapter table
+static int runAdapters() {
+    QTextStream out(stdout), err(stderr);
+    LinkClient client;
+    if (!client.connectToService()) {
+        err << "Link service is not running (start it with --daemon)\n";
+        return 1;
+    }
+    bool received = false;
+    QObject::connect(&client, &LinkClient::adapters, [&](const QStringList &lines) {
+        for (const QString &line : lines) out << line << "\n";
+        received = true;
+    });
+    client.requestAdapters();
+    while (!received && client.waitForFrame(3000)) {}
+    return received ? 0 : 1;
+}
 
 int main(int argc, char *argv[]) {
+    // Headless modes have to be picked before a QApplication exists
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--daemon") == 0) {
+            QCoreApplication app(argc, argv);
+            LinkServer server;
+            if (!server.listen()) return 1;
+            return app.exec();
+        }
+        if (qstrcmp(argv[i], "--adapters") == 0) {
+            QCoreApplication app(argc, argv);
+            return runAdapters();
+        }
+        if (qstrcmp(argv[i], "--ls") == 0 && i + 1 < argc) {
+            QCoreApplication app(argc, argv);
+            return runList(QString::fromLocal8Bit(argv[i + 1]));
+        }
+        if (qstrcmp(argv[i], "--upload") == 0 && i + 2 < argc) {
+            QCoreApplication app(argc, argv);
+            return runUpload(QString::fromLocal8Bit(argv[i + 1]), QString::fromLocal8Bit(argv[i + 2]));
+        }
+    }
+
+    // JOYMANAGER_TRACE=/path/trace.json records the whole session, startup included
+    const QString tracePath = qEnvironmentVariable("JOYMANAGER_TRACE");
+    if (!tracePath.isEmpty()) Tracer::start();
+
     QApplication app(argc, argv);
+    Tracer::setThreadName("GUI");
+    StartupReport::mark("QApplication");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption replayOption("replay", "Replay a BLE capture instead of connecting to a device.", "capture");
+    QCommandLineOption realTimeOption("real-time", "Replay with the captured timing instead of at full speed.");
+    QCommandLineOption daemonOption("daemon", "Run the background link service that keeps the device connected.");
+    QCommandLineOption adaptersOption("adapters", "Show per-adapter connections and throughput of the link service and exit.");
+    QCommandLineOption listOption("ls", "List a remote folder through the link service and exit.", "path");
+    QCommandLineOption uploadOption("upload", "Upload a file, folder or zip/tar archive through the link service "
+                                    "and exit: --upload <local> <remote folder>.", "local");
+    parser.addOption(replayOption);
+    parser.addOption(realTimeOption);
+    QCommandLineOption startupReportOption("startup-report", "Write cold start timings as JSON once the window is up.", "file");
+    QCommandLineOption quitOption("quit-after-startup", "Exit as soon as the window is up (with --startup-report, for timing runs).");
+    parser.addOption(daemonOption);
+    parser.addOption(listOption);
+    parser.addOption(uploadOption);
+    parser.addOption(adaptersOption);
+    parser.addOption(startupReportOption);
+    parser.addOption(quitOption);
+    parser.process(app);
 
     QMainWindow window;
     window.setWindowTitle("JoyManager");
@@ -11,8 +227,122 @@ int main(int argc, char *argv[]) {
 
     FileManagerView *fileManager = new FileManagerView(&window);
     window.setCentralWidget(fileManager);
+    StartupReport::mark("FileManagerView");
+
+    auto *statsDock = new QDockWidget("Transfer Stats", &window);
+    statsDock->setObjectName("transferStatsDock");
+    auto *statsPanel = new TransferStatsPanel(fileManager->metrics(), statsDock);
+    QObject::connect(statsPanel, &TransferStatsPanel::resetRequested, [fileManager]() {
+        fileManager->metrics()->reset();
+    });
+    statsDock->setWidget(statsPanel);
+    window.addDockWidget(Qt::BottomDockWidgetArea, statsDock);
+    statsDock->hide();
+
+    QMenu *viewMenu = window.menuBar()->addMenu("View");
+    viewMenu->addAction(statsDock->toggleViewAction());
+
+    QAction *traceAction = viewMenu->addAction("Record Trace");
+    traceAction->setCheckable(true);
+    traceAction->setChecked(Tracer::enabled());
+    QObject::connect(traceAction, &QAction::toggled, [&window](bool on) {
+        if (on) {
+            Tracer::start();
+            return;
+        }
+        Tracer::stop();
+        QString path = QFileDialog::getSaveFileName(&window, "Save Trace", "joymanager-trace.json", "Chrome Trace (*.json)");
+        if (!path.isEmpty() && !Tracer::writeJson(path.toStdString())) {
+            QMessageBox::warning(&window, "Save Trace", "Could not write " + path);
+        }
+    });
+
+    QMenu *deviceMenu = window.menuBar()->addMenu("Device");
+    QAction *reconnectAction = deviceMenu->addAction("Reconnect Automatically");
+    reconnectAction->setCheckable(true);
+    reconnectAction->setChecked(fileManager->autoReconnect());
+    QObject::connect(reconnectAction, &QAction::toggled, [fileManager](bool on) {
+        fileManager->setAutoReconnect(on);
+    });
+    QAction *verifyAction = deviceMenu->addAction("Verify Uploads");
+    verifyAction->setCheckable(true);
+    verifyAction->setChecked(fileManager->verifyUploads());
+    QObject::connect(verifyAction, &QAction::toggled, [fileManager](bool on) {
+        fileManager->setVerifyUploads(on);
+    });
+    QAction *backupAction = deviceMenu->addAction("Back Up Device...");
+    QObject::connect(backupAction, &QAction::triggered, [fileManager]() {
+        fileManager->backupDevice();
+    });
+    QAction *restoreAction = deviceMenu->addAction("Restore Backup...");
+    QObject::connect(restoreAction, &QAction::triggered, [fileManager]() {
+        fileManager->restoreBackup();
+    });
+    QAction *mirrorAction = deviceMenu->addAction("Mirror Local Folder...");
+    mirrorAction->setCheckable(true);
+    QObject::connect(mirrorAction, &QAction::triggered, [fileManager, mirrorAction](bool on) {
+        if (on) mirrorAction->setChecked(fileManager->startMirror());
+        else fileManager->stopMirror();
+    });
+    QObject::connect(fileManager, &FileManagerView::mirrorStopped, mirrorAction, [mirrorAction]() {
+        mirrorAction->setChecked(false);
+    });
+    deviceMenu->addSeparator();
+    QAction *planAction = deviceMenu->addAction("Create Load Plan...");
+    QObject::connect(planAction, &QAction::triggered, [fileManager]() {
+        fileManager->createLoadPlan();
+    });
+    QAction *provisionAction = deviceMenu->addAction("Provision Device...");
+    QObject::connect(provisionAction, &QAction::triggered, [fileManager]() {
+        fileManager->provisionDevice();
+    });
+
+    QMenu *debugMenu = window.menuBar()->addMenu("Debug");
+    QAction *captureAction = debugMenu->addAction("Capture BLE Traffic...");
+    captureAction->setCheckable(true);
+    QObject::connect(captureAction, &QAction::toggled, [&window, fileManager, captureAction](bool on) {
+        if (!on) {
+            fileManager->stopCapture();
+            return;
+        }
+        QString path = QFileDialog::getSaveFileName(&window, "Capture BLE Traffic", "joymanager.jmcap", "BLE Capture (*.jmcap)");
+        if (path.isEmpty() || !fileManager->startCapture(path)) {
+            QSignalBlocker block(captureAction);
+            captureAction->setChecked(false);
+        }
+    });
+    debugMenu->addAction("Replay Capture...", [&window, fileManager]() {
+        QString path = QFileDialog::getOpenFileName(&window, "Replay Capture", QString(), "BLE Capture (*.jmcap)");
+        if (path.isEmpty()) return;
+        auto speed = QMessageBox::question(&window, "Replay Capture", "Replay with the captured timing?\n"
+                                           "Choose No to replay as fast as possible.");
+        if (!fileManager->replayCapture(path, speed == QMessageBox::Yes)) {
+            QMessageBox::warning(&window, "Replay Capture", "Could not open " + path);
+        }
+    });
 
     window.show();
+    StartupReport::mark("window shown");
+
+    // The first event loop turn is when the window can actually paint
+    QTimer::singleShot(0, &app, [&parser, &startupReportOption, &quitOption]() {
+        StartupReport::mark("event loop running");
+        qDebug().noquote() << "Startup timings:\n" + QString::fromStdString(StartupReport::summary());
+        if (parser.isSet(startupReportOption)) {
+            StartupReport::writeJson(parser.value(startupReportOption).toStdString());
+        }
+        if (parser.isSet(quitOption)) QCoreApplication::quit();
+    });
+
+    if (parser.isSet(replayOption)) {
+        fileManager->replayCapture(parser.value(replayOption), parser.isSet(realTimeOption));
+    }
+
+    int result = app.exec();
 
-    return app.exec();
+    if (!tracePath.isEmpty() && Tracer::enabled()) {
+        Tracer::stop();
+        Tracer::writeJson(tracePath.toStdString());
+    }
+    return result;
 }
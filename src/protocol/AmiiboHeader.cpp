@@ -0,0 +1,61 @@
+#include "AmiiboHeader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace Pixl {
+
+namespace {
+
+// NTAG215 dumps are 540 bytes; some tools drop or add the trailing pages
+constexpr uint32_t MIN_DUMP_SIZE = 532;
+constexpr uint32_t MAX_DUMP_SIZE = 572;
+
+// Page 21 onwards holds the identification block; its last byte is always 0x02
+constexpr size_t ID_OFFSET = 0x54;
+
+std::string hex(const uint8_t* data, size_t size) {
+    std::string out;
+    char buf[3];
+    for (size_t i = 0; i < size; ++i) {
+        std::snprintf(buf, sizeof(buf), "%02X", data[i]);
+        out += buf;
+    }
+    return out;
+}
+
+} // namespace
+
+bool AmiiboHeader::isCandidate(const std::string& name, uint32_t size) {
+    if (size < MIN_DUMP_SIZE || size > MAX_DUMP_SIZE || name.size() < 4) return false;
+    std::string ext = name.substr(name.size() - 4);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".bin";
+}
+
+std::optional<AmiiboHeader> AmiiboHeader::decode(const std::vector<uint8_t>& head) {
+    if (head.size() < HEADER_BYTES || head[ID_OFFSET + 7] != 0x02) return std::nullopt;
+
+    AmiiboHeader header;
+    // UID bytes 0-2, then the check byte, then bytes 3-6
+    uint8_t uid[7] = {head[0], head[1], head[2], head[4], head[5], head[6], head[7]};
+    header.uid = hex(uid, sizeof(uid));
+    const uint8_t* id = head.data() + ID_OFFSET;
+    header.amiiboId = hex(id, 4) + "-" + hex(id + 4, 4);
+    header.character = static_cast<uint16_t>(id[0] << 8 | id[1]);
+    header.variant = id[2];
+    header.figureType = id[3];
+    header.model = static_cast<uint16_t>(id[4] << 8 | id[5]);
+    header.series = id[6];
+    return header;
+}
+
+std::string AmiiboHeader::summary() const {
+    static const char* const types[] = {"Figure", "Card", "Yarn", "Band"};
+    std::string type = figureType < 4 ? types[figureType] : "Type " + std::to_string(figureType);
+    char series[8];
+    std::snprintf(series, sizeof(series), "%02X", this->series);
+    return type + ", amiibo " + amiiboId + ", series " + series + ", UID " + uid;
+}
+
+} // namespace Pixl
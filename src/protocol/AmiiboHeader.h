@@ -0,0 +1,30 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace Pixl {
+
+// What the plain (unencrypted) start of an NTAG215 amiibo dump says about
+// the figure. Everything needed sits in the first HEADER_BYTES, so a peek
+// is enough; the nickname and owner are encrypted and not decoded.
+struct AmiiboHeader {
+    static constexpr size_t HEADER_BYTES = 92;
+
+    std::string uid;      // 7 byte tag UID, hex
+    std::string amiiboId; // Identification block, hex, "hhhhhhhh-tttttttt"
+    uint16_t character = 0; // Game series and character
+    uint8_t variant = 0;
+    uint8_t figureType = 0; // 0 figure, 1 card, 2 yarn, 3 band
+    uint16_t model = 0;
+    uint8_t series = 0;     // amiibo series, e.g. Super Smash Bros.
+
+    // Whether a remote file looks like a dump worth peeking at
+    static bool isCandidate(const std::string& name, uint32_t size);
+    static std::optional<AmiiboHeader> decode(const std::vector<uint8_t>& head);
+    std::string summary() const;
+};
+
+} // namespace Pixl
@@ -0,0 +1,73 @@
+#include "FirmwareProfile.h"
+#include "PixlProtocol.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace Pixl {
+
+namespace {
+
+// First "major.minor[.patch]" in text, e.g. "2.6.0" or "v2.7.1-beta"
+void parseNumbers(const std::string& text, FirmwareProfile& profile) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(text[i]))) continue;
+        int major = 0, minor = 0, patch = 0;
+        int n = std::sscanf(text.c_str() + i, "%d.%d.%d", &major, &minor, &patch);
+        if (n >= 2) {
+            profile.major = major;
+            profile.minor = minor;
+            profile.patch = n == 3 ? patch : 0;
+            return;
+        }
+    }
+}
+
+bool printable(const std::string& text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) {
+        return std::isprint(static_cast<unsigned char>(c));
+    });
+}
+
+} // namespace
+
+FirmwareProfile FirmwareProfile::parse(const std::vector<uint8_t>& payload) {
+    FirmwareProfile profile;
+    size_t offset = 0;
+    std::string version = Protocol::parseString(payload, offset);
+    if (!printable(version)) {
+        // Not length prefixed: take the payload as plain text up to a NUL
+        auto end = std::find(payload.begin(), payload.end(), 0);
+        version.assign(payload.begin(), end);
+        if (!printable(version)) return profile;
+        offset = payload.size();
+    }
+    profile.version = version;
+    parseNumbers(version, profile);
+
+    // Whatever else follows the version is not a capability block
+    if (payload.size() - offset < BLOCK_SIZE || payload[offset] != BLOCK_MARKER[0] ||
+        payload[offset + 1] != BLOCK_MARKER[1] || payload[offset + 2] != BLOCK_VERSION) {
+        return profile;
+    }
+    offset += 3;
+    uint8_t flags = payload[offset++];
+    profile.reported = true;
+    profile.writeWithoutResponse = flags & FLAG_WRITE_WITHOUT_RESPONSE;
+    profile.updateMeta = flags & FLAG_UPDATE_META;
+    uint16_t chunk = Protocol::parseUInt16(payload, offset);
+    if (chunk > 0) profile.maxChunk = std::min(chunk, MAX_CHUNK);
+    profile.openFiles = std::max<uint8_t>(payload[offset], 1);
+    return profile;
+}
+
+std::string FirmwareProfile::describe() const {
+    char line[160];
+    std::snprintf(line, sizeof(line), "%s: %u byte writes%s, %u open file(s)%s%s",
+                  version.empty() ? "unknown firmware" : version.c_str(), static_cast<unsigned>(maxChunk),
+                  writeWithoutResponse ? " without response" : "", static_cast<unsigned>(openFiles),
+                  updateMeta ? ", metadata updates" : "", reported ? "" : " (baseline)");
+    return line;
+}
+
+} // namespace Pixl
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace Pixl {
+
+// What the connected firmware can do, read from its GetVersion reply: the
+// version string, optionally followed by a capability block
+//   ['P' 'C'][u8 block version = 1][u8 flags][u16 max WriteFile data][u8 open file handles]
+// (flags: bit 0 takes writes without response, bit 1 handles UpdateMeta).
+// The block only counts with its marker and a known block version, all of
+// it present. Anything else after the version (a NUL, build info) and
+// firmware that sends only the version get the baseline every firmware
+// handles, so nothing here is ever faster than the device says is safe.
+struct FirmwareProfile {
+    static constexpr uint16_t BASE_CHUNK = 200;
+    // A WriteFile has to fit one 512 byte attribute: packet header and file id
+    static constexpr uint16_t MAX_CHUNK = 512 - 4 - 1;
+    static constexpr uint8_t FLAG_WRITE_WITHOUT_RESPONSE = 0x01;
+    static constexpr uint8_t FLAG_UPDATE_META = 0x02;
+    static constexpr uint8_t BLOCK_MARKER[2] = {'P', 'C'};
+    static constexpr uint8_t BLOCK_VERSION = 1;
+    static constexpr size_t BLOCK_SIZE = 7;
+
+    std::string version; // As reported; empty if the reply had none
+    int major = 0;
+    int minor = 0;
+    int patch = 0;
+    bool reported = false; // Capabilities came from the device, not the baseline
+    uint16_t maxChunk = BASE_CHUNK;
+    bool writeWithoutResponse = false;
+    uint8_t openFiles = 1;
+    bool updateMeta = false;
+
+    static FirmwareProfile parse(const std::vector<uint8_t>& payload);
+    // One line for logs and tooltips
+    std::string describe() const;
+};
+
+} // namespace Pixl
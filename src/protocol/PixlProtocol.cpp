@@ -56,6 +56,12 @@ std::vector<uint8_t> Protocol::createRenamePayload(const std::string& oldPath, c
     return payload;
 }
 
+std::vector<uint8_t> Protocol::createDriveFormatPayload(char drive) {
+    bool letter = (drive >= 'A' && drive <= 'Z') || (drive >= 'a' && drive <= 'z');
+    if (!letter) return {};
+    return {static_cast<uint8_t>(drive)};
+}
+
 std::string Protocol::parseString(const std::vector<uint8_t>& payload, size_t& offset) {
     if (offset + 2 > payload.size()) return "";
     uint16_t len = payload[offset] | (payload[offset + 1] << 8);
@@ -82,4 +88,44 @@ uint32_t Protocol::parseUInt32(const std::vector<uint8_t>& payload, size_t& offs
     return val;
 }
 
+const char* Protocol::commandName(uint8_t cmd) {
+    switch (static_cast<Command>(cmd)) {
+        case Command::GetVersion: return "GetVersion";
+        case Command::EnterDfu: return "EnterDfu";
+        case Command::GetDriveList: return "GetDriveList";
+        case Command::DriveFormat: return "DriveFormat";
+        case Command::OpenFile: return "OpenFile";
+        case Command::CloseFile: return "CloseFile";
+        case Command::ReadFile: return "ReadFile";
+        case Command::WriteFile: return "WriteFile";
+        case Command::ReadDir: return "ReadDir";
+        case Command::CreateFolder: return "CreateFolder";
+        case Command::Remove: return "Remove";
+        case Command::Rename: return "Rename";
+        case Command::UpdateMeta: return "UpdateMeta";
+    }
+    return nullptr;
+}
+
+std::vector<FileEntry> Protocol::parseDirEntries(const std::vector<uint8_t>& payload) {
+    size_t offset = 0;
+    std::vector<FileEntry> entries;
+    while (offset < payload.size()) {
+        FileEntry entry;
+        entry.name = parseString(payload, offset);
+        entry.size = parseUInt32(payload, offset);
+        entry.type = 0;
+        if (offset < payload.size()) entry.type = payload[offset++];
+        if (offset < payload.size()) {
+            uint8_t metaLen = payload[offset++];
+            offset += metaLen;
+        }
+
+        if (!entry.name.empty())
+            entries.push_back(entry);
+        else break;
+    }
+    return entries;
+}
+
 } // namespace Pixl
@@ -38,6 +38,13 @@ struct Packet {
     uint16_t chunkIndex() const { return chunk & 0x7FFF; }
 };
 
+struct FileEntry {
+    std::string name;
+    uint32_t size;
+    uint8_t type; // 1 = dir, 0 = file
+    std::string meta;
+};
+
 class Protocol {
 public:
     static std::vector<uint8_t> createPacket(Command cmd, const std::vector<uint8_t>& payload = {}, uint16_t chunk = 0);
@@ -47,18 +54,21 @@ public:
     static std::vector<uint8_t> createStringPayload(const std::string& str);
     static std::vector<uint8_t> createOpenFilePayload(const std::string& path, uint8_t mode);
     static std::vector<uint8_t> createRenamePayload(const std::string& oldPath, const std::string& newPath);
+    // DriveFormat: a single byte, the drive's letter as the drive list
+    // reports it ('E' for "E:/"), with no length prefix. Empty if drive is
+    // not an ASCII letter, so nothing malformed reaches the device.
+    static std::vector<uint8_t> createDriveFormatPayload(char drive);
     
     // Helpers for payload parsing
     static std::string parseString(const std::vector<uint8_t>& payload, size_t& offset);
     static uint16_t parseUInt16(const std::vector<uint8_t>& payload, size_t& offset);
     static uint32_t parseUInt32(const std::vector<uint8_t>& payload, size_t& offset);
-};
 
-struct FileEntry {
-    std::string name;
-    uint32_t size;
-    uint8_t type; // 1 = dir, 0 = file
-    std::string meta;
+    // Readable command name for logs and diagnostics; nullptr if unknown
+    static const char* commandName(uint8_t cmd);
+
+    // Decodes a complete ReadDir response
+    static std::vector<FileEntry> parseDirEntries(const std::vector<uint8_t>& payload);
 };
 
 } // namespace Pixl
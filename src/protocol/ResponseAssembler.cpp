@@ -0,0 +1,73 @@
+#include "ResponseAssembler.h"
+#include <algorithm>
+
+namespace Pixl {
+
+std::vector<uint8_t> BufferPool::acquire(size_t reserve) {
+    std::vector<uint8_t> buffer;
+    if (!freeBuffers.empty()) {
+        // Prefer the largest pooled buffer, it is the most likely to fit.
+        auto it = std::max_element(freeBuffers.begin(), freeBuffers.end(),
+            [](const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+                return a.capacity() < b.capacity();
+            });
+        buffer = std::move(*it);
+        freeBuffers.erase(it);
+    }
+    buffer.clear();
+    if (reserve > buffer.capacity()) {
+        buffer.reserve(reserve);
+    }
+    return buffer;
+}
+
+void BufferPool::release(std::vector<uint8_t>&& buffer) {
+    if (freeBuffers.size() >= maxPooled || buffer.capacity() == 0) return;
+    buffer.clear();
+    freeBuffers.push_back(std::move(buffer));
+}
+
+void ResponseAssembler::begin(BufferPool& pool, size_t expectedSize, bool keepPayload) {
+    expected = expectedSize;
+    keep = keepPayload;
+    buffer = pool.acquire(keep ? std::min(expectedSize, MAX_PRESIZE) : 0);
+    receivedBytes = 0;
+    nextChunk = 0;
+    currentState = State::Incomplete;
+    errorMessage.clear();
+}
+
+ResponseAssembler::State ResponseAssembler::feed(const Packet& pkt) {
+    if (currentState == State::Complete) {
+        // A stray chunk after the final one; the request is already done.
+        return currentState;
+    }
+
+    uint16_t index = pkt.chunkIndex();
+    if (index == nextChunk) {
+        if (currentState != State::Corrupt) {
+            if (keep) buffer.insert(buffer.end(), pkt.payload.begin(), pkt.payload.end());
+            receivedBytes += pkt.payload.size();
+        }
+        nextChunk = (nextChunk + 1) & 0x7FFF;
+    } else if (((nextChunk - index) & 0x7FFF) < 0x4000) {
+        // Behind the expected index: the device repeated a chunk.
+        currentState = State::Corrupt;
+        errorMessage = "Duplicate chunk " + std::to_string(index) + ", expected " + std::to_string(nextChunk);
+    } else {
+        currentState = State::Corrupt;
+        errorMessage = "Missing chunk(s) " + std::to_string(nextChunk) + " to " + std::to_string(index - 1);
+        nextChunk = (index + 1) & 0x7FFF;
+    }
+
+    if (!pkt.hasMoreData() && currentState != State::Corrupt) {
+        currentState = State::Complete;
+    }
+    return currentState;
+}
+
+std::vector<uint8_t> ResponseAssembler::take() {
+    return std::move(buffer);
+}
+
+} // namespace Pixl
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "PixlProtocol.h"
+
+namespace Pixl {
+
+// Keeps payload buffers alive between responses so their capacity is reused
+// instead of being reallocated for every listing or file read.
+class BufferPool {
+public:
+    explicit BufferPool(size_t maxPooled = 4) : maxPooled(maxPooled) {}
+
+    std::vector<uint8_t> acquire(size_t reserve = 0);
+    void release(std::vector<uint8_t>&& buffer);
+
+private:
+    size_t maxPooled;
+    std::vector<std::vector<uint8_t>> freeBuffers;
+};
+
+// Reassembles the chunks of a single multi-packet response. One assembler is
+// owned by each outstanding request; chunks must arrive with consecutive
+// chunk indices starting at 0, otherwise the response is flagged as corrupt.
+class ResponseAssembler {
+public:
+    enum class State { Incomplete, Complete, Corrupt };
+
+    // Upper bound for pre-sizing, so a bogus size from a listing can't make us
+    // reserve an absurd amount of memory.
+    static constexpr size_t MAX_PRESIZE = 16 * 1024 * 1024;
+
+    // With keepPayload false chunks are only checked and counted, for
+    // responses whose chunks are consumed as they arrive.
+    void begin(BufferPool& pool, size_t expectedSize = 0, bool keepPayload = true);
+    State feed(const Packet& pkt);
+
+    State state() const { return currentState; }
+    const std::string& error() const { return errorMessage; }
+    size_t expectedSize() const { return expected; }
+    size_t size() const { return buffer.size(); }
+    size_t received() const { return receivedBytes; }
+
+    // Moves the assembled payload out. Hand it back to the pool when done.
+    std::vector<uint8_t> take();
+
+private:
+    std::vector<uint8_t> buffer;
+    size_t expected = 0;
+    size_t receivedBytes = 0;
+    bool keep = true;
+    uint16_t nextChunk = 0;
+    State currentState = State::Incomplete;
+    std::string errorMessage;
+};
+
+} // namespace Pixl
@@ -0,0 +1,434 @@
+#include "ArchiveReader.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t ZIP_LOCAL_HEADER = 0x04034b50;
+constexpr uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+constexpr uint32_t ZIP_END_OF_DIRECTORY = 0x06054b50;
+constexpr size_t TAR_BLOCK = 512;
+constexpr size_t IO_BLOCK = 64 * 1024;
+
+uint16_t le16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t le32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+std::string fieldString(const uint8_t* p, size_t size) {
+    size_t n = 0;
+    while (n < size && p[n] != 0) ++n;
+    return std::string(reinterpret_cast<const char*>(p), n);
+}
+
+// Tar numbers are octal text, or big-endian binary when the top bit is set
+uint64_t tarNumber(const uint8_t* p, size_t size) {
+    uint64_t value = 0;
+    if (p[0] & 0x80) {
+        for (size_t i = 1; i < size; ++i) value = (value << 8) | p[i];
+        return value;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        if (p[i] >= '0' && p[i] <= '7') value = (value << 3) | (p[i] - '0');
+        else if (p[i] != ' ' || value != 0) break;
+    }
+    return value;
+}
+
+bool tarChecksumOk(const uint8_t* header) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK; ++i) {
+        sum += (i >= 148 && i < 156) ? ' ' : header[i];
+    }
+    return sum == tarNumber(header + 148, 8);
+}
+
+// Makes an entry path relative and '/' separated. False for anything that
+// would land outside the target folder.
+bool normalizePath(std::string& path) {
+    std::replace(path.begin(), path.end(), '\\', '/');
+    std::string result;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) end = path.size();
+        std::string part = path.substr(start, end - start);
+        if (part == "..") return false;
+        if (!part.empty() && part != ".") {
+            if (!result.empty()) result += '/';
+            result += part;
+        }
+        start = end + 1;
+    }
+    path = result;
+    return !path.empty() && path.find(':') == std::string::npos;
+}
+
+} // namespace
+
+ArchiveReader::~ArchiveReader() {
+    close();
+}
+
+size_t ArchiveReader::extensionLength(const std::string& path) {
+    std::string lower(path);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (const char* ext : {".tar.gz", ".tgz", ".tar", ".zip"}) {
+        size_t n = std::strlen(ext);
+        if (lower.size() > n && lower.compare(lower.size() - n, n, ext) == 0) return n;
+    }
+    return 0;
+}
+
+bool ArchiveReader::open(const std::string& path) {
+    close();
+    archivePath = path;
+    file.open(path, std::ios::binary);
+    if (!file) return fail("Could not open " + path);
+    file.seekg(0, std::ios::end);
+    archiveSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    uint8_t magic[2] = {0, 0};
+    file.read(reinterpret_cast<char*>(magic), 2);
+    file.clear();
+    if (magic[0] == 0x1f && magic[1] == 0x8b) {
+        format = Format::TarGz;
+    } else if (magic[0] == 'P' && magic[1] == 'K') {
+        format = Format::Zip;
+    } else {
+        format = Format::Tar;
+    }
+    if (!(format == Format::Zip ? listZip() : listTar())) return false;
+    return list.empty() ? fail("No entries found in " + path) : true;
+}
+
+void ArchiveReader::close() {
+    endEntry();
+    if (gzActive) inflateEnd(&gz);
+    gzActive = false;
+    if (file.is_open()) file.close();
+    file.clear();
+    list.clear();
+    streamPos = 0;
+    archiveSize = 0;
+}
+
+bool ArchiveReader::fail(const std::string& message) {
+    errorMessage = message;
+    return false;
+}
+
+bool ArchiveReader::listZip() {
+    uint64_t fileSize = archiveSize;
+    if (fileSize < 22) return fail("Not a zip archive");
+
+    // The end of directory record sits behind an optional comment of up to 64 KiB
+    size_t tailSize = static_cast<size_t>(std::min<uint64_t>(fileSize, 0xFFFF + 22));
+    std::vector<uint8_t> tail(tailSize);
+    file.seekg(static_cast<std::streamoff>(fileSize - tailSize));
+    if (!file.read(reinterpret_cast<char*>(tail.data()), tailSize)) return fail("Could not read zip directory");
+
+    const uint8_t* eocd = nullptr;
+    for (size_t i = tailSize - 22 + 1; i-- > 0;) {
+        if (le32(tail.data() + i) == ZIP_END_OF_DIRECTORY) {
+            eocd = tail.data() + i;
+            break;
+        }
+    }
+    if (!eocd) return fail("Not a zip archive");
+
+    uint16_t count = le16(eocd + 10);
+    uint32_t directorySize = le32(eocd + 12);
+    uint32_t directoryOffset = le32(eocd + 16);
+    if (count == 0xFFFF || directoryOffset == 0xFFFFFFFF) return fail("Zip64 archives are not supported");
+    if (static_cast<uint64_t>(directoryOffset) + directorySize > fileSize) return fail("Corrupt zip directory");
+
+    std::vector<uint8_t> directory(directorySize);
+    file.seekg(directoryOffset);
+    if (!file.read(reinterpret_cast<char*>(directory.data()), directorySize)) return fail("Could not read zip directory");
+
+    size_t p = 0;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (p + 46 > directory.size() || le32(directory.data() + p) != ZIP_CENTRAL_HEADER) {
+            return fail("Corrupt zip directory");
+        }
+        const uint8_t* h = directory.data() + p;
+        uint16_t flags = le16(h + 8);
+        uint16_t nameLength = le16(h + 28);
+        size_t next = p + 46 + nameLength + le16(h + 30) + le16(h + 32);
+        if (next > directory.size()) return fail("Corrupt zip directory");
+
+        Entry entry;
+        entry.path.assign(reinterpret_cast<const char*>(h + 46), nameLength);
+        entry.folder = !entry.path.empty() && (entry.path.back() == '/' || entry.path.back() == '\\');
+        entry.method = le16(h + 10);
+        entry.crc = le32(h + 16);
+        entry.compressedSize = le32(h + 20);
+        entry.size = le32(h + 24);
+        entry.offset = le32(h + 42);
+        p = next;
+
+        if (!normalizePath(entry.path)) continue;
+        if (!entry.folder) {
+            if (flags & 0x1) return fail("Encrypted zip entries are not supported: " + entry.path);
+            if (entry.method != 0 && entry.method != 8) return fail("Unsupported compression in " + entry.path);
+        }
+        list.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool ArchiveReader::listTar() {
+    if (!rewind()) return false;
+
+    uint8_t header[TAR_BLOCK];
+    std::string longName;
+    while (true) {
+        // Running out before the end marker means the archive was cut short
+        if (!streamRead(header, TAR_BLOCK)) return fail(streamPos == 0 ? "Not a tar archive" : "Truncated archive");
+        if (std::all_of(header, header + TAR_BLOCK, [](uint8_t b) { return b == 0; })) break; // End marker
+        if (!tarChecksumOk(header)) {
+            return fail(list.empty() ? "Not a tar archive" : "Corrupt tar header after " + list.back().path);
+        }
+
+        uint64_t size = tarNumber(header + 124, 12);
+        uint64_t padded = (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+        char type = static_cast<char>(header[156]);
+
+        if (type == 'L' || type == 'x') {
+            // GNU long name, or a pax header that may carry the path
+            std::string data(static_cast<size_t>(size), '\0');
+            if (!streamRead(reinterpret_cast<uint8_t*>(&data[0]), data.size()) || !streamSkip(padded - size)) {
+                return fail("Truncated archive");
+            }
+            if (type == 'L') {
+                longName = data.c_str();
+                continue;
+            }
+            size_t pos = 0;
+            while (pos < data.size()) {
+                size_t space = data.find(' ', pos);
+                size_t length = std::strtoul(data.c_str() + pos, nullptr, 10);
+                if (space == std::string::npos || length == 0 || pos + length > data.size()) break;
+                std::string record = data.substr(space + 1, pos + length - space - 2);
+                if (record.compare(0, 5, "path=") == 0) longName = record.substr(5);
+                pos += length;
+            }
+            continue;
+        }
+
+        std::string path = longName;
+        longName.clear();
+        if (path.empty()) {
+            path = fieldString(header, 100);
+            std::string prefix = std::memcmp(header + 257, "ustar", 5) == 0 ? fieldString(header + 345, 155) : std::string();
+            if (!prefix.empty()) path = prefix + "/" + path;
+        }
+
+        Entry entry;
+        entry.folder = type == '5';
+        entry.size = entry.folder ? 0 : size;
+        entry.offset = streamPos;
+        bool regular = type == '0' || type == '\0' || type == '7';
+        if ((entry.folder || regular) && normalizePath(path)) {
+            entry.path = path;
+            list.push_back(std::move(entry));
+        }
+        if (!streamSkip(padded)) return fail("Truncated archive");
+    }
+    return true;
+}
+
+bool ArchiveReader::read(size_t index, std::vector<uint8_t>& out) {
+    out.clear();
+    if (!openEntry(index)) return false;
+    out.resize(static_cast<size_t>(list[index].size));
+    size_t done = 0;
+    while (true) {
+        int64_t n = readEntry(out.data() + done, out.size() - done);
+        if (n < 0) return false;
+        if (n == 0) return true;
+        done += static_cast<size_t>(n);
+    }
+}
+
+bool ArchiveReader::openEntry(size_t index) {
+    endEntry();
+    if (index >= list.size()) return fail("No such entry");
+    const Entry& entry = list[index];
+    entryIndex = index;
+    entryRemaining = entry.size;
+    entryCrc = crc32(0, nullptr, 0);
+    if (entry.folder) {
+        entryOpen = true;
+        return true;
+    }
+
+    if (format != Format::Zip) {
+        if (!streamSeek(entry.offset)) return fail("Truncated entry " + entry.path);
+        entryOpen = true;
+        return true;
+    }
+
+    uint8_t header[30];
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(entry.offset));
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || le32(header) != ZIP_LOCAL_HEADER) {
+        return fail("Corrupt local header for " + entry.path);
+    }
+    file.seekg(static_cast<std::streamoff>(entry.offset + 30 + le16(header + 26) + le16(header + 28)));
+    if (entry.method == 0) {
+        if (entry.compressedSize != entry.size) return fail("Truncated entry " + entry.path);
+    } else {
+        zip = z_stream{};
+        if (inflateInit2(&zip, -MAX_WBITS) != Z_OK) return fail("Could not start inflate");
+        zipActive = true;
+        zipEnded = false;
+        zipRemaining = entry.compressedSize;
+        zipInput.resize(IO_BLOCK);
+    }
+    entryOpen = true;
+    return true;
+}
+
+int64_t ArchiveReader::readEntry(uint8_t* data, size_t size) {
+    if (!entryOpen) {
+        fail("No entry open");
+        return -1;
+    }
+    const Entry& entry = list[entryIndex];
+
+    if (entryRemaining == 0) {
+        // Read through: a deflate stream must end here and the CRC must match
+        bool ok = true;
+        if (zipActive && !zipEnded) {
+            uint8_t spare = 0;
+            ok = inflateEntry(&spare, 1) == 0 && zipEnded;
+            if (!ok) fail("Corrupt data in " + entry.path);
+        }
+        if (ok && format == Format::Zip && !entry.folder && entryCrc != entry.crc) {
+            ok = fail("CRC mismatch in " + entry.path);
+        }
+        endEntry();
+        return ok ? 0 : -1;
+    }
+
+    size_t want = static_cast<size_t>(std::min<uint64_t>(size, entryRemaining));
+    if (want == 0) return 0;
+    bool ok;
+    if (format != Format::Zip) {
+        ok = streamRead(data, want) || fail("Truncated entry " + entry.path);
+    } else if (!zipActive) {
+        ok = file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(want)) ||
+             fail("Truncated entry " + entry.path);
+    } else {
+        ok = inflateEntry(data, want) == want || fail("Corrupt data in " + entry.path);
+    }
+    if (!ok) {
+        endEntry();
+        return -1;
+    }
+    if (format == Format::Zip) entryCrc = crc32(entryCrc, data, static_cast<uInt>(want));
+    entryRemaining -= want;
+    return static_cast<int64_t>(want);
+}
+
+size_t ArchiveReader::inflateEntry(uint8_t* data, size_t size) {
+    zip.next_out = data;
+    zip.avail_out = static_cast<uInt>(size);
+    while (zip.avail_out > 0 && !zipEnded) {
+        if (zip.avail_in == 0) {
+            size_t n = static_cast<size_t>(std::min<uint64_t>(zipRemaining, zipInput.size()));
+            if (n == 0 || !file.read(reinterpret_cast<char*>(zipInput.data()), n)) break;
+            zipRemaining -= n;
+            zip.next_in = zipInput.data();
+            zip.avail_in = static_cast<uInt>(n);
+        }
+        int result = inflate(&zip, Z_NO_FLUSH);
+        if (result == Z_STREAM_END) zipEnded = true;
+        else if (result != Z_OK) break;
+    }
+    return size - zip.avail_out;
+}
+
+void ArchiveReader::endEntry() {
+    if (zipActive) inflateEnd(&zip);
+    zipActive = false;
+    entryOpen = false;
+    entryRemaining = 0;
+}
+
+bool ArchiveReader::rewind() {
+    file.clear();
+    file.seekg(0);
+    streamPos = 0;
+    if (gzActive) inflateEnd(&gz);
+    gzActive = false;
+    if (format != Format::TarGz) return true;
+
+    gz = z_stream{};
+    if (inflateInit2(&gz, 16 + MAX_WBITS) != Z_OK) return fail("Could not start gunzip");
+    gzActive = true;
+    gzInput.resize(IO_BLOCK);
+    return true;
+}
+
+bool ArchiveReader::streamRead(uint8_t* data, size_t size) {
+    if (format != Format::TarGz) {
+        if (!file.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(size))) return false;
+        streamPos += size;
+        return true;
+    }
+
+    gz.next_out = data;
+    gz.avail_out = static_cast<uInt>(size);
+    while (gz.avail_out > 0) {
+        if (gz.avail_in == 0) {
+            file.read(reinterpret_cast<char*>(gzInput.data()), static_cast<std::streamsize>(gzInput.size()));
+            std::streamsize n = file.gcount();
+            if (n <= 0) return false;
+            gz.next_in = gzInput.data();
+            gz.avail_in = static_cast<uInt>(n);
+        }
+        int result = inflate(&gz, Z_NO_FLUSH);
+        if (result == Z_STREAM_END && gz.avail_out > 0) return false;
+        if (result != Z_OK && result != Z_STREAM_END) return false;
+    }
+    streamPos += size;
+    return true;
+}
+
+bool ArchiveReader::streamSkip(uint64_t size) {
+    if (format != Format::TarGz) {
+        // seekg happily goes past the end, so check against the file size
+        if (streamPos + size > archiveSize) return false;
+        file.seekg(static_cast<std::streamoff>(size), std::ios::cur);
+        streamPos += size;
+        return static_cast<bool>(file);
+    }
+    std::vector<uint8_t> scratch(static_cast<size_t>(std::min<uint64_t>(size, IO_BLOCK)));
+    while (size > 0) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(size, scratch.size()));
+        if (!streamRead(scratch.data(), n)) return false;
+        size -= n;
+    }
+    return true;
+}
+
+bool ArchiveReader::streamSeek(uint64_t position) {
+    if (format != Format::TarGz) {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(position));
+        streamPos = position;
+        return static_cast<bool>(file);
+    }
+    // Going back means gunzipping from the start again
+    if (position < streamPos && !rewind()) return false;
+    return streamSkip(position - streamPos);
+}
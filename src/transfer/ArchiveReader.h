@@ -0,0 +1,90 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <zlib.h>
+
+// Reads the entries of a .zip, .tar, .tar.gz or .tgz without extracting it.
+// Zip entries are read directly through the central directory; tars are
+// read front to back, so entries are cheapest in archive order. Not thread
+// safe: one read at a time.
+class ArchiveReader {
+public:
+    struct Entry {
+        std::string path; // Relative, '/' separated, no trailing slash
+        bool folder = false;
+        uint64_t size = 0;
+
+        // Where the data is: local header offset for zip, position in the
+        // (decompressed) tar stream otherwise
+        uint64_t offset = 0;
+        uint64_t compressedSize = 0;
+        int method = 0; // Zip: 0 stored, 8 deflated
+        uint32_t crc = 0; // Zip only
+    };
+
+    ArchiveReader() = default;
+    ~ArchiveReader();
+    ArchiveReader(const ArchiveReader&) = delete;
+    ArchiveReader& operator=(const ArchiveReader&) = delete;
+
+    // Length of the archive extension of path (".tar.gz" is 7), 0 if it isn't one
+    static size_t extensionLength(const std::string& path);
+    static bool isArchive(const std::string& path) { return extensionLength(path) > 0; }
+
+    bool open(const std::string& path);
+    void close();
+    const std::vector<Entry>& entries() const { return list; }
+    // Zip records each entry's CRC-32; tar doesn't
+    bool hasCrc() const { return format == Format::Zip; }
+    const std::string& error() const { return errorMessage; }
+
+    // Decompresses one entry into out
+    bool read(size_t index, std::vector<uint8_t>& out);
+
+    // Streams one entry in pieces instead: openEntry, then readEntry until
+    // it returns 0. A zip entry's CRC is checked once it has been read through.
+    bool openEntry(size_t index);
+    // Up to size bytes of the open entry; 0 at its end, -1 on error
+    int64_t readEntry(uint8_t* data, size_t size);
+
+private:
+    enum class Format { Zip, Tar, TarGz };
+
+    bool fail(const std::string& message);
+    bool listZip();
+    bool listTar();
+    size_t inflateEntry(uint8_t* data, size_t size);
+    void endEntry();
+
+    // Positioned reads over the tar stream, gunzipped on the fly if needed
+    bool rewind();
+    bool streamRead(uint8_t* data, size_t size);
+    bool streamSkip(uint64_t size);
+    bool streamSeek(uint64_t position);
+
+    std::string archivePath;
+    std::ifstream file;
+    uint64_t archiveSize = 0;
+    Format format = Format::Zip;
+    std::vector<Entry> list;
+    std::string errorMessage;
+
+    z_stream gz{};
+    bool gzActive = false;
+    std::vector<uint8_t> gzInput;
+    uint64_t streamPos = 0;
+
+    // The entry being streamed
+    bool entryOpen = false;
+    size_t entryIndex = 0;
+    uint64_t entryRemaining = 0;
+    uint32_t entryCrc = 0;
+    z_stream zip{};
+    bool zipActive = false;
+    bool zipEnded = false;
+    uint64_t zipRemaining = 0; // Compressed bytes not yet fed to inflate
+    std::vector<uint8_t> zipInput;
+};
@@ -0,0 +1,58 @@
+#include "ChunkPipe.h"
+#include <algorithm>
+
+void ChunkPipe::beginStream() {
+    queue.emplace_back();
+}
+
+void ChunkPipe::push(const uint8_t *data, size_t size) {
+    if (queue.empty() || queue.back().finished) return;
+    Stream &stream = queue.back();
+    stream.data.insert(stream.data.end(), data, data + size);
+    buffered += size;
+    peak = std::max(peak, buffered);
+}
+
+void ChunkPipe::finish(bool ok) {
+    if (queue.empty() || queue.back().finished) return;
+    queue.back().finished = true;
+    queue.back().ok = ok;
+}
+
+bool ChunkPipe::take(std::vector<uint8_t> &out, size_t maxSize) {
+    if (queue.empty()) return false;
+    Stream &stream = queue.front();
+    size_t available = stream.data.size() - stream.readPos;
+    if (available == 0 || (available < maxSize && !stream.finished)) return false;
+
+    size_t n = std::min(available, maxSize);
+    out.assign(stream.data.begin() + stream.readPos, stream.data.begin() + stream.readPos + n);
+    stream.readPos += n;
+    buffered -= n;
+
+    // Drop what the writer has consumed once it outweighs what is left
+    if (stream.readPos > stream.data.size() / 2) {
+        stream.data.erase(stream.data.begin(), stream.data.begin() + stream.readPos);
+        stream.readPos = 0;
+    }
+    return true;
+}
+
+bool ChunkPipe::frontDrained() const {
+    return !queue.empty() && queue.front().finished && queue.front().readPos == queue.front().data.size();
+}
+
+bool ChunkPipe::frontOk() const {
+    return !queue.empty() && queue.front().ok;
+}
+
+void ChunkPipe::popStream() {
+    if (queue.empty()) return;
+    buffered -= queue.front().data.size() - queue.front().readPos;
+    queue.pop_front();
+}
+
+void ChunkPipe::clear() {
+    queue.clear();
+    buffered = 0;
+}
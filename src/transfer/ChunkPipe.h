@@ -0,0 +1,49 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Bounded in-memory buffer between a reader on one link and a writer on
+// another. It holds a queue of streams, one per file, drained in the order
+// the reader opened them. A ReadFile can't be paused once it is running, so
+// the bound is enforced between files: the reader only starts the next one
+// while the pipe has room.
+class ChunkPipe {
+public:
+    explicit ChunkPipe(size_t capacity) : cap(capacity) {}
+
+    // Reader side; push and finish apply to the newest stream
+    void beginStream();
+    void push(const uint8_t *data, size_t size);
+    void finish(bool ok);
+
+    // Writer side. Moves up to maxSize bytes of the oldest stream into out.
+    // A chunk shorter than maxSize only comes at the end of a finished stream.
+    bool take(std::vector<uint8_t> &out, size_t maxSize);
+    // The oldest stream is finished and everything in it was taken
+    bool frontDrained() const;
+    bool frontOk() const;
+    void popStream();
+
+    bool hasRoom() const { return buffered < cap; }
+    size_t size() const { return buffered; }
+    size_t capacity() const { return cap; }
+    size_t highWater() const { return peak; }
+    size_t streams() const { return queue.size(); }
+    void clear();
+
+private:
+    struct Stream {
+        std::vector<uint8_t> data;
+        size_t readPos = 0;
+        bool finished = false;
+        bool ok = true;
+    };
+
+    std::deque<Stream> queue;
+    size_t cap;
+    size_t buffered = 0;
+    size_t peak = 0;
+};
@@ -0,0 +1,231 @@
+#include "FolderMirror.h"
+#include <QDebug>
+#include <QDir>
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSet>
+#include <algorithm>
+
+FolderMirror::FolderMirror() {
+    debounce.setSingleShot(true);
+    QObject::connect(&debounce, &QTimer::timeout, &watcher, [this]() {
+        if (!isRunning()) return;
+        dirty = true;
+        if (onChanged) onChanged();
+    });
+    // Every event restarts the wait, so a burst of saves is one pass
+    auto changed = [this](const QString&) { debounce.start(DEBOUNCE_MS); };
+    QObject::connect(&watcher, &QFileSystemWatcher::directoryChanged, &watcher, changed);
+    QObject::connect(&watcher, &QFileSystemWatcher::fileChanged, &watcher, changed);
+    poll.setInterval(POLL_MS);
+    QObject::connect(&poll, &QTimer::timeout, &watcher, [this]() { rescan(); });
+}
+
+void FolderMirror::start(const QString& root, const Tree& device) {
+    stop();
+    rootPath = QDir(root).absolutePath();
+    synced = device;
+    poll.start();
+    rescan();
+}
+
+void FolderMirror::stop() {
+    rootPath.clear();
+    synced.clear();
+    dirty = false;
+    debounce.stop();
+    poll.stop();
+    QStringList watched = watcher.files() + watcher.directories();
+    if (!watched.isEmpty()) watcher.removePaths(watched);
+}
+
+void FolderMirror::rescan(int delayMs) {
+    if (!isRunning()) return;
+    if (delayMs > 0) {
+        debounce.start(delayMs);
+        return;
+    }
+    debounce.stop();
+    dirty = true;
+    if (onChanged) onChanged();
+}
+
+FolderMirror::Tree FolderMirror::scan() {
+    Tree tree;
+    QDir root(rootPath);
+    QDirIterator it(rootPath, QDir::AllEntries | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        Node node;
+        node.folder = info.isDir();
+        if (!node.folder) {
+            node.size = info.size();
+            node.mtime = info.lastModified().toMSecsSinceEpoch();
+        }
+        tree.insert(root.relativeFilePath(info.filePath()), node);
+    }
+    return tree;
+}
+
+void FolderMirror::watch(const Tree& tree) {
+    QDir root(rootPath);
+    QSet<QString> wanted{rootPath};
+    for (auto it = tree.constBegin(); it != tree.constEnd(); ++it) wanted.insert(root.filePath(it.key()));
+
+    QStringList watched = watcher.files() + watcher.directories();
+    QStringList gone;
+    for (const QString& path : watched) {
+        if (!wanted.remove(path)) gone << path;
+    }
+    if (!gone.isEmpty()) watcher.removePaths(gone);
+    if (wanted.isEmpty()) return;
+    QStringList refused = watcher.addPaths(QStringList(wanted.begin(), wanted.end()));
+    if (!refused.isEmpty()) {
+        qDebug() << "Mirror: could not watch" << refused.size() << "path(s), polling picks up their changes";
+    }
+}
+
+QStringList FolderMirror::subtree(const Tree& tree, const QString& folder) {
+    QStringList children;
+    QString prefix = folder + "/";
+    for (auto it = tree.constBegin(); it != tree.constEnd(); ++it) {
+        if (it.key().startsWith(prefix)) children << it.key().mid(prefix.size());
+    }
+    children.sort();
+    return children;
+}
+
+std::vector<FolderMirror::Change> FolderMirror::changes() {
+    dirty = false;
+    if (!isRunning()) return {};
+    Tree current = scan();
+    watch(current);
+
+    QSet<QString> removed, added;
+    std::vector<Change> uploads;
+    for (auto it = synced.begin(); it != synced.end(); ++it) {
+        auto cur = current.constFind(it.key());
+        if (cur == current.constEnd() || cur->folder != it->folder) {
+            removed.insert(it.key());
+        } else if (!it->folder) {
+            // Listed from the device: a matching size is taken as the same file
+            if (it->mtime < 0 && cur->size == it->size) {
+                it->mtime = cur->mtime;
+            } else if (cur->size != it->size || cur->mtime != it->mtime) {
+                uploads.push_back({Change::Upload, it.key(), QString(), *cur});
+            }
+        }
+    }
+    for (auto it = current.constBegin(); it != current.constEnd(); ++it) {
+        auto old = synced.constFind(it.key());
+        if (old == synced.constEnd() || old->folder != it->folder) added.insert(it.key());
+    }
+
+    auto same = [](const Node& a, const Node& b) {
+        return a.folder == b.folder && a.size == b.size && (a.mtime < 0 || a.mtime == b.mtime);
+    };
+    auto topmost = [](const QSet<QString>& set, const Tree& tree) {
+        QStringList result;
+        for (const QString& path : set) {
+            int slash = path.lastIndexOf('/');
+            if (tree.value(path).folder && (slash < 0 || !set.contains(path.left(slash)))) result << path;
+        }
+        result.sort();
+        return result;
+    };
+
+    // A folder that vanished while one with the same contents appeared was
+    // renamed or moved: one Rename instead of a delete and a full upload
+    std::vector<Change> renames;
+    for (const QString& from : topmost(removed, synced)) {
+        QStringList contents = subtree(synced, from);
+        for (const QString& to : topmost(added, current)) {
+            if (!added.contains(to) || subtree(current, to) != contents) continue;
+            bool match = std::all_of(contents.begin(), contents.end(), [&](const QString& child) {
+                return same(synced.value(from + "/" + child), current.value(to + "/" + child));
+            });
+            if (!match) continue;
+            renames.push_back({Change::Rename, to, from, current.value(to)});
+            removed.remove(from);
+            added.remove(to);
+            for (const QString& child : contents) {
+                removed.remove(from + "/" + child);
+                added.remove(to + "/" + child);
+            }
+            break;
+        }
+    }
+    // Likewise a file with the same size and time under another name
+    for (const QString& from : QStringList(removed.begin(), removed.end())) {
+        const Node& old = synced[from];
+        if (old.folder || old.mtime < 0) continue;
+        for (const QString& to : added) {
+            if (!current[to].folder && same(old, current[to])) {
+                renames.push_back({Change::Rename, to, from, current[to]});
+                removed.remove(from);
+                added.remove(to);
+                break;
+            }
+        }
+    }
+
+    auto depth = [](const QString& path) { return path.count('/'); };
+    auto byDepth = [&](QStringList paths, bool deepestFirst) {
+        std::sort(paths.begin(), paths.end(), [&](const QString& a, const QString& b) {
+            return deepestFirst ? depth(a) > depth(b) : depth(a) < depth(b);
+        });
+        return paths;
+    };
+
+    std::vector<Change> result;
+    // Something that turned from a file into a folder (or back) has to go first
+    QStringList replaced;
+    for (const QString& path : removed) {
+        if (added.contains(path)) replaced << path;
+    }
+    for (const QString& path : byDepth(replaced, true)) {
+        result.push_back({Change::Remove, path, QString(), synced.value(path)});
+        removed.remove(path);
+    }
+    for (const QString& path : byDepth(QStringList(added.begin(), added.end()), false)) {
+        if (current[path].folder) result.push_back({Change::CreateFolder, path, QString(), current[path]});
+    }
+    result.insert(result.end(), renames.begin(), renames.end());
+    for (const QString& path : added) {
+        if (!current[path].folder) uploads.push_back({Change::Upload, path, QString(), current[path]});
+    }
+    result.insert(result.end(), uploads.begin(), uploads.end());
+    // Removals last, so nothing is gone from the device before its replacement is there
+    for (const QString& path : byDepth(QStringList(removed.begin(), removed.end()), true)) {
+        result.push_back({Change::Remove, path, QString(), synced.value(path)});
+    }
+    return result;
+}
+
+void FolderMirror::applied(const Change& change, bool ok) {
+    if (!isRunning()) return;
+    if (!ok) {
+        rescan(RETRY_MS);
+        return;
+    }
+    switch (change.type) {
+        case Change::Rename: {
+            for (const QString& child : subtree(synced, change.from)) {
+                synced.insert(change.path + "/" + child, synced.take(change.from + "/" + child));
+            }
+            synced.remove(change.from);
+            synced.insert(change.path, change.node);
+            break;
+        }
+        case Change::Remove:
+            for (const QString& child : subtree(synced, change.path)) synced.remove(change.path + "/" + child);
+            synced.remove(change.path);
+            break;
+        case Change::CreateFolder:
+        case Change::Upload:
+            synced.insert(change.path, change.node);
+            break;
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QString>
+#include <QTimer>
+#include <functional>
+#include <vector>
+
+// Watches a local folder tree and works out what has to change on the
+// device to match it. Change events are debounced, then the tree is
+// rescanned and compared with the state last pushed, so a burst of saves
+// collapses into one pass and only what differs goes out. Changes that
+// fail stay pending and are retried; while the device is away nothing is
+// lost, the next pass just has more to do.
+class FolderMirror {
+public:
+    static constexpr int DEBOUNCE_MS = 1500;
+    static constexpr int RETRY_MS = 10000;
+    // Directory watches miss edits inside files on some platforms, and the
+    // OS may refuse more watches, so the tree is also rescanned now and then
+    static constexpr int POLL_MS = 30000;
+
+    struct Node {
+        bool folder = false;
+        qint64 size = 0;
+        qint64 mtime = -1; // ms since the epoch; -1 if unknown (listed from the device)
+    };
+    using Tree = QHash<QString, Node>; // By path relative to the root, '/' separated
+
+    struct Change {
+        enum Type { Rename, Remove, CreateFolder, Upload };
+        Type type;
+        QString path;
+        QString from; // Rename only
+        Node node;    // What the device holds once it is applied
+    };
+
+    FolderMirror();
+
+    // Starts watching root. synced is what the device already holds under
+    // the mirror target; files whose size matches it are not sent again.
+    void start(const QString& root, const Tree& synced);
+    void stop();
+    bool isRunning() const { return !rootPath.isEmpty(); }
+    const QString& root() const { return rootPath; }
+
+    // Called once changes have settled; take them with changes()
+    void setChangedCallback(std::function<void()> callback) { onChanged = std::move(callback); }
+    bool isDirty() const { return dirty; }
+    // Marks the tree dirty after delayMs, e.g. to retry after a failure
+    void rescan(int delayMs = 0);
+
+    // Rescans the tree and returns what differs from the synced state, in
+    // the order it has to be applied: removals of paths that changed between
+    // file and folder, new folders parents first, renames, uploads, and the
+    // other removals deepest first last, so nothing disappears from the
+    // device before its replacement exists
+    std::vector<Change> changes();
+    // Records the outcome of one change; failed ones come back next pass
+    void applied(const Change& change, bool ok);
+
+private:
+    Tree scan();
+    void watch(const Tree& tree);
+    static QStringList subtree(const Tree& tree, const QString& folder);
+
+    QString rootPath;
+    Tree synced;
+    bool dirty = false;
+    QFileSystemWatcher watcher;
+    QTimer debounce;
+    QTimer poll;
+    std::function<void()> onChanged;
+};
@@ -0,0 +1,83 @@
+#include "HashIndex.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <zlib.h>
+
+HashIndex::HashIndex(const QString &file) : fileName(file) {
+    QFile in(fileName);
+    if (!in.open(QIODevice::ReadOnly)) return;
+    QJsonObject object = QJsonDocument::fromJson(in.readAll()).object();
+    for (auto it = object.constBegin(); it != object.constEnd() && entries.size() < MAX_ENTRIES; ++it) {
+        QJsonArray value = it.value().toArray();
+        if (value.size() != 3) continue;
+        entries.insert(it.key(), {static_cast<qint64>(value[0].toDouble()), static_cast<qint64>(value[1].toDouble()),
+                                  static_cast<uint32_t>(value[2].toDouble())});
+    }
+}
+
+HashIndex::~HashIndex() {
+    save();
+}
+
+bool HashIndex::lookup(const QString &path, qint64 size, qint64 mtime, uint32_t *crc) const {
+    auto it = entries.constFind(path);
+    if (it == entries.constEnd() || it->size != size || it->mtime != mtime) return false;
+    *crc = it->crc;
+    return true;
+}
+
+void HashIndex::store(const QString &path, qint64 size, qint64 mtime, uint32_t crc) {
+    if (entries.size() >= MAX_ENTRIES && !entries.contains(path)) entries.erase(entries.begin());
+    entries.insert(path, {size, mtime, crc});
+    dirty = true;
+}
+
+void HashIndex::save() {
+    if (!dirty) return;
+    QJsonObject object;
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        object.insert(it.key(), QJsonArray{static_cast<double>(it->size), static_cast<double>(it->mtime),
+                                           static_cast<double>(it->crc)});
+    }
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile out(fileName);
+    if (!out.open(QIODevice::WriteOnly) || out.write(QJsonDocument(object).toJson(QJsonDocument::Compact)) < 0 ||
+        !out.commit()) {
+        qDebug() << "Could not save the hash index to" << fileName;
+        return;
+    }
+    dirty = false;
+}
+
+uint32_t HashIndex::update(uint32_t crc, const uint8_t *data, size_t size) {
+    return static_cast<uint32_t>(crc32_z(crc, data, size));
+}
+
+bool HashIndex::hashFile(const QString &path, uint32_t *crc) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    uint32_t result = static_cast<uint32_t>(crc32_z(0, nullptr, 0));
+    qint64 size = file.size();
+    if (size > 0) {
+        if (uchar *mapped = file.map(0, size)) {
+            result = update(result, mapped, static_cast<size_t>(size));
+            file.unmap(mapped);
+            *crc = result;
+            return true;
+        }
+    }
+    QByteArray block(static_cast<int>(READ_BLOCK), Qt::Uninitialized);
+    qint64 n;
+    while ((n = file.read(block.data(), READ_BLOCK)) > 0) {
+        result = update(result, reinterpret_cast<const uint8_t *>(block.constData()), static_cast<size_t>(n));
+    }
+    if (n < 0) return false;
+    *crc = result;
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <cstdint>
+
+// CRC-32s of local files, kept across sessions and trusted while a file's
+// size and modification time are unchanged, so verifying the same source
+// tree again reads nothing locally.
+class HashIndex {
+public:
+    static constexpr int MAX_ENTRIES = 100000;
+    static constexpr qint64 READ_BLOCK = 1024 * 1024;
+
+    explicit HashIndex(const QString &file);
+    ~HashIndex();
+
+    bool lookup(const QString &path, qint64 size, qint64 mtime, uint32_t *crc) const;
+    void store(const QString &path, qint64 size, qint64 mtime, uint32_t crc);
+    void save();
+
+    // CRC-32 of a whole file, mapped where possible. Thread safe, meant for
+    // the thread pool. Uses zlib's crc32, which works on several words at a
+    // time (and with carry-less multiply in zlib-ng builds).
+    static bool hashFile(const QString &path, uint32_t *crc);
+    static uint32_t update(uint32_t crc, const uint8_t *data, size_t size);
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 mtime;
+        uint32_t crc;
+    };
+
+    QString fileName;
+    QHash<QString, Entry> entries;
+    bool dirty = false;
+};
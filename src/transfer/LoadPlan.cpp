@@ -0,0 +1,162 @@
+#include "LoadPlan.h"
+#include "HashIndex.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QtConcurrent>
+#include <algorithm>
+
+LoadPlan LoadPlan::build(const QString& source) {
+    LoadPlan plan;
+    plan.sourceDir = QDir(source).absolutePath();
+    plan.created = QDateTime::currentDateTime();
+    QDir root(plan.sourceDir);
+    if (!root.exists()) {
+        plan.errorMessage = QString("%1 does not exist").arg(source);
+        return plan;
+    }
+
+    std::vector<Item> folders;
+    std::vector<Item> files;
+    QDirIterator it(plan.sourceDir, QDir::AllEntries | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        Item item;
+        item.path = root.relativeFilePath(info.filePath());
+        item.folder = info.isDir();
+        if (!item.folder) {
+            item.size = info.size();
+            item.mtime = info.lastModified().toMSecsSinceEpoch();
+        }
+        (item.folder ? folders : files).push_back(item);
+    }
+
+    auto parentOf = [](const QString& path) { return path.section('/', 0, -2); };
+    std::sort(folders.begin(), folders.end(), [](const Item& a, const Item& b) {
+        int da = a.path.count('/'), db = b.path.count('/');
+        return da != db ? da < db : a.path < b.path;
+    });
+    std::sort(files.begin(), files.end(), [&](const Item& a, const Item& b) {
+        QString pa = parentOf(a.path), pb = parentOf(b.path);
+        return pa != pb ? pa < pb : a.path < b.path;
+    });
+
+    struct Hash {
+        bool ok;
+        uint32_t crc;
+    };
+    QStringList paths;
+    for (const auto& file : files) paths << root.filePath(file.path);
+    QList<Hash> hashes = QtConcurrent::blockingMapped<QList<Hash>>(paths, [](const QString& path) {
+        Hash hash{false, 0};
+        hash.ok = HashIndex::hashFile(path, &hash.crc);
+        return hash;
+    });
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!hashes[static_cast<int>(i)].ok) {
+            plan.errorMessage = QString("Could not read %1").arg(paths[static_cast<int>(i)]);
+            return plan;
+        }
+        files[i].crc = hashes[static_cast<int>(i)].crc;
+        // Edited while it was being hashed: the CRC may be of either version
+        QFileInfo info(paths[static_cast<int>(i)]);
+        if (info.size() != files[i].size || info.lastModified().toMSecsSinceEpoch() != files[i].mtime) {
+            plan.errorMessage = QString("%1 changed while it was being hashed").arg(paths[static_cast<int>(i)]);
+            return plan;
+        }
+    }
+
+    plan.list = std::move(folders);
+    plan.list.insert(plan.list.end(), files.begin(), files.end());
+    plan.valid = true;
+    return plan;
+}
+
+qint64 LoadPlan::totalBytes() const {
+    qint64 total = 0;
+    for (const auto& item : list) total += item.size;
+    return total;
+}
+
+int LoadPlan::fileCount() const {
+    return static_cast<int>(std::count_if(list.begin(), list.end(), [](const Item& item) { return !item.folder; }));
+}
+
+QStringList LoadPlan::changedFiles() const {
+    QStringList changed;
+    QDir root(sourceDir);
+    for (const auto& item : list) {
+        if (item.folder) continue;
+        QFileInfo info(root.filePath(item.path));
+        if (!info.isFile() || info.size() != item.size || info.lastModified().toMSecsSinceEpoch() != item.mtime) {
+            changed << item.path;
+        }
+    }
+    return changed;
+}
+
+bool LoadPlan::save(const QString& file, QString* error) const {
+    QJsonArray items;
+    for (const auto& item : list) {
+        QJsonObject entry{{"path", item.path}};
+        if (item.folder) {
+            entry.insert("folder", true);
+        } else {
+            entry.insert("size", static_cast<double>(item.size));
+            entry.insert("mtime", static_cast<double>(item.mtime));
+            entry.insert("crc", static_cast<double>(item.crc));
+        }
+        items.append(entry);
+    }
+    QJsonObject root{
+        {"version", VERSION},
+        {"source", sourceDir},
+        {"created", created.toString(Qt::ISODate)},
+        {"items", items},
+    };
+    QSaveFile out(file);
+    if (!out.open(QIODevice::WriteOnly) || out.write(QJsonDocument(root).toJson()) < 0 || !out.commit()) {
+        if (error) *error = out.errorString();
+        return false;
+    }
+    return true;
+}
+
+LoadPlan LoadPlan::load(const QString& file, QString* error) {
+    LoadPlan plan;
+    QFile in(file);
+    if (!in.open(QIODevice::ReadOnly)) {
+        if (error) *error = in.errorString();
+        return plan;
+    }
+    QJsonObject root = QJsonDocument::fromJson(in.readAll()).object();
+    if (root.value("version").toInt() != VERSION) {
+        if (error) *error = "Not a load plan, or one from another version";
+        return plan;
+    }
+    plan.sourceDir = root.value("source").toString();
+    plan.created = QDateTime::fromString(root.value("created").toString(), Qt::ISODate);
+    for (const QJsonValue& value : root.value("items").toArray()) {
+        QJsonObject entry = value.toObject();
+        Item item;
+        item.path = entry.value("path").toString();
+        item.folder = entry.value("folder").toBool();
+        item.size = static_cast<qint64>(entry.value("size").toDouble());
+        item.mtime = static_cast<qint64>(entry.value("mtime").toDouble());
+        item.crc = static_cast<uint32_t>(entry.value("crc").toDouble());
+        // Same rule as archive entries: nothing may point outside the drive
+        if (item.path.isEmpty() || item.path.split('/').contains("..")) {
+            if (error) *error = QString("Bad path in plan: %1").arg(item.path);
+            return plan;
+        }
+        plan.list.push_back(item);
+    }
+    plan.valid = true;
+    return plan;
+}
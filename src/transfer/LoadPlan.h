@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include <vector>
+#include <cstdint>
+
+// A content set ready to be loaded onto freshly formatted drives: every
+// folder and file of a source tree in load order, with sizes and CRC-32s,
+// worked out once and saved, so provisioning a device doesn't walk or
+// hash the tree again. Folders come first, parents before children, so
+// they go out as one burst; files follow folder by folder.
+class LoadPlan {
+public:
+    static constexpr int VERSION = 1;
+
+    struct Item {
+        QString path; // Relative to the source, '/' separated
+        bool folder = false;
+        qint64 size = 0;
+        qint64 mtime = 0; // ms since the epoch, when the plan was built
+        uint32_t crc = 0;
+    };
+
+    // Walks and hashes source (files in parallel on the thread pool).
+    // Blocks, so run it off the GUI thread. Invalid if a file can't be read.
+    static LoadPlan build(const QString& source);
+
+    bool save(const QString& file, QString* error) const;
+    static LoadPlan load(const QString& file, QString* error);
+
+    bool isValid() const { return valid; }
+    const QString& error() const { return errorMessage; }
+    const QString& source() const { return sourceDir; }
+    const std::vector<Item>& items() const { return list; }
+    qint64 totalBytes() const;
+    int fileCount() const;
+
+    // Source files whose size or modification time no longer matches the
+    // plan, so its CRCs may not describe them
+    QStringList changedFiles() const;
+
+private:
+    QString sourceDir;
+    QDateTime created;
+    std::vector<Item> list;
+    bool valid = false;
+    QString errorMessage;
+};
@@ -0,0 +1,63 @@
+#include "StartupReport.h"
+#include "../common/Tracer.h"
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct Mark {
+    const char* name;
+    int64_t us;
+};
+
+std::mutex marksMutex;
+std::vector<Mark> marks;
+
+} // namespace
+
+void StartupReport::mark(const char* name) {
+    int64_t now = Tracer::now();
+    int64_t previous = 0;
+    {
+        std::lock_guard<std::mutex> lock(marksMutex);
+        if (!marks.empty()) previous = marks.back().us;
+        marks.push_back({name, now});
+    }
+    if (Tracer::enabled()) {
+        Tracer::complete(name, "startup", previous, now - previous);
+    }
+}
+
+std::string StartupReport::summary() {
+    std::lock_guard<std::mutex> lock(marksMutex);
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    int64_t previous = 0;
+    for (const auto& m : marks) {
+        out << m.name << " +" << (m.us - previous) / 1000.0 << " ms (" << m.us / 1000.0 << " ms)\n";
+        previous = m.us;
+    }
+    return out.str();
+}
+
+bool StartupReport::writeJson(const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+
+    std::lock_guard<std::mutex> lock(marksMutex);
+    out << "{\"marks\":[";
+    for (size_t i = 0; i < marks.size(); ++i) {
+        if (i) out << ',';
+        out << "{\"name\":\"" << marks[i].name << "\",\"us\":" << marks[i].us << '}';
+    }
+    out << "],\"totalUs\":" << (marks.empty() ? 0 : marks.back().us) << "}\n";
+    return static_cast<bool>(out);
+}
+
+int64_t StartupReport::totalUs() {
+    std::lock_guard<std::mutex> lock(marksMutex);
+    return marks.empty() ? 0 : marks.back().us;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Cold start milestones, measured on the trace clock (microseconds since
+// the process started). Each mark also becomes a span in a running trace,
+// covering the time since the previous mark. Safe to call from any thread.
+//
+// Names must be string literals.
+class StartupReport {
+public:
+    static void mark(const char* name);
+
+    // "name +12.3 ms (34.5 ms)" per line, in the order marked
+    static std::string summary();
+    // {"marks":[{"name":...,"us":...},...],"totalUs":...}
+    static bool writeJson(const std::string& path);
+    static int64_t totalUs();
+};
@@ -0,0 +1,187 @@
+#include "StreamCopy.h"
+
+StreamCopy::StreamCopy(Sender source, StreamReader reader, Sender destination, size_t pipeCapacity, size_t chunkSize)
+    : source(std::move(source)), reader(std::move(reader)), destination(std::move(destination)),
+      pipe(pipeCapacity), chunkSize(chunkSize) {}
+
+void StreamCopy::addFolder(const std::string& path) {
+    if (!adding) return;
+    writeQueue.push_back({true, std::string(), path, 0});
+    pumpWriter();
+}
+
+void StreamCopy::addFile(const std::string& from, const std::string& to, uint32_t size) {
+    if (!adding) return;
+    readQueue.push_back({false, from, to, size});
+    pumpReader();
+}
+
+void StreamCopy::finishAdding() {
+    adding = false;
+    checkFinished();
+}
+
+void StreamCopy::cancel() {
+    adding = false;
+    cancelled = true;
+    readQueue.clear();
+    pumpWriter();
+    checkFinished();
+}
+
+void StreamCopy::pumpReader() {
+    if (reading || readQueue.empty() || !pipe.hasRoom()) return;
+
+    Item item = readQueue.front();
+    readQueue.pop_front();
+    writeQueue.push_back(item);
+    pipe.beginStream();
+    reading = true;
+    readBytes = 0;
+    pumpWriter(); // Opens the destination while the source opens
+
+    auto payload = Pixl::Protocol::createOpenFilePayload(item.source, 0x08);
+    source(Pixl::Command::OpenFile, payload, [this, item](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+        if (corrupt || pkt.status != 0 || data.empty()) {
+            endRead(false);
+            return;
+        }
+        uint8_t fileId = data[0];
+        reader({fileId}, item.size,
+            [this](const std::vector<uint8_t>& bytes) {
+                readBytes += bytes.size();
+                pipe.push(bytes.data(), bytes.size());
+                pumpWriter();
+            },
+            [this, item, fileId](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                bool ok = !corrupt && pkt.status == 0 && (item.size == 0 || readBytes == item.size);
+                source(Pixl::Command::CloseFile, {fileId}, [this, ok](const Pixl::Packet&, const std::vector<uint8_t>&, bool) {
+                    endRead(ok);
+                });
+            });
+    });
+}
+
+void StreamCopy::endRead(bool ok) {
+    pipe.finish(ok);
+    reading = false;
+    pumpWriter();
+    pumpReader();
+}
+
+void StreamCopy::pumpWriter() {
+    while (!writing && !writeQueue.empty()) {
+        const Item& item = writeQueue.front();
+
+        if (item.folder) {
+            if (cancelled) {
+                writeQueue.pop_front();
+                continue;
+            }
+            writing = true;
+            destination(Pixl::Command::CreateFolder, Pixl::Protocol::createStringPayload(item.destination),
+                [this](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                    writing = false;
+                    Item done = writeQueue.front();
+                    writeQueue.pop_front();
+                    // 1 means the folder already exists, which is fine for a copy
+                    bool ok = !corrupt && (pkt.status == 0 || pkt.status == 1);
+                    if (ok) totals.folders++;
+                    completeItem(done.destination, ok);
+                    pumpWriter();
+                    checkFinished();
+                });
+            return;
+        }
+
+        if (!opened && !writeFailed) {
+            writing = true;
+            destination(Pixl::Command::OpenFile, Pixl::Protocol::createOpenFilePayload(item.destination, 0x16),
+                [this](const Pixl::Packet& pkt, const std::vector<uint8_t>& data, bool corrupt) {
+                    writing = false;
+                    if (corrupt || pkt.status != 0 || data.empty()) {
+                        writeFailed = true;
+                    } else {
+                        opened = true;
+                        writeFileId = data[0];
+                    }
+                    pumpWriter();
+                });
+            return;
+        }
+
+        while (pipe.take(chunk, chunkSize)) {
+            if (writeFailed) continue; // Nowhere to put it; drain so the reader isn't blocked
+            writePayload.clear();
+            writePayload.push_back(writeFileId);
+            writePayload.insert(writePayload.end(), chunk.begin(), chunk.end());
+            writing = true;
+            size_t size = chunk.size();
+            destination(Pixl::Command::WriteFile, writePayload,
+                [this, size](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                    writing = false;
+                    if (corrupt || pkt.status != 0) {
+                        writeFailed = true;
+                    } else {
+                        totals.bytes += size;
+                    }
+                    pumpWriter();
+                });
+            return;
+        }
+
+        if (!pipe.frontDrained()) return; // Waiting for the reader
+
+        bool ok = opened && !writeFailed && pipe.frontOk();
+        if (!opened) {
+            completeFile(false);
+            continue;
+        }
+        writing = true;
+        destination(Pixl::Command::CloseFile, {writeFileId},
+            [this, ok](const Pixl::Packet& pkt, const std::vector<uint8_t>&, bool corrupt) {
+                writing = false;
+                bool closed = ok && !corrupt && pkt.status == 0;
+                if (!closed) {
+                    // Don't leave a truncated copy behind
+                    std::string path = writeQueue.front().destination;
+                    writing = true;
+                    destination(Pixl::Command::Remove, Pixl::Protocol::createStringPayload(path),
+                        [this](const Pixl::Packet&, const std::vector<uint8_t>&, bool) {
+                            writing = false;
+                            completeFile(false);
+                            pumpWriter();
+                            checkFinished();
+                        });
+                    return;
+                }
+                completeFile(true);
+                pumpWriter();
+                checkFinished();
+            });
+        return;
+    }
+    checkFinished();
+}
+
+void StreamCopy::completeFile(bool ok) {
+    Item done = writeQueue.front();
+    writeQueue.pop_front();
+    pipe.popStream();
+    opened = false;
+    writeFailed = false;
+    if (ok) totals.files++;
+    completeItem(done.destination, ok);
+    pumpReader(); // The pipe has room again
+}
+
+void StreamCopy::completeItem(const std::string& path, bool ok) {
+    if (!ok) totals.failed++;
+    if (onItem) onItem(path, ok);
+}
+
+void StreamCopy::checkFinished() {
+    if (finished || adding || reading || writing || !readQueue.empty() || !writeQueue.empty()) return;
+    finished = true;
+    if (onFinished) onFinished(totals);
+}
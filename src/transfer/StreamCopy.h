@@ -0,0 +1,95 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "ChunkPipe.h"
+#include "../protocol/PixlProtocol.h"
+
+// Copies files from one Pixl link to another without staging them on disk.
+// Each file is read with a single streamed ReadFile on the source, and its
+// chunks go out as WriteFiles on the destination as soon as they arrive,
+// through a bounded ChunkPipe. While the destination is still writing one
+// file the source is already reading the next, so both links stay busy.
+//
+// Items are copied in the order they are added; a folder must be added
+// before anything inside it. All callbacks run on the caller's thread.
+class StreamCopy {
+public:
+    using Reply = std::function<void(const Pixl::Packet& pkt, const std::vector<uint8_t>& payload, bool corrupt)>;
+    using ChunkHandler = std::function<void(const std::vector<uint8_t>& data)>;
+    // Sends a command; reply gets its complete response
+    using Sender = std::function<void(Pixl::Command cmd, const std::vector<uint8_t>& payload, Reply reply)>;
+    // Sends a ReadFile whose chunks go to onChunk as they arrive; reply then
+    // only carries the final status
+    using StreamReader = std::function<void(const std::vector<uint8_t>& payload, uint32_t expectedSize,
+                                            ChunkHandler onChunk, Reply reply)>;
+
+    struct Result {
+        int files = 0;
+        int folders = 0;
+        int failed = 0;
+        uint64_t bytes = 0;
+    };
+    using ItemCallback = std::function<void(const std::string& destination, bool ok)>;
+    using FinishedCallback = std::function<void(const Result& result)>;
+
+    StreamCopy(Sender source, StreamReader reader, Sender destination, size_t pipeCapacity, size_t chunkSize);
+
+    void addFolder(const std::string& destination);
+    void addFile(const std::string& source, const std::string& destination, uint32_t size);
+    // Nothing more will be added; the finished callback fires once the queue drains
+    void finishAdding();
+    // Drops everything that hasn't started. Files already moving finish.
+    void cancel();
+
+    void setItemCallback(ItemCallback callback) { onItem = std::move(callback); }
+    void setFinishedCallback(FinishedCallback callback) { onFinished = std::move(callback); }
+
+    bool isFinished() const { return finished; }
+    const Result& result() const { return totals; }
+    size_t pipeHighWater() const { return pipe.highWater(); }
+
+private:
+    struct Item {
+        bool folder = false;
+        std::string source;
+        std::string destination;
+        uint32_t size = 0;
+    };
+
+    void pumpReader();
+    void endRead(bool ok);
+    void pumpWriter();
+    void completeFile(bool ok);
+    void completeItem(const std::string& destination, bool ok);
+    void checkFinished();
+
+    Sender source;
+    StreamReader reader;
+    Sender destination;
+    ChunkPipe pipe;
+    size_t chunkSize;
+
+    std::deque<Item> readQueue;  // Files not yet being read
+    std::deque<Item> writeQueue; // Destination order; its files match the pipe's streams
+    bool reading = false;
+    uint64_t readBytes = 0;      // Of the file being read
+
+    // Destination side of the file at the front of writeQueue
+    bool writing = false;        // A destination command is in flight
+    bool opened = false;
+    bool writeFailed = false;
+    uint8_t writeFileId = 0;
+    std::vector<uint8_t> chunk;
+    std::vector<uint8_t> writePayload;
+
+    bool adding = true;
+    bool cancelled = false;
+    bool finished = false;
+    Result totals;
+    ItemCallback onItem;
+    FinishedCallback onFinished;
+};
@@ -0,0 +1,124 @@
+#include "TarWriter.h"
+#include <algorithm>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr size_t TAR_BLOCK = 512;
+
+void octal(char* field, size_t size, uint64_t value) {
+    std::snprintf(field, size, "%0*llo", static_cast<int>(size - 1), static_cast<unsigned long long>(value));
+}
+
+} // namespace
+
+TarWriter::~TarWriter() {
+    if (out.is_open()) close();
+}
+
+bool TarWriter::open(const std::string& path) {
+    buffer.resize(WRITE_BUFFER);
+    out.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    out.open(path, std::ios::binary | std::ios::trunc);
+    outPath = path;
+    position = 0;
+    end = 0;
+    fileOpen = false;
+    return out.is_open();
+}
+
+bool TarWriter::close() {
+    if (!out.is_open()) return false;
+    if (fileOpen) endFile();
+    static const char zeros[TAR_BLOCK * 2] = {};
+    writeRaw(zeros, sizeof(zeros));
+    out.flush();
+    bool ok = static_cast<bool>(out);
+    out.close();
+    // A file dropped at the very end leaves its bytes behind the end marker
+    if (ok && end > position) {
+        std::error_code error;
+        std::filesystem::resize_file(outPath, position, error);
+        ok = !error;
+    }
+    return ok;
+}
+
+bool TarWriter::beginFile(const std::string& path, uint64_t size, int64_t mtime) {
+    if (!out.is_open()) return false;
+    if (fileOpen) endFile();
+    fileStart = position;
+
+    // Names that don't fit the header go in a GNU long name record first
+    if (path.size() >= 100) {
+        writeHeader("././@LongLink", path.size() + 1, 'L', 0);
+        writeRaw(path.c_str(), path.size() + 1);
+        static const char zeros[TAR_BLOCK] = {};
+        size_t pad = (TAR_BLOCK - (path.size() + 1) % TAR_BLOCK) % TAR_BLOCK;
+        writeRaw(zeros, pad);
+    }
+    writeHeader(path.substr(0, 99), size, '0', mtime);
+    fileRemaining = size;
+    fileOpen = true;
+    fileComplete = true;
+    return static_cast<bool>(out);
+}
+
+bool TarWriter::write(const uint8_t* data, size_t size) {
+    if (!fileOpen) return false;
+    size_t n = static_cast<size_t>(std::min<uint64_t>(size, fileRemaining));
+    writeRaw(reinterpret_cast<const char*>(data), n);
+    fileRemaining -= n;
+    if (n < size) fileComplete = false;
+    return n == size && static_cast<bool>(out);
+}
+
+bool TarWriter::endFile() {
+    if (!fileOpen) return false;
+    // Padding a short file with zeros would restore as a damaged file
+    if (!fileComplete || fileRemaining > 0) {
+        discardFile();
+        return false;
+    }
+    static const char zeros[TAR_BLOCK] = {};
+    writeRaw(zeros, (TAR_BLOCK - position % TAR_BLOCK) % TAR_BLOCK);
+    fileOpen = false;
+    return static_cast<bool>(out);
+}
+
+void TarWriter::discardFile() {
+    if (!fileOpen) return;
+    // The next header overwrites it
+    out.seekp(static_cast<std::streamoff>(fileStart));
+    position = fileStart;
+    fileRemaining = 0;
+    fileOpen = false;
+}
+
+void TarWriter::writeHeader(const std::string& name, uint64_t size, char type, int64_t mtime) {
+    char header[TAR_BLOCK] = {};
+    std::memcpy(header, name.data(), std::min<size_t>(name.size(), 99));
+    octal(header + 100, 8, 0644);
+    octal(header + 108, 8, 0);
+    octal(header + 116, 8, 0);
+    octal(header + 124, 12, size);
+    octal(header + 136, 12, static_cast<uint64_t>(std::max<int64_t>(mtime, 0)));
+    header[156] = type;
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+
+    std::memset(header + 148, ' ', 8);
+    unsigned sum = 0;
+    for (size_t i = 0; i < TAR_BLOCK; ++i) sum += static_cast<unsigned char>(header[i]);
+    std::snprintf(header + 148, 8, "%06o", sum);
+    header[155] = ' ';
+    writeRaw(header, TAR_BLOCK);
+}
+
+void TarWriter::writeRaw(const char* data, size_t size) {
+    out.write(data, static_cast<std::streamsize>(size));
+    position += size;
+    end = std::max(end, position);
+}
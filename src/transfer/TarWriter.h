@@ -0,0 +1,50 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Writes a ustar archive front to back. A file's header goes out before its
+// data, so the data can be appended as it arrives; a file that comes up
+// short is rewound away, so the archive only ever holds complete files.
+// The result reads back with ArchiveReader.
+class TarWriter {
+public:
+    // Output is buffered in blocks this big, so a slow network share sees
+    // few large writes rather than one per chunk
+    static constexpr size_t WRITE_BUFFER = 1024 * 1024;
+
+    ~TarWriter();
+
+    bool open(const std::string& path);
+    // Writes the end marker; false if anything failed to write
+    bool close();
+    bool isOpen() const { return out.is_open(); }
+
+    // Starts a file of exactly `size` bytes; mtime in seconds since the epoch
+    bool beginFile(const std::string& path, uint64_t size, int64_t mtime = 0);
+    // Data past the declared size is dropped and reported as false
+    bool write(const uint8_t* data, size_t size);
+    // Finishes the file. If it came up short of its declared size it is
+    // dropped instead, header and all, and the result is false.
+    bool endFile();
+    // Drops the current file, e.g. after a failed read
+    void discardFile();
+
+    uint64_t bytesWritten() const { return position; }
+
+private:
+    void writeHeader(const std::string& name, uint64_t size, char type, int64_t mtime);
+    void writeRaw(const char* data, size_t size);
+
+    std::ofstream out;
+    std::string outPath;
+    std::vector<char> buffer;
+    uint64_t position = 0;
+    uint64_t fileStart = 0; // Where the current file's first header went
+    uint64_t end = 0;       // Furthest byte written, which a discard can leave past position
+    uint64_t fileRemaining = 0;
+    bool fileOpen = false;
+    bool fileComplete = true;
+};
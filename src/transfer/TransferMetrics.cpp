@@ -0,0 +1,172 @@
+#include "TransferMetrics.h"
+#include <QJsonArray>
+#include <QSysInfo>
+#include <QDateTime>
+#include <algorithm>
+
+qint64 TransferMetrics::CommandStats::percentileUs(double percentile) const {
+    uint64_t count = 0;
+    for (auto c : histogram) count += c;
+    if (count == 0) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(count * percentile / 100.0);
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += histogram[i];
+        if (seen > rank) return std::min<qint64>(qint64(1) << (i + 1), maxLatencyUs);
+    }
+    return maxLatencyUs;
+}
+
+TransferMetrics::TransferMetrics() {
+    clock.start();
+}
+
+void TransferMetrics::reset() {
+    stats.clear();
+    currentInFlight = 0;
+    peakInFlight = 0;
+    txTotal = 0;
+    rxTotal = 0;
+    txRate = RateWindow();
+    rxRate = RateWindow();
+}
+
+void TransferMetrics::setDevice(const QString& address, const QString& adapter) {
+    deviceAddress = address;
+    adapterName = adapter;
+    firmware.clear();
+}
+
+void TransferMetrics::setFirmware(const QString& profile) {
+    firmware = profile;
+}
+
+qint64 TransferMetrics::recordSent(Pixl::Command cmd, size_t packetBytes, size_t inFlight) {
+    auto& s = stats[static_cast<uint8_t>(cmd)];
+    s.sent++;
+    s.bytesSent += packetBytes;
+    txTotal += packetBytes;
+    txRate.add(nowMs(), packetBytes);
+    currentInFlight = inFlight;
+    peakInFlight = std::max(peakInFlight, inFlight);
+    return clock.nsecsElapsed();
+}
+
+void TransferMetrics::recordChunk(size_t packetBytes) {
+    rxTotal += packetBytes;
+    rxRate.add(nowMs(), packetBytes);
+}
+
+void TransferMetrics::recordResponse(Pixl::Command cmd, qint64 sentAtNs, size_t payloadBytes,
+                                     uint8_t status, bool corrupt, size_t inFlight) {
+    auto& s = stats[static_cast<uint8_t>(cmd)];
+    s.completed++;
+    s.bytesReceived += payloadBytes;
+    if (status != 0) s.failed++;
+    if (corrupt) s.corrupt++;
+    currentInFlight = inFlight;
+
+    qint64 latencyUs = std::max<qint64>(0, (clock.nsecsElapsed() - sentAtNs) / 1000);
+    if (s.minLatencyUs < 0 || latencyUs < s.minLatencyUs) s.minLatencyUs = latencyUs;
+    s.maxLatencyUs = std::max(s.maxLatencyUs, latencyUs);
+    s.totalLatencyUs += latencyUs;
+
+    int bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && (qint64(1) << (bucket + 1)) <= latencyUs) bucket++;
+    s.histogram[bucket]++;
+}
+
+void TransferMetrics::recordDropped(Pixl::Command cmd) {
+    stats[static_cast<uint8_t>(cmd)].dropped++;
+}
+
+void TransferMetrics::recordRetry(Pixl::Command cmd) {
+    stats[static_cast<uint8_t>(cmd)].retries++;
+}
+
+QString TransferMetrics::commandName(uint8_t cmd) {
+    if (const char* name = Pixl::Protocol::commandName(cmd)) return name;
+    return QString("0x%1").arg(cmd, 2, 16, QChar('0'));
+}
+
+QJsonObject TransferMetrics::toJson() const {
+    QJsonObject root;
+    root["host"] = QSysInfo::machineHostName();
+    root["adapter"] = adapterName;
+    root["device"] = deviceAddress;
+    root["firmware"] = firmware;
+    root["exportedAt"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["uptimeSeconds"] = uptimeSeconds();
+    root["bytesSent"] = double(txTotal);
+    root["bytesReceived"] = double(rxTotal);
+    root["txBytesPerSecond"] = txBytesPerSecond();
+    root["rxBytesPerSecond"] = rxBytesPerSecond();
+    root["maxInFlight"] = double(peakInFlight);
+
+    QJsonArray commandList;
+    for (const auto& [cmd, s] : stats) {
+        QJsonObject c;
+        c["command"] = commandName(cmd);
+        c["sent"] = double(s.sent);
+        c["completed"] = double(s.completed);
+        c["failed"] = double(s.failed);
+        c["corrupt"] = double(s.corrupt);
+        c["dropped"] = double(s.dropped);
+        c["retries"] = double(s.retries);
+        c["bytesSent"] = double(s.bytesSent);
+        c["bytesReceived"] = double(s.bytesReceived);
+        c["minLatencyUs"] = double(std::max<qint64>(s.minLatencyUs, 0));
+        c["maxLatencyUs"] = double(s.maxLatencyUs);
+        c["meanLatencyUs"] = s.completed ? double(s.totalLatencyUs) / s.completed : 0.0;
+        c["p50LatencyUs"] = double(s.percentileUs(50));
+        c["p90LatencyUs"] = double(s.percentileUs(90));
+        c["p99LatencyUs"] = double(s.percentileUs(99));
+
+        QJsonArray histogram;
+        for (auto count : s.histogram) histogram.append(double(count));
+        c["latencyHistogramLog2Us"] = histogram;
+        commandList.append(c);
+    }
+    root["commands"] = commandList;
+    return root;
+}
+
+QString TransferMetrics::toCsv() const {
+    QString csv = "host,adapter,device,command,sent,completed,failed,corrupt,dropped,retries,"
+                  "bytes_sent,bytes_received,min_us,mean_us,p50_us,p90_us,p99_us,max_us\n";
+    const QString prefix = QString("%1,%2,%3,").arg(QSysInfo::machineHostName(), adapterName, deviceAddress);
+    for (const auto& [cmd, s] : stats) {
+        csv += prefix + QString("%1,%2,%3,%4,%5,%6,%7,%8,%9,")
+                   .arg(commandName(cmd)).arg(s.sent).arg(s.completed).arg(s.failed)
+                   .arg(s.corrupt).arg(s.dropped).arg(s.retries).arg(s.bytesSent).arg(s.bytesReceived);
+        csv += QString("%1,%2,%3,%4,%5,%6\n")
+                   .arg(std::max<qint64>(s.minLatencyUs, 0))
+                   .arg(s.completed ? s.totalLatencyUs / qint64(s.completed) : 0)
+                   .arg(s.percentileUs(50)).arg(s.percentileUs(90)).arg(s.percentileUs(99))
+                   .arg(s.maxLatencyUs);
+    }
+    return csv;
+}
+
+void TransferMetrics::RateWindow::add(qint64 ms, uint64_t count) {
+    qint64 sec = ms / 1000;
+    int slot = sec % RATE_WINDOW_SECONDS;
+    if (second[slot] != sec) {
+        second[slot] = sec;
+        bytes[slot] = 0;
+    }
+    bytes[slot] += count;
+}
+
+double TransferMetrics::RateWindow::perSecond(qint64 ms) const {
+    qint64 sec = ms / 1000;
+    uint64_t total = 0;
+    for (int i = 0; i < RATE_WINDOW_SECONDS; ++i) {
+        if (sec - second[i] < RATE_WINDOW_SECONDS && bytes[i] > 0) total += bytes[i];
+    }
+    // The current second is only partly over
+    double span = (RATE_WINDOW_SECONDS - 1) + (ms % 1000) / 1000.0;
+    span = std::min(span, ms / 1000.0);
+    return span > 0 ? total / span : 0.0;
+}
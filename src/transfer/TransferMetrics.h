@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QJsonObject>
+#include <array>
+#include <map>
+#include <cstdint>
+#include "../protocol/PixlProtocol.h"
+
+// Counters and round-trip latency histograms for the commands we send.
+// Everything is recorded on the GUI thread, next to the request pipeline.
+class TransferMetrics {
+public:
+    // Bucket i counts round trips in [2^i, 2^(i+1)) microseconds
+    static constexpr int LATENCY_BUCKETS = 24;
+    static constexpr int RATE_WINDOW_SECONDS = 10;
+
+    struct CommandStats {
+        uint64_t sent = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;    // Non-zero status
+        uint64_t corrupt = 0;   // Chunk gaps, duplicates or size mismatch
+        uint64_t dropped = 0;   // Never answered
+        uint64_t retries = 0;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        qint64 minLatencyUs = -1;
+        qint64 maxLatencyUs = 0;
+        qint64 totalLatencyUs = 0;
+        std::array<uint64_t, LATENCY_BUCKETS> histogram{};
+
+        // Upper bound of the bucket holding the given percentile (0-100)
+        qint64 percentileUs(double percentile) const;
+    };
+
+    TransferMetrics();
+
+    void reset();
+    void setDevice(const QString& address, const QString& adapter);
+    void setFirmware(const QString& profile);
+
+    // Returns the timestamp to pass back to recordResponse
+    qint64 recordSent(Pixl::Command cmd, size_t packetBytes, size_t inFlight);
+    void recordChunk(size_t packetBytes);
+    void recordResponse(Pixl::Command cmd, qint64 sentAtNs, size_t payloadBytes,
+                        uint8_t status, bool corrupt, size_t inFlight);
+    void recordDropped(Pixl::Command cmd);
+    void recordRetry(Pixl::Command cmd);
+
+    const std::map<uint8_t, CommandStats>& commands() const { return stats; }
+    size_t inFlight() const { return currentInFlight; }
+    size_t maxInFlight() const { return peakInFlight; }
+    uint64_t totalBytesSent() const { return txTotal; }
+    uint64_t totalBytesReceived() const { return rxTotal; }
+    double txBytesPerSecond() const { return txRate.perSecond(nowMs()); }
+    double rxBytesPerSecond() const { return rxRate.perSecond(nowMs()); }
+    double uptimeSeconds() const { return clock.elapsed() / 1000.0; }
+
+    static QString commandName(uint8_t cmd);
+
+    QJsonObject toJson() const;
+    QString toCsv() const;
+
+private:
+    // Bytes per one-second bucket over the last RATE_WINDOW_SECONDS
+    struct RateWindow {
+        std::array<qint64, RATE_WINDOW_SECONDS> second{};
+        std::array<uint64_t, RATE_WINDOW_SECONDS> bytes{};
+        void add(qint64 ms, uint64_t count);
+        double perSecond(qint64 ms) const;
+    };
+
+    qint64 nowMs() const { return clock.elapsed(); }
+
+    QElapsedTimer clock;
+    QString deviceAddress;
+    QString adapterName;
+    QString firmware;
+    std::map<uint8_t, CommandStats> stats;
+    size_t currentInFlight = 0;
+    size_t peakInFlight = 0;
+    uint64_t txTotal = 0;
+    uint64_t rxTotal = 0;
+    RateWindow txRate;
+    RateWindow rxRate;
+};
@@ -0,0 +1,75 @@
+#include "UploadPlan.h"
+#include "ArchiveReader.h"
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+UploadPlan UploadPlan::scan(const QString& localPath, const QString& remoteDir) {
+    UploadPlan plan;
+    QFileInfo fi(localPath);
+    if (fi.isFile() && ArchiveReader::isArchive(QFile::encodeName(localPath).toStdString()) &&
+        plan.scanArchive(localPath, remoteDir)) {
+        return plan;
+    }
+    plan.scanTree(localPath, remoteJoin(remoteDir, fi.fileName()));
+    return plan;
+}
+
+QString UploadPlan::remoteJoin(const QString& dir, const QString& name) {
+    return dir + (dir.endsWith("/") ? "" : "/") + name;
+}
+
+bool UploadPlan::scanArchive(const QString& localPath, const QString& remoteDir) {
+    auto archive = std::make_shared<ArchiveReader>();
+    if (!archive->open(QFile::encodeName(localPath).toStdString())) {
+        qDebug() << "Uploading" << localPath << "as a file:" << QString::fromStdString(archive->error());
+        return false;
+    }
+
+    QString name = QFileInfo(localPath).fileName();
+    name.chop(static_cast<int>(ArchiveReader::extensionLength(name.toStdString())));
+    QString root = remoteJoin(remoteDir, name);
+    list.push_back({true, QString(), root});
+
+    // Parents come before anything inside them, whether or not the archive lists them
+    QSet<QString> folders;
+    auto ensureFolder = [&](const QString& relative) {
+        QString path;
+        for (const QString& part : relative.split('/')) {
+            path = path.isEmpty() ? part : path + "/" + part;
+            if (folders.contains(path)) continue;
+            folders.insert(path);
+            list.push_back({true, QString(), remoteJoin(root, path)});
+        }
+    };
+
+    const auto& entries = archive->entries();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        QString relative = QString::fromStdString(entries[i].path);
+        if (entries[i].folder) {
+            ensureFolder(relative);
+            continue;
+        }
+        if (relative.contains('/')) ensureFolder(relative.section('/', 0, -2));
+        Item item{false, QDir(localPath).filePath(relative), remoteJoin(root, relative)};
+        item.archive = archive;
+        item.entry = static_cast<int>(i);
+        list.push_back(item);
+    }
+    return true;
+}
+
+void UploadPlan::scanTree(const QString& localPath, const QString& remotePath) {
+    QFileInfo fi(localPath);
+    if (fi.isDir()) {
+        list.push_back({true, localPath, remotePath});
+        QDir dir(localPath);
+        for (const QString& entry : dir.entryList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+            scanTree(dir.absoluteFilePath(entry), remoteJoin(remotePath, entry));
+        }
+    } else {
+        list.push_back({false, localPath, remotePath});
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+#include <memory>
+#include <vector>
+
+class ArchiveReader;
+
+// What uploading a local file, folder or archive into a remote folder
+// takes, in order: folders before anything inside them, then the files.
+// An archive is unpacked on the way into a folder named after it, each
+// entry read straight out of it when its upload starts, with nothing
+// extracted to disk. Shared by the window and --upload.
+class UploadPlan {
+public:
+    struct Item {
+        bool folder = false;
+        QString source; // Local path; under the archive's path for an archive entry
+        QString target; // Remote path
+        // Archive entries: where to read the data from
+        std::shared_ptr<ArchiveReader> archive;
+        int entry = -1;
+    };
+
+    // Only lists the source and, for an archive, its directory; no file data is read
+    static UploadPlan scan(const QString& localPath, const QString& remoteDir);
+
+    static QString remoteJoin(const QString& dir, const QString& name);
+
+    const std::vector<Item>& items() const { return list; }
+
+private:
+    bool scanArchive(const QString& localPath, const QString& remoteDir);
+    void scanTree(const QString& localPath, const QString& remotePath);
+
+    std::vector<Item> list;
+};
@@ -0,0 +1,181 @@
+#include "UploadSource.h"
+#include <QStorageInfo>
+#include <QFileInfo>
+#include <QtConcurrent>
+#include <QDebug>
+#include "../common/Tracer.h"
+#include "ArchiveReader.h"
+
+UploadSource::~UploadSource() {
+    close();
+}
+
+bool UploadSource::open(const QString &path) {
+    close();
+
+    file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        file.reset();
+        return false;
+    }
+    fileSize = file->size();
+    opened = true;
+
+    // Page faults on a mapped network file would stall the GUI thread just
+    // like a read would, so those go through the read-ahead worker instead.
+    if (fileSize > 0 && !isNetworkPath(path)) {
+        mapped = file->map(0, fileSize);
+    }
+    if (!mapped && fileSize > 0) {
+        // Start loading right away so the first block overlaps the OpenFile round trip
+        scheduleBlock(0);
+    }
+    return true;
+}
+
+bool UploadSource::openArchiveEntry(std::shared_ptr<ArchiveReader> source, int index) {
+    close();
+    if (!source || index < 0 || index >= static_cast<int>(source->entries().size())) return false;
+
+    entry = std::make_shared<EntryStream>();
+    entry->reader = std::move(source);
+    entry->index = static_cast<size_t>(index);
+    entry->size = static_cast<qint64>(entry->reader->entries()[entry->index].size);
+    fileSize = entry->size;
+    opened = true;
+    if (fileSize > 0) {
+        scheduleBlock(0);
+    }
+    return true;
+}
+
+void UploadSource::close() {
+    if (nextBlock.isRunning()) {
+        nextBlock.waitForFinished();
+    }
+    nextBlock = QFuture<QByteArray>();
+    nextBlockStart = -1;
+    block.clear();
+    blockStart = 0;
+
+    if (file) {
+        if (mapped) file->unmap(mapped);
+        file->close();
+    }
+    mapped = nullptr;
+    file.reset();
+    entry.reset();
+    fileSize = 0;
+    opened = false;
+    failed = false;
+}
+
+UploadSource::Chunk UploadSource::chunkAt(qint64 offset, qint64 maxSize) {
+    Chunk chunk;
+    if (!opened || failed || offset >= fileSize) return chunk;
+
+    if (mapped) {
+        chunk.data = mapped + offset;
+        chunk.size = qMin(maxSize, fileSize - offset);
+        return chunk;
+    }
+
+    if (offset < blockStart || offset >= blockStart + block.size()) {
+        qint64 wantedStart = offset - (offset % READ_AHEAD_BLOCK);
+        if (nextBlockStart != wantedStart) {
+            // Not sequential (e.g. a retry from an earlier offset); load it now
+            if (nextBlock.isRunning()) nextBlock.waitForFinished();
+            scheduleBlock(wantedStart);
+        }
+        block = nextBlock.result();
+        blockStart = nextBlockStart;
+        nextBlockStart = -1;
+
+        if (block.isEmpty()) {
+            qDebug() << "Read-ahead failed for"
+                     << (file ? file->fileName() : QString::fromStdString(entry->reader->entries()[entry->index].path))
+                     << "at offset" << blockStart;
+            failed = true;
+            return chunk;
+        }
+        if (blockStart + block.size() < fileSize) {
+            scheduleBlock(blockStart + block.size());
+        }
+    }
+
+    qint64 inBlock = offset - blockStart;
+    chunk.data = reinterpret_cast<const uint8_t*>(block.constData()) + inBlock;
+    chunk.size = qMin(maxSize, block.size() - inBlock);
+    return chunk;
+}
+
+void UploadSource::scheduleBlock(qint64 start) {
+    // Only one block is ever in flight, so the worker has the QFile (or the reader) to itself
+    nextBlockStart = start;
+    if (entry) {
+        auto stream = entry;
+        const qint64 size = qMin(READ_AHEAD_BLOCK, fileSize - start);
+        nextBlock = QtConcurrent::run([stream, start, size]() {
+            if (Tracer::enabled()) Tracer::setThreadName("Read-ahead worker");
+            TraceSpan span("decompress", "io");
+            return readEntryBlock(*stream, start, size);
+        });
+        return;
+    }
+
+    auto f = file;
+    nextBlock = QtConcurrent::run([f, start]() {
+        if (Tracer::enabled()) Tracer::setThreadName("Read-ahead worker");
+        TraceSpan span("readAhead", "io");
+        if (!f->seek(start)) return QByteArray();
+        return f->read(READ_AHEAD_BLOCK);
+    });
+}
+
+QByteArray UploadSource::readEntryBlock(EntryStream &stream, qint64 start, qint64 size) {
+    ArchiveReader &reader = *stream.reader;
+    // Going back (a retry) means starting the entry over; going forward skips
+    if (stream.position < 0 || start < stream.position) {
+        stream.position = -1;
+        if (!reader.openEntry(stream.index)) {
+            qDebug() << "Could not read archive entry:" << QString::fromStdString(reader.error());
+            return QByteArray();
+        }
+        stream.position = 0;
+    }
+
+    QByteArray data(size, Qt::Uninitialized);
+    uint8_t *out = reinterpret_cast<uint8_t *>(data.data());
+    while (stream.position < start + size) {
+        // Anything before start is skipped by inflating it into the block and overwriting it
+        qint64 skip = start - stream.position;
+        int64_t n = skip > 0 ? reader.readEntry(out, static_cast<size_t>(qMin(skip, size)))
+                             : reader.readEntry(out + (stream.position - start),
+                                                static_cast<size_t>(start + size - stream.position));
+        if (n <= 0) {
+            qDebug() << "Could not read archive entry:" << QString::fromStdString(reader.error());
+            stream.position = -1;
+            return QByteArray();
+        }
+        stream.position += n;
+    }
+
+    if (stream.position == stream.size) {
+        // Read through so a zip entry's CRC gets checked before the last chunk goes out
+        uint8_t spare = 0;
+        bool ok = reader.readEntry(&spare, 1) == 0;
+        stream.position = -1;
+        if (!ok) {
+            qDebug() << "Could not read archive entry:" << QString::fromStdString(reader.error());
+            return QByteArray();
+        }
+    }
+    return data;
+}
+
+bool UploadSource::isNetworkPath(const QString &path) {
+    QStorageInfo storage(QFileInfo(path).absolutePath());
+    const QByteArray type = storage.fileSystemType().toLower();
+    return type.startsWith("nfs") || type.startsWith("cifs") || type.startsWith("smb") ||
+           type.startsWith("fuse.sshfs") || type == "9p" || type == "afpfs" || type == "webdav";
+}
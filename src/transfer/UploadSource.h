@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QFile>
+#include <QByteArray>
+#include <QFuture>
+#include <QString>
+#include <memory>
+#include <cstdint>
+
+class ArchiveReader;
+
+// Local file being uploaded. Hands out chunk views without a syscall or an
+// allocation per chunk: local files are memory-mapped, files on network
+// mounts (or ones that refuse to map) are read ahead in large blocks on a
+// worker thread so the GUI thread never waits on the disk per packet.
+// Archive entries go through the same read-ahead, inflated a block at a time.
+class UploadSource {
+public:
+    struct Chunk {
+        const uint8_t *data = nullptr;
+        qint64 size = 0;
+    };
+
+    static constexpr qint64 READ_AHEAD_BLOCK = 256 * 1024;
+
+    UploadSource() = default;
+    ~UploadSource();
+    UploadSource(const UploadSource&) = delete;
+    UploadSource& operator=(const UploadSource&) = delete;
+
+    bool open(const QString &path);
+    // Starts inflating the first block right away, so it overlaps the OpenFile round trip
+    bool openArchiveEntry(std::shared_ptr<ArchiveReader> archive, int index);
+    void close();
+    bool isOpen() const { return opened; }
+    bool isMapped() const { return mapped != nullptr; }
+    bool hasError() const { return failed; }
+    qint64 size() const { return fileSize; }
+
+    // View of up to maxSize bytes at offset. Valid until the next call.
+    // An empty chunk means end of file (or an error, see hasError()).
+    Chunk chunkAt(qint64 offset, qint64 maxSize);
+
+private:
+    // Archive entry being streamed. Only the worker touches it while a block is in flight.
+    struct EntryStream {
+        std::shared_ptr<ArchiveReader> reader;
+        size_t index = 0;
+        qint64 size = 0;
+        qint64 position = -1; // How far the reader is into the entry, -1 if it isn't open
+    };
+
+    static bool isNetworkPath(const QString &path);
+    static QByteArray readEntryBlock(EntryStream &stream, qint64 start, qint64 size);
+    void scheduleBlock(qint64 start);
+
+    std::shared_ptr<QFile> file;
+    std::shared_ptr<EntryStream> entry;
+    uchar *mapped = nullptr;
+    qint64 fileSize = 0;
+    bool opened = false;
+    bool failed = false;
+
+    // Read-ahead state: the block being consumed and the one being loaded
+    QByteArray block;
+    qint64 blockStart = 0;
+    QFuture<QByteArray> nextBlock;
+    qint64 nextBlockStart = -1;
+};